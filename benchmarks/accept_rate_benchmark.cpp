@@ -0,0 +1,192 @@
+/*
+ @ 0xCCCCCCCC
+*/
+
+// Measures how many connections per second a TCPServer with a worker-pool accepts, comparing
+// the single acceptor on the main loop handing connections over to workers, against every
+// worker accepting on its own SO_REUSEPORT socket, with and without steering by CPU; workers
+// are pinned to CPUs when steering.
+// Clients connect and then reset connections at once, thus the accepting dominates.
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <future>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "kbase/at_exit_manager.h"
+#include "kbase/command_line.h"
+
+#include "ezio/event_loop.h"
+#include "ezio/io_service_context.h"
+#include "ezio/socket_address.h"
+#include "ezio/tcp_server.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr unsigned short kDefaultPort = 9876;
+constexpr size_t kDefaultWorkers = 4;
+constexpr size_t kDefaultClients = 8;
+constexpr int kDefaultSeconds = 3;
+
+struct Mode {
+    const char* name;
+    bool reuse_port_sharding;
+    bool steer_by_cpu;
+};
+
+const Mode kModes[] {
+    {"single-acceptor", false, false},
+    {"reuse-port", true, false},
+    {"reuse-port+cpu", true, true}
+};
+
+// Connects and resets connections until `stopped`.
+void RunClient(unsigned short port, const std::atomic<bool>& stopped)
+{
+    sockaddr_in addr {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    // Resetting leaves no TIME_WAIT behind, which would run out of local ports otherwise.
+    linger reset_on_close {1, 0};
+
+    while (!stopped.load(std::memory_order_relaxed)) {
+        int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            continue;
+        }
+
+        setsockopt(fd, SOL_SOCKET, SO_LINGER, &reset_on_close, sizeof(reset_on_close));
+        connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+        close(fd);
+    }
+}
+
+// Returns connections accepted per second.
+double BenchmarkMode(const Mode& mode, unsigned short port, size_t workers, size_t clients,
+                     int seconds)
+{
+    ezio::EventLoop* loop = nullptr;
+    std::promise<void> loop_ready;
+
+    std::thread loop_thread([&loop, &loop_ready] {
+        ezio::EventLoop thread_loop;
+        loop = &thread_loop;
+        loop_ready.set_value();
+        thread_loop.Run();
+    });
+
+    loop_ready.get_future().wait();
+
+    std::atomic<size_t> accepted {0};
+    std::unique_ptr<ezio::TCPServer> server;
+    std::promise<void> server_ready;
+    loop->QueueTask([&] {
+        ezio::SocketAddress addr(port);
+        server = std::make_unique<ezio::TCPServer>(loop, addr, mode.name);
+        server->set_on_connect([&accepted](const ezio::TCPConnectionPtr&) {
+            accepted.fetch_add(1, std::memory_order_relaxed);
+        });
+        server->set_on_disconnect([](const ezio::TCPConnectionPtr&) {});
+        server->set_on_message([](const ezio::TCPConnectionPtr&, ezio::Buffer& buf,
+                                  ezio::TimePoint) {
+            buf.ConsumeAll();
+        });
+
+        ezio::TCPServer::Options opt;
+        opt.worker_num = workers;
+        opt.reuse_port_sharding = mode.reuse_port_sharding;
+        opt.steer_by_cpu = mode.steer_by_cpu;
+        opt.pin_workers = mode.steer_by_cpu;
+        server->Start(opt);
+
+        server_ready.set_value();
+    });
+
+    server_ready.get_future().wait();
+
+    std::atomic<bool> stopped {false};
+    std::vector<std::thread> client_threads;
+    for (size_t i = 0; i < clients; ++i) {
+        client_threads.emplace_back([port, &stopped] {
+            RunClient(port, stopped);
+        });
+    }
+
+    auto begin = Clock::now();
+    auto accepted_before = accepted.load(std::memory_order_relaxed);
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    auto accepted_count = accepted.load(std::memory_order_relaxed) - accepted_before;
+    std::chrono::duration<double> elapsed = Clock::now() - begin;
+
+    stopped.store(true, std::memory_order_relaxed);
+    for (auto& th : client_threads) {
+        th.join();
+    }
+
+    std::promise<void> server_gone;
+    loop->QueueTask([&server, &server_gone] {
+        server = nullptr;
+        server_gone.set_value();
+    });
+
+    server_gone.get_future().wait();
+
+    loop->Quit();
+    loop_thread.join();
+
+    return static_cast<double>(accepted_count) / elapsed.count();
+}
+
+constexpr const kbase::CommandLine::CharType kSwitchPort[] = CMDLINE_LITERAL("port");
+constexpr const kbase::CommandLine::CharType kSwitchWorkers[] = CMDLINE_LITERAL("workers");
+constexpr const kbase::CommandLine::CharType kSwitchClients[] = CMDLINE_LITERAL("clients");
+constexpr const kbase::CommandLine::CharType kSwitchSeconds[] = CMDLINE_LITERAL("seconds");
+
+size_t GetSwitchValue(const kbase::CommandLine::CharType* name, size_t default_value)
+{
+    std::string value;
+    if (kbase::CommandLine::ForCurrentProcess().GetSwitchValueASCII(name, value)) {
+        return std::stoul(value);
+    }
+
+    return default_value;
+}
+
+}   // namespace
+
+int main(int argc, char* argv[])
+{
+    kbase::AtExitManager exit_manager;
+
+    kbase::CommandLine::Init(argc, argv);
+
+    auto port = static_cast<unsigned short>(GetSwitchValue(kSwitchPort, kDefaultPort));
+    auto workers = GetSwitchValue(kSwitchWorkers, kDefaultWorkers);
+    auto clients = GetSwitchValue(kSwitchClients, kDefaultClients);
+    auto seconds = static_cast<int>(GetSwitchValue(kSwitchSeconds, kDefaultSeconds));
+
+    ezio::IOServiceContext::Init();
+
+    printf("%zu workers, %zu clients, %d seconds per mode\n", workers, clients, seconds);
+    printf("%16s %20s\n", "mode", "connections/s");
+
+    for (const auto& mode : kModes) {
+        auto rate = BenchmarkMode(mode, port, workers, clients, seconds);
+        printf("%16s %20.0f\n", mode.name, rate);
+    }
+
+    return 0;
+}
@@ -0,0 +1,234 @@
+/*
+ @ 0xCCCCCCCC
+*/
+
+// Measures throughput of posting tasks from a number of producer threads to one consumer,
+// comparing the mutex-guarded vector EventLoop used to queue tasks with, against the
+// lock-free MPSCQueue, and then EventLoop::QueueTask() as a whole, wakeups included.
+// Also reports eventfd writes, i.e. wakeup syscalls, issued per posted task.
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "kbase/at_exit_manager.h"
+#include "kbase/basic_macros.h"
+#include "kbase/command_line.h"
+
+#include "ezio/event_loop.h"
+#include "ezio/io_service_context.h"
+#include "ezio/mpsc_queue.h"
+
+namespace {
+
+using Task = std::function<void()>;
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t kDefaultTaskCount = 1 << 21;
+
+const int kProducerCounts[] {1, 8, 64};
+
+class LockedTaskQueue {
+public:
+    LockedTaskQueue() = default;
+
+    ~LockedTaskQueue() = default;
+
+    DISALLOW_COPY(LockedTaskQueue);
+
+    DISALLOW_MOVE(LockedTaskQueue);
+
+    void Push(Task task)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tasks_.push_back(std::move(task));
+    }
+
+    void RunAll()
+    {
+        std::vector<Task> tasks;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            tasks.swap(tasks_);
+        }
+
+        for (auto& task : tasks) {
+            task();
+        }
+    }
+
+private:
+    std::mutex mutex_;
+    std::vector<Task> tasks_;
+};
+
+class LockFreeTaskQueue {
+    struct Node : ezio::MPSCQueueNode {
+        explicit Node(Task&& t)
+            : task(std::move(t))
+        {}
+
+        Task task;
+    };
+
+public:
+    LockFreeTaskQueue() = default;
+
+    ~LockFreeTaskQueue() = default;
+
+    DISALLOW_COPY(LockFreeTaskQueue);
+
+    DISALLOW_MOVE(LockFreeTaskQueue);
+
+    void Push(Task task)
+    {
+        queue_.Push(std::make_unique<Node>(std::move(task)));
+    }
+
+    void RunAll()
+    {
+        queue_.ConsumeAll([](std::unique_ptr<Node> node) {
+            node->task();
+        });
+    }
+
+private:
+    ezio::MPSCQueue<Node> queue_;
+};
+
+// Producers start together, and the timing ends once the last task has run.
+template<typename Post, typename WaitAll>
+double MeasureTasksPerSecond(int producers, size_t tasks_per_producer, Post post,
+                             WaitAll wait_all)
+{
+    std::atomic<bool> started {false};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < producers; ++i) {
+        threads.emplace_back([&started, &post, tasks_per_producer] {
+            while (!started.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+
+            for (size_t n = 0; n < tasks_per_producer; ++n) {
+                post();
+            }
+        });
+    }
+
+    auto begin = Clock::now();
+    started.store(true, std::memory_order_release);
+    wait_all();
+    std::chrono::duration<double> elapsed = Clock::now() - begin;
+
+    for (auto& th : threads) {
+        th.join();
+    }
+
+    return static_cast<double>(tasks_per_producer * producers) / elapsed.count();
+}
+
+template<typename Queue>
+double BenchmarkQueue(int producers, size_t tasks_per_producer)
+{
+    Queue queue;
+    size_t executed = 0;
+    size_t total = tasks_per_producer * static_cast<size_t>(producers);
+
+    return MeasureTasksPerSecond(producers, tasks_per_producer,
+        [&queue, &executed] {
+            queue.Push([&executed] { ++executed; });
+        },
+        [&queue, &executed, total] {
+            while (executed < total) {
+                queue.RunAll();
+            }
+        });
+}
+
+// Returns tasks per second, and stores wakeups sent per task into `wakeups_per_task`.
+double BenchmarkEventLoop(int producers, size_t tasks_per_producer, double& wakeups_per_task)
+{
+    ezio::EventLoop* loop = nullptr;
+    std::mutex loop_mutex;
+    std::condition_variable loop_ready;
+
+    std::thread loop_thread([&] {
+        ezio::EventLoop thread_loop;
+        {
+            std::lock_guard<std::mutex> lock(loop_mutex);
+            loop = &thread_loop;
+        }
+
+        loop_ready.notify_one();
+        thread_loop.Run();
+    });
+
+    {
+        std::unique_lock<std::mutex> lock(loop_mutex);
+        loop_ready.wait(lock, [&loop] { return loop != nullptr; });
+    }
+
+    std::atomic<size_t> executed {0};
+    size_t total = tasks_per_producer * static_cast<size_t>(producers);
+
+    auto rate = MeasureTasksPerSecond(producers, tasks_per_producer,
+        [loop, &executed] {
+            loop->QueueTask([&executed] {
+                executed.fetch_add(1, std::memory_order_relaxed);
+            });
+        },
+        [&executed, total] {
+            while (executed.load(std::memory_order_relaxed) < total) {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+        });
+
+    wakeups_per_task = static_cast<double>(loop->wakeup_count()) / static_cast<double>(total);
+
+    loop->Quit();
+    loop_thread.join();
+
+    return rate;
+}
+
+constexpr const kbase::CommandLine::CharType kSwitchTasks[] = CMDLINE_LITERAL("tasks");
+
+}   // namespace
+
+int main(int argc, char* argv[])
+{
+    kbase::AtExitManager exit_manager;
+
+    kbase::CommandLine::Init(argc, argv);
+
+    size_t task_count = kDefaultTaskCount;
+    std::string tasks_value;
+    if (kbase::CommandLine::ForCurrentProcess().GetSwitchValueASCII(kSwitchTasks, tasks_value)) {
+        task_count = std::stoul(tasks_value);
+    }
+
+    ezio::IOServiceContext::Init();
+
+    printf("%zu tasks in total; throughput in million tasks per second\n", task_count);
+    printf("%10s %14s %14s %14s %16s\n", "producers", "mutex+vector", "mpsc-queue", "event-loop",
+           "wakeups/task");
+
+    for (auto producers : kProducerCounts) {
+        auto tasks_per_producer = task_count / static_cast<size_t>(producers);
+        auto locked = BenchmarkQueue<LockedTaskQueue>(producers, tasks_per_producer);
+        auto lock_free = BenchmarkQueue<LockFreeTaskQueue>(producers, tasks_per_producer);
+        double wakeups_per_task = 0;
+        auto event_loop = BenchmarkEventLoop(producers, tasks_per_producer, wakeups_per_task);
+        printf("%10d %14.2f %14.2f %14.2f %16.4f\n", producers, locked / 1e6, lock_free / 1e6,
+               event_loop / 1e6, wakeups_per_task);
+    }
+
+    return 0;
+}
@@ -44,9 +44,9 @@ void ChatClient::ReadUserInput()
 
     std::string cmd;
     if (DataCodec::MatchCommand(s, cmd)) {
-        conn_->Send(DataCodec::NewCommand(cmd));
+        conn_->Send(codec_.NewCommand(cmd));
     } else {
-        conn_->Send(DataCodec::NewMessage(s));
+        conn_->Send(codec_.NewMessage(s));
     }
 
     main_loop_.QueueTask(std::bind(&ChatClient::ReadUserInput, this));
@@ -64,9 +64,9 @@ void ChatClient::OnConnection(const ezio::TCPConnectionPtr& conn)
     }
 }
 
-void ChatClient::OnMessage(const ezio::TCPConnectionPtr&, const std::string& msg,
+void ChatClient::OnMessage(const ezio::TCPConnectionPtr&, kbase::StringView msg,
                            ezio::TimePoint) const
 {
     ENSURE(CHECK, thread_.event_loop()->BelongsToCurrentThread()).Require();
-    printf("%s\n", msg.c_str());
+    printf("%.*s\n", static_cast<int>(msg.size()), msg.data());
 }
@@ -25,7 +25,7 @@ private:
 
     void OnConnection(const ezio::TCPConnectionPtr& conn);
 
-    void OnMessage(const ezio::TCPConnectionPtr&, const std::string& msg, ezio::TimePoint) const;
+    void OnMessage(const ezio::TCPConnectionPtr&, kbase::StringView msg, ezio::TimePoint) const;
 
 private:
     ezio::EventLoop main_loop_;
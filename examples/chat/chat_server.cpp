@@ -10,6 +10,8 @@
 #include "kbase/string_format.h"
 #include "kbase/string_util.h"
 
+#include "ezio/chrono_utils.h"
+#include "ezio/shared_payload.h"
 #include "ezio/socket_address.h"
 
 using namespace std::placeholders;
@@ -64,10 +66,11 @@ void ChatServer::OnUserOffline(const ezio::TCPConnectionPtr& conn)
     ENSURE(CHECK, count == 1)(count).Require();
 }
 
-void ChatServer::OnCommand(const ezio::TCPConnectionPtr& conn, const std::string& cmd,
+void ChatServer::OnCommand(const ezio::TCPConnectionPtr& conn, kbase::StringView command,
                            ezio::TimePoint ts)
 {
-    auto time = kbase::TimePointToLocalTime(ts);
+    auto cmd = command.ToString();
+    auto time = kbase::TimePointToLocalTime(ezio::ToSystemTime(ts));
     auto prefix = kbase::StringPrintf("[%02d:%02d:%02d] *| ", time.first.tm_hour, time.first.tm_min,
                                       time.first.tm_sec);
 
@@ -84,7 +87,7 @@ void ChatServer::OnCommand(const ezio::TCPConnectionPtr& conn, const std::string
         std::string msg(prefix + "Current members in chat-room:\n");
         msg.append(kbase::JoinString(members, "\n"));
 
-        conn->Send(DataCodec::NewMessage(msg));
+        conn->Send(codec_.NewMessage(msg));
 
         return;
     }
@@ -98,7 +101,7 @@ void ChatServer::OnCommand(const ezio::TCPConnectionPtr& conn, const std::string
         }
 
         std::string msg(prefix + "Your current nickname is " + name);
-        conn->Send(DataCodec::NewMessage(msg));
+        conn->Send(codec_.NewMessage(msg));
 
         return;
     }
@@ -107,7 +110,7 @@ void ChatServer::OnCommand(const ezio::TCPConnectionPtr& conn, const std::string
         std::vector<std::string> components;
         if (kbase::SplitString(cmd, " ", components) != 2) {
             std::string error(prefix + "Incorrect usage of $USE-NAME$!");
-            conn->Send(DataCodec::NewMessage(error));
+            conn->Send(codec_.NewMessage(error));
             return;
         }
 
@@ -117,26 +120,30 @@ void ChatServer::OnCommand(const ezio::TCPConnectionPtr& conn, const std::string
         }
 
         std::string msg(prefix + "Your nickname has been changed to " + components[1]);
-        conn->Send(DataCodec::NewMessage(msg));
+        conn->Send(codec_.NewMessage(msg));
 
         return;
     }
 
-    conn->Send(DataCodec::NewMessage(kbase::StringFormat("Unrecognized command {0}", cmd)));
+    conn->Send(codec_.NewMessage(kbase::StringFormat("Unrecognized command {0}", cmd)));
 }
 
-void ChatServer::OnMessage(const ezio::TCPConnectionPtr& conn, const std::string& msg,
+void ChatServer::OnMessage(const ezio::TCPConnectionPtr& conn, kbase::StringView msg,
                            ezio::TimePoint ts) const
 {
-    auto t = kbase::TimePointToLocalTime(ts);
+    auto t = kbase::TimePointToLocalTime(ezio::ToSystemTime(ts));
     auto time = kbase::StringPrintf("%02d:%02d:%02d", t.first.tm_hour, t.first.tm_min,
                                     t.first.tm_sec);
 
     // For simplicity, we use grand lock...
     std::lock_guard<std::mutex> lock(session_mtx_);
-    auto message = kbase::StringFormat("[{0}] {1}| {2}", time, sessions_.at(conn).nickname, msg);
+    auto message = kbase::StringFormat("[{0}] {1}| {2}", time, sessions_.at(conn).nickname,
+                                       msg.ToString());
+
+    // Encode once and share the payload among all sessions.
+    ezio::SharedPayload payload(codec_.NewMessage(message));
     for (const auto& session : sessions_) {
-        session.first->Send(DataCodec::NewMessage(message));
+        session.first->Send(payload);
     }
 }
 
@@ -149,8 +156,10 @@ void ChatServer::OnSystemBroadcast(const std::string& broad_message) const
                                        time.first.tm_sec,
                                        broad_message.c_str());
 
+    ezio::SharedPayload payload(codec_.NewMessage(content));
+
     std::lock_guard<std::mutex> lock(session_mtx_);
     for (const auto& session : sessions_) {
-        session.first->Send(DataCodec::NewMessage(content));
+        session.first->Send(payload);
     }
 }
@@ -47,9 +47,10 @@ private:
 
     void OnUserOffline(const ezio::TCPConnectionPtr& conn);
 
-    void OnCommand(const ezio::TCPConnectionPtr& conn, const std::string& cmd, ezio::TimePoint ts);
+    void OnCommand(const ezio::TCPConnectionPtr& conn, kbase::StringView command,
+                   ezio::TimePoint ts);
 
-    void OnMessage(const ezio::TCPConnectionPtr& conn, const std::string& msg,
+    void OnMessage(const ezio::TCPConnectionPtr& conn, kbase::StringView msg,
                    ezio::TimePoint ts) const;
 
     void OnSystemBroadcast(const std::string& broad_message) const;
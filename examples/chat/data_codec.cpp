@@ -4,6 +4,7 @@
 
 #include "data_codec.h"
 
+#include <limits>
 #include <regex>
 
 #include "kbase/error_exception_util.h"
@@ -11,38 +12,46 @@
 
 #include "ezio/buffer.h"
 
+using namespace std::placeholders;
+
+namespace {
+
+// Each frame carries a data type byte followed by the data.
+ezio::LengthPrefixCodec::Options FrameOptions()
+{
+    ezio::LengthPrefixCodec::Options opts;
+    opts.header_size = sizeof(uint16_t);
+    opts.byte_order = ezio::LengthPrefixCodec::ByteOrder::BigEndian;
+    opts.max_frame_size = std::numeric_limits<uint16_t>::max();
+    return opts;
+}
+
+}   // namespace
+
+DataCodec::DataCodec()
+    : frame_codec_(FrameOptions())
+{
+    frame_codec_.set_on_frame(std::bind(&DataCodec::DispatchFrame, this, _1, _2, _3));
+}
+
 void DataCodec::OnDataReceive(const ezio::TCPConnectionPtr& conn, ezio::Buffer& buf,
                               ezio::TimePoint ts) const
 {
-    while (buf.readable_size() >= (sizeof(DataType) + kDataLenTypeSize)) {
-        auto data_type = static_cast<DataType>(buf.PeekAs<int8_t>());
-        if (!(DataType::TypeBegin < data_type && data_type < DataType::TypeEnd)) {
-            LOG(ERROR) << "Invalid data type: " << data_type;
-            conn->Shutdown();
-            return;
-        }
-
-        auto data_len = ezio::NetworkToHost(
-            *reinterpret_cast<const int16_t*>(buf.Peek() + sizeof(DataType)));
-        if (data_len <= 0) {
-            LOG(ERROR) << "Invalid data length: " << data_len;
-            conn->Shutdown();
-            return;
-        }
-
-        if (buf.readable_size() >= (sizeof(DataType) + kDataLenTypeSize + data_len)) {
-            buf.Consume(sizeof(DataType));
-            buf.Consume(kDataLenTypeSize);
-            auto data = buf.ReadAsString(data_len);
-            DispatchParsedData(data_type, data, conn, ts);
-        }
-    }
+    frame_codec_.OnDataReceive(conn, buf, ts);
 }
 
-void DataCodec::DispatchParsedData(DataType type, const std::string& data,
-                                   const ezio::TCPConnectionPtr& conn, ezio::TimePoint ts) const
+void DataCodec::DispatchFrame(const ezio::TCPConnectionPtr& conn, kbase::StringView frame,
+                              ezio::TimePoint ts) const
 {
-    switch (type) {
+    if (frame.size() <= sizeof(DataType)) {
+        LOG(ERROR) << "Invalid data length: " << frame.size();
+        conn->Shutdown();
+        return;
+    }
+
+    auto data_type = static_cast<DataType>(frame[0]);
+    kbase::StringView data(frame.data() + sizeof(DataType), frame.size() - sizeof(DataType));
+    switch (data_type) {
         case DataType::Command:
             on_command_(conn, data, ts);
             break;
@@ -52,7 +61,8 @@ void DataCodec::DispatchParsedData(DataType type, const std::string& data,
             break;
 
         default:
-            ENSURE(CHECK, kbase::NotReached()).Require();
+            LOG(ERROR) << "Invalid data type: " << data_type;
+            conn->Shutdown();
             break;
     }
 }
@@ -74,24 +84,22 @@ bool DataCodec::MatchCommand(const std::string& str, std::string& cmd)
     return true;
 }
 
-// static
-std::string DataCodec::NewMessage(const std::string& msg)
+std::string DataCodec::NewMessage(kbase::StringView msg) const
 {
-    ezio::Buffer buf(64);
-    buf.Write(static_cast<int8_t>(DataType::Message));
-    buf.Write(static_cast<int16_t>(msg.size()));
-    buf.Write(msg.data(), msg.size());
+    return NewData(DataType::Message, msg);
+}
 
-    return buf.ReadAllAsString();
+std::string DataCodec::NewCommand(kbase::StringView command) const
+{
+    return NewData(DataType::Command, command);
 }
 
-// static
-std::string DataCodec::NewCommand(const std::string& command)
+std::string DataCodec::NewData(DataType type, kbase::StringView data) const
 {
-    ezio::Buffer buf(16);
-    buf.Write(static_cast<int8_t>(DataType::Command));
-    buf.Write(static_cast<int16_t>(command.size()));
-    buf.Write(command.data(), command.size());
+    ezio::Buffer buf(frame_codec_.options().header_size + sizeof(DataType) + data.size());
+    frame_codec_.WriteHeader(sizeof(DataType) + data.size(), buf);
+    buf.Write(static_cast<int8_t>(type));
+    buf.Write(data.data(), data.size());
 
     return buf.ReadAllAsString();
 }
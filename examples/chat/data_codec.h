@@ -11,6 +11,7 @@
 #include "kbase/string_view.h"
 
 #include "ezio/chrono_utils.h"
+#include "ezio/length_prefix_codec.h"
 #include "ezio/tcp_connection.h"
 
 constexpr kbase::StringView kCmdList {"LIST"};
@@ -26,12 +27,13 @@ public:
         TypeEnd
     };
 
-    using CommandHandler = std::function<void(const ezio::TCPConnectionPtr&, const std::string&,
+    // Data are views into the input buffer, and are valid only during the call.
+    using CommandHandler = std::function<void(const ezio::TCPConnectionPtr&, kbase::StringView,
                                               ezio::TimePoint)>;
-    using MessageHandler = std::function<void(const ezio::TCPConnectionPtr&, const std::string&,
+    using MessageHandler = std::function<void(const ezio::TCPConnectionPtr&, kbase::StringView,
                                               ezio::TimePoint)>;
 
-    DataCodec() = default;
+    DataCodec();
 
     ~DataCodec() = default;
 
@@ -41,9 +43,9 @@ public:
 
     static bool MatchCommand(const std::string& str, std::string& cmd);
 
-    static std::string NewMessage(const std::string& msg);
+    std::string NewMessage(kbase::StringView msg) const;
 
-    static std::string NewCommand(const std::string& command);
+    std::string NewCommand(kbase::StringView command) const;
 
     void set_on_command(CommandHandler handler)
     {
@@ -59,14 +61,13 @@ public:
                        ezio::TimePoint ts) const;
 
 private:
-    void DispatchParsedData(DataType type,
-                            const std::string& data,
-                            const ezio::TCPConnectionPtr& conn,
-                            ezio::TimePoint ts) const;
+    std::string NewData(DataType type, kbase::StringView data) const;
 
-private:
-    static constexpr size_t kDataLenTypeSize = sizeof(uint16_t);
+    void DispatchFrame(const ezio::TCPConnectionPtr& conn, kbase::StringView frame,
+                       ezio::TimePoint ts) const;
 
+private:
+    ezio::LengthPrefixCodec frame_codec_;
     CommandHandler on_command_;
     MessageHandler on_message_;
 };
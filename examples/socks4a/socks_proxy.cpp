@@ -81,6 +81,9 @@ std::pair<bool, RequestPacket> DecodeRequestPacket(ezio::Buffer& buf)
         return {false, {}};
     }
 
+    // Gathering content invalidates iterators, thus do it before searching.
+    auto ip_in_network = *reinterpret_cast<const uint32_t*>(buf.Linearize(8) + 4);
+
     // USERID field.
     auto userid_delim = std::find(buf.cbegin() + 8, buf.cend(), '\0');
     if (userid_delim == buf.cend()) {
@@ -89,7 +92,6 @@ std::pair<bool, RequestPacket> DecodeRequestPacket(ezio::Buffer& buf)
 
     auto socks4a = false;
     auto domain_delim = buf.cend();
-    auto ip_in_network = *reinterpret_cast<const uint32_t*>(buf.Peek() + 4);
     if (ezio::NetworkToHost(ip_in_network) < 256) {
         // Socks4a packet must contain a DOMAIN field.
         socks4a = true;
@@ -183,7 +185,11 @@ void SocksProxy::OnClientMessage(const ezio::TCPConnectionPtr& conn, ezio::Buffe
     }
 
     if (tunnel) {
+        // Bytes arriving before the tunnel is up stay in the buffer on POSIX, and are relayed
+        // along with the rest once it is.
+#if !defined(OS_POSIX)
         tunnel->Send(buf.ReadAllAsString());
+#endif
         return;
     }
 
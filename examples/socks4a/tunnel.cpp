@@ -51,10 +51,10 @@ void Tunnel::Close()
     Teardown();
 }
 
-void Tunnel::Send(kbase::StringView data)
+void Tunnel::Send(std::string&& data)
 {
     FORCE_AS_NON_CONST_FUNCTION();
-    client_.connection()->Send(data);
+    client_.connection()->Send(std::move(data));
 }
 
 void Tunnel::Setup()
@@ -91,6 +91,13 @@ void Tunnel::OnRemoteConnect(const ezio::TCPConnectionPtr& conn) const
     client_conn_->Send(kbase::StringView(granted_resp, 8));
 
     conn->SetTCPNoDelay(true);
+
+#if defined(OS_POSIX)
+    // Both connections run on the same loop, and bytes are relayed in kernel space from now
+    // on, including those the client has sent ahead.
+    client_conn_->RelayTo(conn);
+    conn->RelayTo(client_conn_);
+#endif
 }
 
 void Tunnel::OnRemoteDisconnect(const ezio::TCPConnectionPtr& conn) const
@@ -28,7 +28,7 @@ public:
 
     void Close();
 
-    void Send(kbase::StringView data);
+    void Send(std::string&& data);
 
     const std::string& name() const noexcept
     {
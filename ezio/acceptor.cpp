@@ -9,6 +9,12 @@
 #include "ezio/event_loop.h"
 #include "ezio/socket_utils.h"
 
+namespace {
+
+using namespace std::placeholders;
+
+}   // namespace
+
 namespace ezio {
 
 #if defined(OS_POSIX)
@@ -17,7 +23,7 @@ int MakeSentinelFD();
 
 #endif
 
-Acceptor::Acceptor(EventLoop* loop, const SocketAddress& addr)
+Acceptor::Acceptor(EventLoop* loop, const SocketAddress& addr, bool reuse_port)
     : loop_(loop),
       listening_sock_(socket::CreateNonBlockingSocket()),
       listening_notifier_(loop, listening_sock_),
@@ -30,9 +36,18 @@ Acceptor::Acceptor(EventLoop* loop, const SocketAddress& addr)
       listening_(false)
 {
     socket::SetReuseAddr(listening_sock_, true);
+
+#if defined(OS_POSIX)
+    if (reuse_port) {
+        socket::SetReusePort(listening_sock_, true);
+    }
+#elif defined(OS_WIN)
+    ENSURE(CHECK, !reuse_port).Require();
+#endif
+
     socket::BindOrThrow(listening_sock_, addr);
 
-    listening_notifier_.set_on_read(std::bind(&Acceptor::HandleNewConnection, this));
+    listening_notifier_.set_on_read(std::bind(&Acceptor::HandleNewConnection, this, _2));
 }
 
 Acceptor::~Acceptor()
@@ -46,6 +61,11 @@ void Acceptor::Listen()
     ENSURE(CHECK, loop_->BelongsToCurrentThread()).Require();
 
     listening_ = true;
+#if defined(OS_POSIX)
+    if (loop_->io_ring_enabled()) {
+        listening_notifier_.SetRingRead(Notifier::RingRead::Accept);
+    }
+#endif
     listening_notifier_.EnableReading();
 
     socket::ListenOrThrow(listening_sock_);
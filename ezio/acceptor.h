@@ -27,7 +27,9 @@ class Acceptor {
 public:
     using NewConnectionHandler = std::function<void(ScopedSocket&&, const SocketAddress&)>;
 
-    Acceptor(EventLoop* loop, const SocketAddress& addr);
+    // With `reuse_port`, the listening socket has SO_REUSEPORT set before binding, thus
+    // acceptors on different loops can listen on the same address; POSIX only.
+    Acceptor(EventLoop* loop, const SocketAddress& addr, bool reuse_port = false);
 
     ~Acceptor();
 
@@ -47,12 +49,23 @@ public:
         return listening_;
     }
 
+    const ScopedSocket& listening_socket() const noexcept
+    {
+        return listening_sock_;
+    }
+
 private:
 #if defined(OS_WIN)
     void PostAccept();
+#elif defined(OS_POSIX)
+    void HandleAcceptFailure(int err);
+
+    void DispatchNewConnection(ScopedSocket&& conn_sock, const SocketAddress& peer_addr);
 #endif
 
-    void HandleNewConnection();
+    // On POSIX, connections are either accepted here upon readiness of the listening socket,
+    // or accepted by the loop's io_uring one per event, with the socket in `details`.
+    void HandleNewConnection(IOContext::Details details);
 
 private:
     EventLoop* loop_;
@@ -20,8 +20,28 @@ int MakeSentinelFD()
     return fd;
 }
 
-void Acceptor::HandleNewConnection()
+void Acceptor::HandleNewConnection(IOContext::Details details)
 {
+    if (details.completed) {
+        if (details.result < 0) {
+            HandleAcceptFailure(-details.result);
+            return;
+        }
+
+        ScopedSocket conn_sock(details.result);
+        sockaddr_in peer_raw_addr {};
+        socklen_t addr_len = sizeof(peer_raw_addr);
+        if (getpeername(conn_sock.get(), reinterpret_cast<sockaddr*>(&peer_raw_addr),
+                        &addr_len) < 0) {
+            // The peer has reset the connection already.
+            LOG(WARNING) << "getpeername() failed: " << errno;
+            return;
+        }
+
+        DispatchNewConnection(std::move(conn_sock), SocketAddress(peer_raw_addr));
+        return;
+    }
+
     while (true) {
         sockaddr_in peer_raw_addr {};
         socklen_t addr_len = sizeof(peer_raw_addr);
@@ -36,35 +56,39 @@ void Acceptor::HandleNewConnection()
             }
 
             // No looping if we encounterred an error.
-
-            auto err = errno;
-            LOG(ERROR) << "accept4() failed: " << err;
-
-            if (err == EMFILE) {
-                sentinel_fd_ = nullptr;
-                sentinel_fd_.reset(accept(listening_sock_.get(), nullptr, nullptr));
-                if (!sentinel_fd_) {
-                    err = errno;
-                    LOG(ERROR) << "Still failed for accept(): " << err;
-                }
-
-                // Restore.
-                sentinel_fd_ = nullptr;
-                sentinel_fd_.reset(MakeSentinelFD());
-            }
-
+            HandleAcceptFailure(errno);
             return;
         }
 
-        ScopedSocket conn_sock(conn_fd);
-        SocketAddress peer_addr(peer_raw_addr);
+        DispatchNewConnection(ScopedSocket(conn_fd), SocketAddress(peer_raw_addr));
+    }
+}
 
-        if (on_new_connection_) {
-            on_new_connection_(std::move(conn_sock), peer_addr);
-        } else {
-            conn_sock = nullptr;
-            LOG(WARNING) << "No handler set for new connections!";
+void Acceptor::HandleAcceptFailure(int err)
+{
+    LOG(ERROR) << "accept4() failed: " << err;
+
+    if (err == EMFILE) {
+        sentinel_fd_ = nullptr;
+        sentinel_fd_.reset(accept(listening_sock_.get(), nullptr, nullptr));
+        if (!sentinel_fd_) {
+            err = errno;
+            LOG(ERROR) << "Still failed for accept(): " << err;
         }
+
+        // Restore.
+        sentinel_fd_ = nullptr;
+        sentinel_fd_.reset(MakeSentinelFD());
+    }
+}
+
+void Acceptor::DispatchNewConnection(ScopedSocket&& conn_sock, const SocketAddress& peer_addr)
+{
+    if (on_new_connection_) {
+        on_new_connection_(std::move(conn_sock), peer_addr);
+    } else {
+        conn_sock = nullptr;
+        LOG(WARNING) << "No handler set for new connections!";
     }
 }
 
@@ -33,7 +33,7 @@ void Acceptor::PostAccept()
                                                             &accept_req_);
 }
 
-void Acceptor::HandleNewConnection()
+void Acceptor::HandleNewConnection(IOContext::Details)
 {
     auto listener = listening_sock_.get();
     int rv = setsockopt(accept_conn_.get(), SOL_SOCKET, SO_UPDATE_ACCEPT_CONTEXT,
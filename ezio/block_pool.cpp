@@ -0,0 +1,107 @@
+/*
+ @ 0xCCCCCCCC
+*/
+
+#include "ezio/block_pool.h"
+
+#include "kbase/error_exception_util.h"
+#include "kbase/logging.h"
+
+namespace ezio {
+
+constexpr size_t BlockPool::kDefaultBlockSize;
+constexpr size_t BlockPool::kDefaultMaxCachedBytes;
+
+BlockPool::Storage::Storage(size_t block_bytes, size_t max_cached)
+    : block_size(block_bytes),
+      max_cached_bytes(max_cached),
+      orphaned(false)
+{}
+
+void BlockPool::Storage::Release(char* block) noexcept
+{
+    stats.borrowed_bytes -= block_size;
+
+    if (stats.cached_bytes + block_size > max_cached_bytes) {
+        delete[] block;
+        return;
+    }
+
+    free_blocks.push_back(block);
+    stats.cached_bytes += block_size;
+}
+
+void BlockPool::Handle::Release(char* block) const noexcept
+{
+    if (storage_->orphaned.load(std::memory_order_acquire)) {
+        delete[] block;
+        return;
+    }
+
+    storage_->Release(block);
+}
+
+BlockPool::BlockPool()
+    : BlockPool(kDefaultBlockSize, kDefaultMaxCachedBytes)
+{}
+
+BlockPool::BlockPool(size_t block_size, size_t max_cached_bytes)
+    : storage_(std::make_shared<Storage>(block_size, max_cached_bytes))
+{
+    ENSURE(CHECK, block_size > 0).Require();
+    storage_->free_blocks.reserve(max_cached_bytes / block_size);
+}
+
+BlockPool::~BlockPool()
+{
+    Purge();
+
+    auto borrowed_bytes = storage_->stats.borrowed_bytes;
+    LOG_IF(WARNING, borrowed_bytes > 0) << "BlockPool is gone with " << borrowed_bytes
+                                        << " bytes borrowed, which are freed once returned";
+
+    storage_->orphaned.store(true, std::memory_order_release);
+}
+
+char* BlockPool::Acquire()
+{
+    auto& storage = *storage_;
+
+    char* block = nullptr;
+    if (storage.free_blocks.empty()) {
+        block = new char[storage.block_size];
+        ++storage.stats.misses;
+    } else {
+        block = storage.free_blocks.back();
+        storage.free_blocks.pop_back();
+        storage.stats.cached_bytes -= storage.block_size;
+        ++storage.stats.hits;
+    }
+
+    storage.stats.borrowed_bytes += storage.block_size;
+
+    return block;
+}
+
+void BlockPool::Release(char* block) noexcept
+{
+    storage_->Release(block);
+}
+
+void BlockPool::set_max_cached_bytes(size_t max_bytes)
+{
+    storage_->free_blocks.reserve(max_bytes / storage_->block_size);
+    storage_->max_cached_bytes = max_bytes;
+}
+
+void BlockPool::Purge() noexcept
+{
+    for (auto block : storage_->free_blocks) {
+        delete[] block;
+    }
+
+    storage_->free_blocks.clear();
+    storage_->stats.cached_bytes = 0;
+}
+
+}   // namespace ezio
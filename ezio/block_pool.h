@@ -0,0 +1,139 @@
+/*
+ @ 0xCCCCCCCC
+*/
+
+#ifndef EZIO_BLOCK_POOL_H_
+#define EZIO_BLOCK_POOL_H_
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "kbase/basic_macros.h"
+
+namespace ezio {
+
+// BlockPool caches fixed-size memory blocks for chained buffers, so that buffers can
+// borrow storage only while they have data bytes pending and hand it back once drained.
+// Idle blocks are kept up to `max_cached_bytes`, beyond which released blocks are freed
+// immediately, therefore memory held after a burst is bounded.
+// A pool is owned by an EventLoop and is not thread-safe; blocks must be acquired and
+// released on the loop thread.
+// Blocks may outlive the pool, e.g. held by connections outliving their loop: the storage
+// of the pool is kept alive by borrowed blocks, and blocks returned after the pool is gone
+// are freed.
+class BlockPool {
+    struct Storage;
+
+public:
+    static constexpr size_t kDefaultBlockSize = 8192;
+    static constexpr size_t kDefaultMaxCachedBytes = 4 * 1024 * 1024;
+
+    struct Stats {
+        // Acquisitions served by cached blocks.
+        size_t hits;
+        // Acquisitions that had to allocate.
+        size_t misses;
+        // Bytes of idle blocks kept by the pool.
+        size_t cached_bytes;
+        // Bytes of blocks currently borrowed by buffers.
+        size_t borrowed_bytes;
+
+        Stats()
+            : hits(0), misses(0), cached_bytes(0), borrowed_bytes(0)
+        {}
+
+        // Total bytes resident because of the pool.
+        size_t resident_bytes() const noexcept
+        {
+            return cached_bytes + borrowed_bytes;
+        }
+    };
+
+    // Releases blocks to the pool, or frees them once the pool is gone.
+    class Handle {
+    public:
+        Handle() = default;
+
+        explicit operator bool() const noexcept
+        {
+            return storage_ != nullptr;
+        }
+
+        void Release(char* block) const noexcept;
+
+    private:
+        friend class BlockPool;
+
+        explicit Handle(std::shared_ptr<Storage> storage) noexcept
+            : storage_(std::move(storage))
+        {}
+
+    private:
+        std::shared_ptr<Storage> storage_;
+    };
+
+    BlockPool();
+
+    BlockPool(size_t block_size, size_t max_cached_bytes);
+
+    ~BlockPool();
+
+    DISALLOW_COPY(BlockPool);
+
+    DISALLOW_MOVE(BlockPool);
+
+    char* Acquire();
+
+    void Release(char* block) noexcept;
+
+    // Blocks acquired should hold a handle to be released via, if they may outlive the pool.
+    Handle handle() const noexcept
+    {
+        return Handle(storage_);
+    }
+
+    // Frees all idle blocks.
+    void Purge() noexcept;
+
+    size_t block_size() const noexcept
+    {
+        return storage_->block_size;
+    }
+
+    size_t max_cached_bytes() const noexcept
+    {
+        return storage_->max_cached_bytes;
+    }
+
+    // Lowering the limit takes effect on subsequent releases; call Purge() to drop idle
+    // blocks right away.
+    void set_max_cached_bytes(size_t max_bytes);
+
+    const Stats& stats() const noexcept
+    {
+        return storage_->stats;
+    }
+
+private:
+    struct Storage {
+        Storage(size_t block_bytes, size_t max_cached);
+
+        void Release(char* block) noexcept;
+
+        size_t block_size;
+        size_t max_cached_bytes;
+        // Reserved for the most blocks cached, thus releasing blocks never allocates.
+        std::vector<char*> free_blocks;
+        Stats stats;
+        // Set once the pool is gone; blocks returned afterwards may be on any thread.
+        std::atomic<bool> orphaned;
+    };
+
+    std::shared_ptr<Storage> storage_;
+};
+
+}   // namespace ezio
+
+#endif  // EZIO_BLOCK_POOL_H_
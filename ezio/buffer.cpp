@@ -4,8 +4,54 @@
 
 #include "ezio/buffer.h"
 
+#include <algorithm>
+
+#include "ezio/byte_search.h"
+
 namespace ezio {
 
+void Buffer::BlockDeleter::operator()(char* block) const noexcept
+{
+    if (pool) {
+        pool.Release(block);
+    } else {
+        delete[] block;
+    }
+}
+
+Buffer::Block::Block(size_t block_capacity)
+    : data(new char[block_capacity], BlockDeleter{}),
+      capacity(block_capacity),
+      reader_index(0),
+      writer_index(0)
+{}
+
+Buffer::Block::Block(BlockPool* pool)
+    : data(pool->Acquire(), BlockDeleter{pool->handle()}),
+      capacity(pool->block_size()),
+      reader_index(0),
+      writer_index(0)
+{}
+
+Buffer::Block::Block(const Block& other)
+    : data(new char[other.capacity], BlockDeleter{}),
+      capacity(other.capacity),
+      reader_index(other.reader_index),
+      writer_index(other.writer_index)
+{
+    memcpy(data.get() + reader_index, other.read_ptr(), other.readable_size());
+}
+
+Buffer::Block& Buffer::Block::operator=(const Block& other)
+{
+    if (this != &other) {
+        Block copy(other);
+        *this = std::move(copy);
+    }
+
+    return *this;
+}
+
 Buffer::Buffer()
     : Buffer(kDefaultInitialSize)
 {}
@@ -13,11 +59,175 @@ Buffer::Buffer()
 Buffer::Buffer(size_t initial_size)
     : buf_(initial_size + kDefaultPrependSize),
       reader_index_(kDefaultPrependSize),
-      writer_index_(kDefaultPrependSize)
+      writer_index_(kDefaultPrependSize),
+      block_size_(0),
+      chain_readable_size_(0),
+      chain_consumed_size_(0),
+      pool_(nullptr)
+{}
+
+Buffer::Buffer(size_t block_size, BlockPool* pool)
+    : reader_index_(kDefaultPrependSize),
+      writer_index_(kDefaultPrependSize),
+      block_size_(block_size),
+      chain_readable_size_(0),
+      chain_consumed_size_(0),
+      pool_(pool)
 {}
 
+Buffer::Buffer(const Buffer& other)
+    : buf_(other.buf_),
+      reader_index_(other.reader_index_),
+      writer_index_(other.writer_index_),
+      block_size_(other.block_size_),
+      blocks_(other.blocks_),
+      chain_readable_size_(other.chain_readable_size_),
+      chain_consumed_size_(other.chain_consumed_size_),
+      pool_(nullptr)
+{}
+
+Buffer& Buffer::operator=(const Buffer& other)
+{
+    if (this != &other) {
+        Buffer copy(other);
+        *this = std::move(copy);
+    }
+
+    return *this;
+}
+
+Buffer::Buffer(Buffer&& other) noexcept
+    : buf_(std::move(other.buf_)),
+      reader_index_(other.reader_index_),
+      writer_index_(other.writer_index_),
+      block_size_(other.block_size_),
+      blocks_(std::move(other.blocks_)),
+      chain_readable_size_(other.chain_readable_size_),
+      chain_consumed_size_(other.chain_consumed_size_),
+      pool_(other.pool_)
+{
+    other.ResetMovedFrom();
+}
+
+Buffer& Buffer::operator=(Buffer&& other) noexcept
+{
+    if (this != &other) {
+        buf_ = std::move(other.buf_);
+        reader_index_ = other.reader_index_;
+        writer_index_ = other.writer_index_;
+        block_size_ = other.block_size_;
+        blocks_ = std::move(other.blocks_);
+        chain_readable_size_ = other.chain_readable_size_;
+        chain_consumed_size_ = other.chain_consumed_size_;
+        pool_ = other.pool_;
+        other.ResetMovedFrom();
+    }
+
+    return *this;
+}
+
+void Buffer::ResetMovedFrom() noexcept
+{
+    buf_.clear();
+    reader_index_ = 0;
+    writer_index_ = 0;
+    blocks_.clear();
+    chain_readable_size_ = 0;
+    chain_consumed_size_ = 0;
+}
+
+// static
+Buffer Buffer::MakeChained(size_t block_size)
+{
+    ENSURE(CHECK, block_size > 0).Require();
+    return Buffer(block_size, nullptr);
+}
+
+// static
+Buffer Buffer::MakeChained(BlockPool* pool)
+{
+    ENSURE(CHECK, pool != nullptr && pool->block_size() > kDefaultPrependSize).Require();
+    return Buffer(pool->block_size(), pool);
+}
+
+Buffer::Iterator Buffer::FindByte(char ch) const
+{
+    if (!chained()) {
+        auto found = internal::FindByte(buf_.data() + reader_index_,
+                                        buf_.data() + writer_index_,
+                                        ch);
+        return found ? Iterator(found) : cend();
+    }
+
+    auto pos = static_cast<Iterator::difference_type>(chain_consumed_size_);
+    for (size_t idx = 0; idx < blocks_.size() && blocks_[idx].readable_size() > 0; ++idx) {
+        const auto& block = blocks_[idx];
+        auto found = internal::FindByte(block.read_ptr(), block.write_ptr(), ch);
+        if (found) {
+            return Iterator(&blocks_, idx, found, pos + (found - block.read_ptr()));
+        }
+
+        pos += static_cast<Iterator::difference_type>(block.readable_size());
+    }
+
+    return cend();
+}
+
+Buffer::Iterator Buffer::FindCRLF() const
+{
+    return Find(kbase::StringView("\r\n", 2));
+}
+
+Buffer::Iterator Buffer::FindEOL() const
+{
+    return FindByte('\n');
+}
+
+Buffer::Iterator Buffer::Find(kbase::StringView needle) const
+{
+    if (needle.empty()) {
+        return cbegin();
+    }
+
+    if (!chained()) {
+        auto found = internal::FindBytes(buf_.data() + reader_index_,
+                                         buf_.data() + writer_index_,
+                                         needle.data(),
+                                         needle.size());
+        return found ? Iterator(found) : cend();
+    }
+
+    auto pos = static_cast<Iterator::difference_type>(chain_consumed_size_);
+    for (size_t idx = 0; idx < blocks_.size() && blocks_[idx].readable_size() > 0; ++idx) {
+        const auto& block = blocks_[idx];
+        auto found = internal::FindBytes(block.read_ptr(), block.write_ptr(),
+                                         needle.data(), needle.size());
+        if (found) {
+            return Iterator(&blocks_, idx, found, pos + (found - block.read_ptr()));
+        }
+
+        // Then matches starting in the block but ending in following blocks.
+        auto span_begin = block.readable_size() >= needle.size() ?
+                          block.write_ptr() - (needle.size() - 1) : block.read_ptr();
+        for (auto ptr = span_begin; ptr != block.write_ptr(); ++ptr) {
+            if (*ptr == needle[0] && ChainMatchAt(idx, ptr, needle)) {
+                return Iterator(&blocks_, idx, ptr, pos + (ptr - block.read_ptr()));
+            }
+        }
+
+        pos += static_cast<Iterator::difference_type>(block.readable_size());
+    }
+
+    return cend();
+}
+
 void Buffer::Write(const void* data, size_t size)
 {
+    if (chained()) {
+        ChainWrite(data, size);
+        return;
+    }
+
     ReserveWritable(size);
     ENSURE(CHECK, writable_size() >= size)(writable_size())(size).Require();
 
@@ -28,6 +238,11 @@ void Buffer::Write(const void* data, size_t size)
 void Buffer::Consume(size_t data_size)
 {
     ENSURE(CHECK, data_size <= readable_size())(data_size)(readable_size()).Require();
+    if (chained()) {
+        ChainConsume(data_size);
+        return;
+    }
+
     if (data_size < readable_size()) {
         reader_index_ += data_size;
     } else {
@@ -38,22 +253,41 @@ void Buffer::Consume(size_t data_size)
 std::string Buffer::ReadAsString(size_t length)
 {
     ENSURE(CHECK, readable_size() >= length)(readable_size())(length).Require();
-    auto b = begin();
-    std::string s(b, b + length);
+    std::string s;
+    if (chained()) {
+        s.reserve(length);
+        for (auto it = blocks_.cbegin(); s.size() < length; ++it) {
+            s.append(it->read_ptr(), std::min(it->readable_size(), length - s.size()));
+        }
+    } else {
+        auto b = begin();
+        s.assign(b, b + length);
+    }
+
     Consume(length);
     return s;
 }
 
 std::string Buffer::ReadAllAsString()
 {
-    std::string s(begin(), end());
-    ConsumeAll();
-    return s;
+    return ReadAsString(readable_size());
 }
 
 void Buffer::Prepend(const void* data, size_t size)
 {
     ENSURE(CHECK, prependable_size() >= size)(prependable_size())(size).Require();
+    if (size == 0) {
+        return;
+    }
+
+    if (chained()) {
+        auto& head = blocks_.front();
+        head.reader_index -= size;
+        memcpy(head.data.get() + head.reader_index, data, size);
+        chain_readable_size_ += size;
+        return;
+    }
+
     auto start = reader_index_ - size;
     memcpy(buf_.data() + start, data, size);
     reader_index_ -= size;
@@ -79,6 +313,11 @@ void Buffer::Prepend(int64_t n)
 
 void Buffer::ReserveWritable(size_t new_size)
 {
+    if (chained()) {
+        ChainReserveWritable(new_size);
+        return;
+    }
+
     if (writable_size() >= new_size) {
         return;
     }
@@ -96,13 +335,223 @@ void Buffer::ReserveWritable(size_t new_size)
 
 char* Buffer::BeginWrite()
 {
+    if (chained()) {
+        auto idx = ChainWriteBlockIndex();
+        if (idx == blocks_.size()) {
+            AppendBlock();
+        }
+
+        return blocks_[idx].write_ptr();
+    }
+
     return buf_.data() + writer_index_;
 }
 
 void Buffer::EndWrite(size_t written_size)
 {
     ENSURE(CHECK, writable_size() >= written_size).Require();
+    if (chained()) {
+        ChainEndWrite(written_size);
+        return;
+    }
+
     writer_index_ += written_size;
 }
 
+void Buffer::CopyOut(void* dest, size_t size) const
+{
+    if (!chained()) {
+        memcpy(dest, buf_.data() + reader_index_, size);
+        return;
+    }
+
+    auto out = static_cast<char*>(dest);
+    for (auto it = blocks_.cbegin(); size > 0; ++it) {
+        auto n = std::min(it->readable_size(), size);
+        memcpy(out, it->read_ptr(), n);
+        out += n;
+        size -= n;
+    }
+}
+
+size_t Buffer::ChainWriteBlockIndex() const noexcept
+{
+    // Blocks holding readable content always form a prefix of the chain.
+    auto idx = blocks_.size();
+    while (idx > 0 && blocks_[idx - 1].readable_size() == 0) {
+        --idx;
+    }
+
+    if (idx == 0) {
+        return 0;
+    }
+
+    return blocks_[idx - 1].writable_size() > 0 ? idx - 1 : idx;
+}
+
+size_t Buffer::ChainWritableSize() const noexcept
+{
+    size_t size = 0;
+    for (auto idx = ChainWriteBlockIndex(); idx < blocks_.size(); ++idx) {
+        size += blocks_[idx].writable_size();
+    }
+
+    return size;
+}
+
+Buffer::Iterator Buffer::ChainEnd() const noexcept
+{
+    if (chain_readable_size_ == 0) {
+        return cbegin();
+    }
+
+    auto idx = blocks_.size() - 1;
+    while (blocks_[idx].readable_size() == 0) {
+        --idx;
+    }
+
+    return Iterator(&blocks_, idx, blocks_[idx].write_ptr(),
+                    static_cast<Iterator::difference_type>(chain_consumed_size_ +
+                                                           chain_readable_size_));
+}
+
+bool Buffer::ChainMatchAt(size_t block_idx, const value_type* ptr,
+                          kbase::StringView needle) const noexcept
+{
+    auto rest = needle.data();
+    auto rest_size = needle.size();
+    while (rest_size > 0) {
+        if (block_idx == blocks_.size() || blocks_[block_idx].readable_size() == 0) {
+            return false;
+        }
+
+        const auto& block = blocks_[block_idx];
+        auto n = std::min(static_cast<size_t>(block.write_ptr() - ptr), rest_size);
+        if (memcmp(ptr, rest, n) != 0) {
+            return false;
+        }
+
+        rest += n;
+        rest_size -= n;
+
+        if (++block_idx < blocks_.size()) {
+            ptr = blocks_[block_idx].read_ptr();
+        }
+    }
+
+    return true;
+}
+
+const Buffer::value_type* Buffer::ChainLinearize(size_t size)
+{
+    if (blocks_.empty()) {
+        return nullptr;
+    }
+
+    if (blocks_.front().readable_size() >= size) {
+        return blocks_.front().read_ptr();
+    }
+
+    // Moves only the first `size` bytes into a new head block, which thus fits in a pooled
+    // block for small frames, and leaves the rest in place.
+    auto gathered_size = kDefaultPrependSize + size;
+    auto gathered = pool_ && gathered_size <= pool_->block_size() ?
+                    Block(pool_) : Block(gathered_size);
+    gathered.reader_index = kDefaultPrependSize;
+    gathered.writer_index = gathered.reader_index + size;
+    CopyOut(gathered.write_ptr() - size, size);
+
+    // The head block is drained for sure, and is replaced by the gathered one in place, thus
+    // the chain never grows at its front.
+    size -= blocks_.front().readable_size();
+    size_t drained_count = 1;
+    while (size > 0) {
+        auto& block = blocks_[drained_count];
+        auto n = std::min(block.readable_size(), size);
+        block.reader_index += n;
+        size -= n;
+        if (block.readable_size() == 0) {
+            ++drained_count;
+        }
+    }
+
+    blocks_.front() = std::move(gathered);
+    blocks_.erase(blocks_.begin() + 1, blocks_.begin() + static_cast<ptrdiff_t>(drained_count));
+
+    return blocks_.front().read_ptr();
+}
+
+void Buffer::ChainWrite(const void* data, size_t size)
+{
+    auto src = static_cast<const char*>(data);
+    while (size > 0) {
+        auto idx = ChainWriteBlockIndex();
+        auto& block = idx < blocks_.size() ? blocks_[idx] : AppendBlock();
+        auto n = std::min(block.writable_size(), size);
+        memcpy(block.write_ptr(), src, n);
+        block.writer_index += n;
+        chain_readable_size_ += n;
+        src += n;
+        size -= n;
+    }
+}
+
+void Buffer::ChainConsume(size_t data_size)
+{
+    if (data_size == chain_readable_size_) {
+        ConsumeAll();
+        return;
+    }
+
+    chain_readable_size_ -= data_size;
+    chain_consumed_size_ += data_size;
+    while (data_size > 0) {
+        auto& head = blocks_.front();
+        auto n = std::min(head.readable_size(), data_size);
+        head.reader_index += n;
+        data_size -= n;
+        if (head.readable_size() == 0) {
+            blocks_.pop_front();
+        }
+    }
+}
+
+void Buffer::ChainReserveWritable(size_t new_size)
+{
+    auto writable = ChainWritableSize();
+    while (writable < new_size) {
+        writable += AppendBlock().writable_size();
+    }
+}
+
+void Buffer::ChainEndWrite(size_t written_size)
+{
+    chain_readable_size_ += written_size;
+    for (auto idx = ChainWriteBlockIndex(); written_size > 0; ++idx) {
+        auto& block = blocks_[idx];
+        auto n = std::min(block.writable_size(), written_size);
+        block.writer_index += n;
+        written_size -= n;
+    }
+}
+
+Buffer::Block& Buffer::AppendBlock()
+{
+    // The head block reserves prependable space as the contiguous mode does; a pooled head
+    // block carves it out of the fixed block size.
+    auto head = blocks_.empty();
+    if (pool_) {
+        blocks_.emplace_back(pool_);
+    } else {
+        blocks_.emplace_back(head ? block_size_ + kDefaultPrependSize : block_size_);
+    }
+
+    if (head) {
+        blocks_.back().reader_index = kDefaultPrependSize;
+        blocks_.back().writer_index = kDefaultPrependSize;
+    }
+
+    return blocks_.back();
+}
+
 }   // namespace ezio
@@ -5,18 +5,27 @@
 #ifndef EZIO_BUFFER_H_
 #define EZIO_BUFFER_H_
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
+#include <deque>
+#include <memory>
 #include <string>
 #include <type_traits>
 #include <vector>
 
 #include "kbase/basic_macros.h"
 #include "kbase/error_exception_util.h"
+#include "kbase/string_view.h"
 
+#include "ezio/block_pool.h"
 #include "ezio/endian_utils.h"
 
+#if defined(OS_POSIX)
+#include <sys/uio.h>
+#endif
+
 namespace ezio {
 
 namespace internal {
@@ -54,15 +63,91 @@ struct floating_point_store_type<double> {
 // prependable_size = r - 0
 // readable_size = w - r
 // writable_size = e - w
+//
+// A buffer can alternatively be created in chained mode via MakeChained(), in which
+// content is stored in a chain of fixed-size blocks instead of one contiguous region.
+// Appending to or consuming from a chained buffer never moves existing data bytes; blocks
+// are linked and released at both ends instead.
+//   +---+-------+   +-----------+   +-----+-----+   +-----------+
+//   | p |  ###  |-->|  #######  |-->| ### |     |-->|           |
+//   +---+-------+   +-----------+   +-----+-----+   +-----------+
+// Prepending is only possible in the head block, and writable_size() is the total free
+// space of tail blocks.
+// A chained buffer allocates its head block on the first write, thus a fresh or fully
+// consumed chained buffer has no prependable space.
+// Functions relying on contiguity, i.e. Peek() and BeginWrite(), are still supported but
+// they require content be gathered by Linearize() first or cover the current block only;
+// prefer PeekIOVecs() and PrepareWritableIOVecs() in chained mode.
+// A chained buffer can also borrow its blocks from a BlockPool, then every block it holds
+// goes back to the pool once consumed. Such a buffer must be used and destroyed on the
+// thread owning the pool, and a copy of it allocates its own blocks.
 
 class Buffer {
 private:
     static constexpr size_t kDefaultPrependSize = 8;
     static constexpr size_t kDefaultInitialSize = 1024;
+    static constexpr size_t kDefaultBlockSize = 8192;
+
+    // Returns a block to its pool, or frees it if it doesn't come from a pool.
+    struct BlockDeleter {
+        BlockPool::Handle pool;
+
+        void operator()(char* block) const noexcept;
+    };
+
+    struct Block {
+        std::unique_ptr<char[], BlockDeleter> data;
+        size_t capacity;
+        size_t reader_index;
+        size_t writer_index;
+
+        explicit Block(size_t block_capacity);
+
+        explicit Block(BlockPool* pool);
+
+        ~Block() = default;
+
+        Block(const Block& other);
+
+        Block& operator=(const Block& other);
+
+        DEFAULT_MOVE(Block);
+
+        const char* read_ptr() const noexcept
+        {
+            return data.get() + reader_index;
+        }
+
+        const char* write_ptr() const noexcept
+        {
+            return data.get() + writer_index;
+        }
+
+        char* write_ptr() noexcept
+        {
+            return data.get() + writer_index;
+        }
+
+        size_t readable_size() const noexcept
+        {
+            return writer_index - reader_index;
+        }
+
+        size_t writable_size() const noexcept
+        {
+            return capacity - writer_index;
+        }
+    };
+
+    using BlockChain = std::deque<Block>;
 
 public:
     using value_type = char;
 
+    // Iterators of a chained buffer also keep track of the block they are in and their
+    // logical position, and are invalidated once blocks are added or released.
+    // Like pointers into a contiguous buffer, the distance between two iterators stays
+    // intact if data are read in between.
     class Iterator {
     public:
         using iterator_category = std::random_access_iterator_tag;
@@ -72,7 +157,18 @@ public:
         using reference = const value_type&;
 
         explicit Iterator(pointer ptr) noexcept
-            : ptr_(ptr)
+            : ptr_(ptr),
+              blocks_(nullptr),
+              block_idx_(0),
+              pos_(0)
+        {}
+
+        Iterator(const BlockChain* blocks, size_t block_idx, pointer ptr,
+                 difference_type pos) noexcept
+            : ptr_(ptr),
+              blocks_(blocks),
+              block_idx_(block_idx),
+              pos_(pos)
         {}
 
         ~Iterator() = default;
@@ -89,36 +185,82 @@ public:
 
         reference operator[](difference_type n) const noexcept
         {
-            return *(ptr_ + n);
+            if (!blocks_) {
+                return *(ptr_ + n);
+            }
+
+            auto it(*this);
+            it += n;
+            return *it;
         }
 
         Iterator& operator++() noexcept
         {
             ++ptr_;
+            if (blocks_) {
+                ++pos_;
+                SkipBlockEnd();
+            }
+
             return *this;
         }
 
         Iterator& operator--() noexcept
         {
+            if (blocks_) {
+                --pos_;
+                if (ptr_ == (*blocks_)[block_idx_].read_ptr()) {
+                    --block_idx_;
+                    ptr_ = (*blocks_)[block_idx_].write_ptr();
+                }
+            }
+
             --ptr_;
             return *this;
         }
 
         Iterator& operator+=(difference_type n) noexcept
         {
-            ptr_ += n;
+            if (!blocks_) {
+                ptr_ += n;
+                return *this;
+            }
+
+            pos_ += n;
+            if (n >= 0) {
+                while (n > 0) {
+                    auto step = std::min(n, (*blocks_)[block_idx_].write_ptr() - ptr_);
+                    ptr_ += step;
+                    n -= step;
+                    SkipBlockEnd();
+                    if (step == 0) {
+                        break;
+                    }
+                }
+            } else {
+                while (n < 0) {
+                    if (ptr_ == (*blocks_)[block_idx_].read_ptr()) {
+                        --block_idx_;
+                        ptr_ = (*blocks_)[block_idx_].write_ptr();
+                    }
+
+                    auto step = std::min(-n, ptr_ - (*blocks_)[block_idx_].read_ptr());
+                    ptr_ -= step;
+                    n += step;
+                }
+            }
+
             return *this;
         }
 
         Iterator& operator-=(difference_type n) noexcept
         {
-            ptr_ -= n;
-            return *this;
+            return *this += -n;
         }
 
         friend difference_type operator-(Iterator lhs, Iterator rhs) noexcept
         {
-            return lhs.ptr_ - rhs.ptr_;
+            return lhs.blocks_ ? lhs.pos_ - rhs.pos_ : lhs.ptr_ - rhs.ptr_;
         }
 
         friend bool operator==(Iterator lhs, Iterator rhs) noexcept
@@ -131,8 +273,24 @@ public:
             return !(lhs == rhs);
         }
 
+    private:
+        // Moves to the beginning of the next block if we are at the end of a block that
+        // is not the last one holding readable data.
+        void SkipBlockEnd() noexcept
+        {
+            auto next_idx = block_idx_ + 1;
+            if (ptr_ == (*blocks_)[block_idx_].write_ptr() && next_idx < blocks_->size() &&
+                (*blocks_)[next_idx].readable_size() > 0) {
+                block_idx_ = next_idx;
+                ptr_ = (*blocks_)[block_idx_].read_ptr();
+            }
+        }
+
     private:
         pointer ptr_;
+        const BlockChain* blocks_;
+        size_t block_idx_;
+        difference_type pos_;
     };
 
     using const_iterator = Iterator;
@@ -145,23 +303,51 @@ public:
 
     ~Buffer() = default;
 
-    DEFAULT_COPY(Buffer);
+    Buffer(const Buffer& other);
+
+    Buffer& operator=(const Buffer& other);
+
+    // The moved-from buffer is left empty and in the same mode, and still borrows blocks
+    // from its pool, if any.
+    Buffer(Buffer&& other) noexcept;
+
+    Buffer& operator=(Buffer&& other) noexcept;
 
-    DEFAULT_MOVE(Buffer);
+    // Creates a buffer in chained mode, whose blocks are in `block_size` each.
+    // No block is allocated until the first write.
+    static Buffer MakeChained(size_t block_size = kDefaultBlockSize);
+
+    // Creates a buffer in chained mode, whose blocks are borrowed from `pool`.
+    static Buffer MakeChained(BlockPool* pool);
+
+    bool chained() const noexcept
+    {
+        return block_size_ != 0;
+    }
+
+    // Returns true if blocks are borrowed from a BlockPool.
+    bool pooled() const noexcept
+    {
+        return pool_ != nullptr;
+    }
 
     size_t prependable_size() const noexcept
     {
+        if (chained()) {
+            return blocks_.empty() ? 0 : blocks_.front().reader_index;
+        }
+
         return reader_index_;
     }
 
     size_t readable_size() const noexcept
     {
-        return writer_index_ - reader_index_;
+        return chained() ? chain_readable_size_ : writer_index_ - reader_index_;
     }
 
     size_t writable_size() const noexcept
     {
-        return buf_.size() - writer_index_;
+        return chained() ? ChainWritableSize() : buf_.size() - writer_index_;
     }
 
     iterator begin() const noexcept
@@ -171,6 +357,12 @@ public:
 
     const_iterator cbegin() const noexcept
     {
+        if (chained()) {
+            auto head = blocks_.empty() ? nullptr : blocks_.front().read_ptr();
+            return iterator(&blocks_, 0, head,
+                            static_cast<Iterator::difference_type>(chain_consumed_size_));
+        }
+
         return iterator(buf_.data() + reader_index_);
     }
 
@@ -181,9 +373,27 @@ public:
 
     const_iterator cend() const noexcept
     {
+        if (chained()) {
+            return ChainEnd();
+        }
+
         return iterator(buf_.data() + writer_index_);
     }
 
+    // Searching functions below look for the first match in readable content and return
+    // the iterator to it, or cend() if no match found.
+    // They are vectorized if the CPU supports, and matches spanning blocks of a chained
+    // buffer are found as well.
+
+    const_iterator FindByte(char ch) const;
+
+    const_iterator FindCRLF() const;
+
+    // Looks for '\n'.
+    const_iterator FindEOL() const;
+
+    const_iterator Find(kbase::StringView needle) const;
+
     // Writes data bytes into the buffer.
     void Write(const void* data, size_t size);
 
@@ -203,9 +413,48 @@ public:
     }
 
     // Returns pointer to the starting address of readable content.
+    // Readable content of a chained buffer must lie in a single block, e.g. after calling
+    // Linearize().
     const value_type* Peek() const noexcept
     {
-        return &*begin();
+        if (chained()) {
+            ENSURE(CHECK, contiguous_readable_size() == readable_size())
+                (contiguous_readable_size())(readable_size()).Require();
+            return blocks_.empty() ? nullptr : blocks_.front().read_ptr();
+        }
+
+        return buf_.data() + reader_index_;
+    }
+
+    // Makes sure the first `size` readable bytes are contiguous and returns pointer to them.
+    // For a chained buffer, only blocks covering these bytes are gathered if necessary, and
+    // gathering invalidates iterators, e.g. those returned by FindByte() and Find(), and
+    // pointers returned by Peek() or previous Linearize().
+    const value_type* Linearize(size_t size)
+    {
+        ENSURE(CHECK, size <= readable_size())(size)(readable_size()).Require();
+
+        if (chained()) {
+            return ChainLinearize(size);
+        }
+
+        return buf_.data() + reader_index_;
+    }
+
+    // Makes all readable content contiguous, see above.
+    const value_type* Linearize()
+    {
+        return Linearize(readable_size());
+    }
+
+    // Number of readable bytes starting at Peek() that are contiguous without gathering.
+    size_t contiguous_readable_size() const noexcept
+    {
+        if (chained()) {
+            return blocks_.empty() ? 0 : blocks_.front().readable_size();
+        }
+
+        return readable_size();
     }
 
     // Similar to ReadAs() but without consuming data bytes.
@@ -223,10 +472,15 @@ public:
     void Consume(size_t data_size);
 
     // Consumes all readable data in buffer and reset prependable size to the default.
+    // A chained buffer releases all its blocks.
     void ConsumeAll() noexcept
     {
-        reader_index_ = kDefaultPrependSize;
+        // A moved-from contiguous buffer has no room even for prepending.
+        reader_index_ = buf_.empty() ? 0 : kDefaultPrependSize;
         writer_index_ = reader_index_;
+        blocks_.clear();
+        chain_consumed_size_ += chain_readable_size_;
+        chain_readable_size_ = 0;
     }
 
     // Reads an integral value or a floating point value out from the buffer.
@@ -256,17 +510,64 @@ public:
 
     // Returns pointer to the starting address of the writable space.
     // Use this function only when absolute necessary.
+    // For a chained buffer, the space is contiguous only within the current block.
     char* BeginWrite();
 
     // If a write is done by copying data directly to the writable space returned by
-    // BeginWrite(), then this function must be called to complete this data writing.
+    // BeginWrite(), or described by PrepareWritableIOVecs(), then this function must be
+    // called to complete this data writing.
     void EndWrite(size_t written_size);
 
     // If writable size is not less than `new_size`, this function does nothing.
     // Otherwise, it will make sure there is enough writable space for `new_size` bytes.
+    // A chained buffer appends blocks as needed and never moves readable content.
     void ReserveWritable(size_t new_size);
 
+#if defined(OS_POSIX)
+
+    // Fills `vecs` with at most `max_count` regions of readable content, in order, and
+    // returns the number of entries filled.
+    size_t PeekIOVecs(iovec* vecs, size_t max_count) const;
+
+    // Makes sure there is writable space for at least `size` bytes, and fills `vecs` with
+    // at most `max_count` regions of the writable space, in order.
+    // Returns the number of entries filled.
+    size_t PrepareWritableIOVecs(size_t size, iovec* vecs, size_t max_count);
+
+#endif
+
 private:
+    Buffer(size_t block_size, BlockPool* pool);
+
+    void ResetMovedFrom() noexcept;
+
+    // Copies first `size` readable bytes into `dest` without consuming them.
+    void CopyOut(void* dest, size_t size) const;
+
+    // Index of the block in which new data bytes go.
+    size_t ChainWriteBlockIndex() const noexcept;
+
+    size_t ChainWritableSize() const noexcept;
+
+    Iterator ChainEnd() const noexcept;
+
+    // Returns true if readable content starting at `ptr` in the block `block_idx` begins
+    // with `needle`.
+    bool ChainMatchAt(size_t block_idx, const value_type* ptr,
+                      kbase::StringView needle) const noexcept;
+
+    const value_type* ChainLinearize(size_t size);
+
+    void ChainWrite(const void* data, size_t size);
+
+    void ChainConsume(size_t data_size);
+
+    void ChainReserveWritable(size_t new_size);
+
+    void ChainEndWrite(size_t written_size);
+
+    Block& AppendBlock();
+
     template<typename T>
     void WriteImpl(T value, internal::single_byte)
     {
@@ -296,7 +597,8 @@ private:
     {
         static_assert(sizeof(T) == 1, "Require sizeof(T) == 1");
         ENSURE(CHECK, readable_size() >= sizeof(T))(readable_size()).Require();
-        T n = *reinterpret_cast<const T*>(Peek());
+        T n;
+        CopyOut(&n, sizeof(n));
         return n;
     }
 
@@ -306,7 +608,7 @@ private:
         static_assert(sizeof(I) > 1, "Require sizeof(I) > 1");
         ENSURE(CHECK, readable_size() >= sizeof(I))(readable_size())(sizeof(I)).Require();
         I be;
-        memcpy(&be, Peek(), sizeof(be));
+        CopyOut(&be, sizeof(be));
         return NetworkToHost(be);
     }
 
@@ -325,6 +627,14 @@ private:
     std::vector<value_type> buf_;
     size_t reader_index_;
     size_t writer_index_;
+
+    // Used only in chained mode; 0 block size indicates the contiguous mode.
+    size_t block_size_;
+    BlockChain blocks_;
+    size_t chain_readable_size_;
+    // Logical position of the first readable byte, from which iterators count.
+    size_t chain_consumed_size_;
+    BlockPool* pool_;
 };
 
 using Iterator = Buffer::Iterator;
@@ -370,6 +680,14 @@ inline bool operator>=(Iterator lhs, Iterator rhs)
 
 #if defined(OS_POSIX)
 
+// Reads data from `fd` straight into `buf`, with writable space for `recv_size` bytes at
+// least prepared, and at most `recv_size` bytes read into it.
+// If `spill` is not null, the read also scatters into it, in case more data than expected
+// are available, and data bytes landed there are then appended to `buf`.
+ssize_t ReadFDInVec(int fd, Buffer& buf, size_t recv_size, char* spill, size_t spill_size);
+
+// Reads data from `fd` into the writable space of `buf`, with a 64KB stack buffer as the
+// spill area.
 ssize_t ReadFDInVec(int fd, Buffer& buf);
 
 #endif
@@ -4,36 +4,106 @@
 
 #include "ezio/buffer.h"
 
-#include <sys/uio.h>
+#include <algorithm>
+
+namespace {
+
+constexpr size_t kMaxReadVecCount = 64;
+constexpr size_t kExtraBufSize = 65535;
+
+}   // namespace
 
 namespace ezio {
 
-ssize_t ReadFDInVec(int fd, Buffer& buf)
+size_t Buffer::PeekIOVecs(iovec* vecs, size_t max_count) const
 {
-    constexpr size_t kExtraBufSize = 65535;
-    char extra_buf[kExtraBufSize];
+    if (max_count == 0 || readable_size() == 0) {
+        return 0;
+    }
+
+    if (!chained()) {
+        vecs[0].iov_base = const_cast<char*>(buf_.data() + reader_index_);
+        vecs[0].iov_len = readable_size();
+        return 1;
+    }
 
-    iovec vec[2];
-    vec[0].iov_base = buf.BeginWrite();
-    vec[0].iov_len = buf.writable_size();
-    vec[1].iov_base = extra_buf;
-    vec[1].iov_len = kExtraBufSize;
+    size_t count = 0;
+    for (auto it = blocks_.cbegin(); it != blocks_.cend() && count < max_count; ++it) {
+        if (it->readable_size() == 0) {
+            break;
+        }
 
-    auto used_vec_cnt = buf.writable_size() < kExtraBufSize ? 2 : 1;
-    auto size_read = readv(fd, vec, used_vec_cnt);
+        vecs[count].iov_base = const_cast<char*>(it->read_ptr());
+        vecs[count].iov_len = it->readable_size();
+        ++count;
+    }
+
+    return count;
+}
+
+size_t Buffer::PrepareWritableIOVecs(size_t size, iovec* vecs, size_t max_count)
+{
+    ReserveWritable(size);
+
+    if (max_count == 0) {
+        return 0;
+    }
+
+    if (!chained()) {
+        vecs[0].iov_base = BeginWrite();
+        vecs[0].iov_len = writable_size();
+        return 1;
+    }
+
+    size_t count = 0;
+    for (auto idx = ChainWriteBlockIndex(); idx < blocks_.size() && count < max_count; ++idx) {
+        vecs[count].iov_base = blocks_[idx].write_ptr();
+        vecs[count].iov_len = blocks_[idx].writable_size();
+        ++count;
+    }
+
+    return count;
+}
+
+ssize_t ReadFDInVec(int fd, Buffer& buf, size_t recv_size, char* spill, size_t spill_size)
+{
+    iovec vec[kMaxReadVecCount];
+    auto prepared_cnt = buf.PrepareWritableIOVecs(recv_size, vec, kMaxReadVecCount - 1);
+
+    // Writable space may go beyond `recv_size`, e.g. the whole capacity of a contiguous
+    // buffer, while callers rely on the cap, e.g. for the read budget.
+    size_t vec_cnt = 0;
+    size_t writable = 0;
+    for (; vec_cnt < prepared_cnt && writable < recv_size; ++vec_cnt) {
+        vec[vec_cnt].iov_len = std::min(vec[vec_cnt].iov_len, recv_size - writable);
+        writable += vec[vec_cnt].iov_len;
+    }
+
+    if (spill && spill_size > 0) {
+        vec[vec_cnt].iov_base = spill;
+        vec[vec_cnt].iov_len = spill_size;
+        ++vec_cnt;
+    }
+
+    auto size_read = readv(fd, vec, static_cast<int>(vec_cnt));
     if (size_read < 0) {
         return -1;
     }
 
-    if (static_cast<size_t>(size_read) <= buf.writable_size()) {
+    if (static_cast<size_t>(size_read) <= writable) {
         buf.EndWrite(static_cast<size_t>(size_read));
     } else {
-        auto writable = buf.writable_size();
         buf.EndWrite(writable);
-        buf.Write(extra_buf, size_read - writable);
+        buf.Write(spill, size_read - writable);
     }
 
     return size_read;
 }
 
+ssize_t ReadFDInVec(int fd, Buffer& buf)
+{
+    char extra_buf[kExtraBufSize];
+    return ReadFDInVec(fd, buf, buf.writable_size(), extra_buf, sizeof(extra_buf));
+}
+
 }   // namespace ezio
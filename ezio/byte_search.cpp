@@ -0,0 +1,391 @@
+/*
+ @ 0xCCCCCCCC
+*/
+
+#include "ezio/byte_search.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#include <immintrin.h>
+#define EZIO_X86_SIMD
+#define EZIO_TARGET_AVX2
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__SSE2__))
+#include <immintrin.h>
+#define EZIO_X86_SIMD
+#define EZIO_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace {
+
+using ezio::internal::SearchImpl;
+
+using FindByteFunc = const char* (*)(const char*, const char*, char);
+using FindBytesFunc = const char* (*)(const char*, const char*, const char*, size_t);
+
+const char* FindByteScalar(const char* first, const char* last, char ch)
+{
+    if (first == last) {
+        return nullptr;
+    }
+
+    return static_cast<const char*>(memchr(first, ch, static_cast<size_t>(last - first)));
+}
+
+const char* FindBytesScalar(const char* first, const char* last, const char* needle,
+                            size_t needle_size)
+{
+    while (static_cast<size_t>(last - first) >= needle_size) {
+        auto candidate = FindByteScalar(first, last - needle_size + 1, needle[0]);
+        if (!candidate) {
+            return nullptr;
+        }
+
+        if (memcmp(candidate + 1, needle + 1, needle_size - 1) == 0) {
+            return candidate;
+        }
+
+        first = candidate + 1;
+    }
+
+    return nullptr;
+}
+
+#if defined(EZIO_X86_SIMD)
+
+constexpr ptrdiff_t kMinFilterWindowSize = 128;
+constexpr ptrdiff_t kMaxFilterWindowSize = 4096;
+
+// The first byte of the needle is considered frequent if a jump barely moves, then windows
+// get larger to avoid jumping too often.
+inline ptrdiff_t NextFilterWindowSize(ptrdiff_t jumped, ptrdiff_t window_size) noexcept
+{
+    return jumped < window_size ? std::min(window_size * 2, kMaxFilterWindowSize) :
+                                  kMinFilterWindowSize;
+}
+
+inline unsigned CountTrailingZeros(uint32_t mask) noexcept
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+}
+
+// Returns the first address after `ptr` aligned to `alignment`.
+inline const char* NextAligned(const char* ptr, ptrdiff_t alignment) noexcept
+{
+    auto addr = reinterpret_cast<uintptr_t>(ptr) + static_cast<uintptr_t>(alignment);
+    return reinterpret_cast<const char*>(addr & ~static_cast<uintptr_t>(alignment - 1));
+}
+
+// Locates the first set bit among masks of 4 consecutive vectors in `width` bytes each.
+inline const char* LocateInMasks(const char* base, ptrdiff_t width, uint32_t m0, uint32_t m1,
+                                 uint32_t m2, uint32_t m3) noexcept
+{
+    if (m0 != 0) {
+        return base + CountTrailingZeros(m0);
+    }
+
+    if (m1 != 0) {
+        return base + width + CountTrailingZeros(m1);
+    }
+
+    if (m2 != 0) {
+        return base + 2 * width + CountTrailingZeros(m2);
+    }
+
+    return base + 3 * width + CountTrailingZeros(m3);
+}
+
+const char* FindByteSSE2(const char* first, const char* last, char ch)
+{
+    constexpr ptrdiff_t kWidth = sizeof(__m128i);
+    auto pattern = _mm_set1_epi8(ch);
+    if (last - first < kWidth) {
+        return FindByteScalar(first, last, ch);
+    }
+
+    // Checks the first vector as it is, and then moves on with aligned loads; bytes checked
+    // twice don't matter.
+    auto head = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+    auto head_mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(head, pattern)));
+    if (head_mask != 0) {
+        return first + CountTrailingZeros(head_mask);
+    }
+
+    first = NextAligned(first, kWidth);
+
+    // Checks 4 vectors at once, and then locates the match if any.
+    for (; last - first >= 4 * kWidth; first += 4 * kWidth) {
+        auto p = reinterpret_cast<const __m128i*>(first);
+        auto eq0 = _mm_cmpeq_epi8(_mm_load_si128(p), pattern);
+        auto eq1 = _mm_cmpeq_epi8(_mm_load_si128(p + 1), pattern);
+        auto eq2 = _mm_cmpeq_epi8(_mm_load_si128(p + 2), pattern);
+        auto eq3 = _mm_cmpeq_epi8(_mm_load_si128(p + 3), pattern);
+        auto any = _mm_or_si128(_mm_or_si128(eq0, eq1), _mm_or_si128(eq2, eq3));
+        if (_mm_movemask_epi8(any) != 0) {
+            return LocateInMasks(first, kWidth,
+                                 static_cast<uint32_t>(_mm_movemask_epi8(eq0)),
+                                 static_cast<uint32_t>(_mm_movemask_epi8(eq1)),
+                                 static_cast<uint32_t>(_mm_movemask_epi8(eq2)),
+                                 static_cast<uint32_t>(_mm_movemask_epi8(eq3)));
+        }
+    }
+
+    for (; last - first >= kWidth; first += kWidth) {
+        auto chunk = _mm_load_si128(reinterpret_cast<const __m128i*>(first));
+        auto mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, pattern)));
+        if (mask != 0) {
+            return first + CountTrailingZeros(mask);
+        }
+    }
+
+    return FindByteScalar(first, last, ch);
+}
+
+// Jumps to the next occurrence of the first byte of the needle, and then filters candidates
+// in a window by comparing both the first and the last byte in a batch; candidates passed
+// are verified one by one.
+// Jumping is much faster when the first byte is rare, while filtering wins when it is not.
+const char* FindBytesSSE2(const char* first, const char* last, const char* needle,
+                          size_t needle_size)
+{
+    if (needle_size == 1) {
+        return FindByteSSE2(first, last, needle[0]);
+    }
+
+    constexpr ptrdiff_t kWidth = sizeof(__m128i);
+    auto tail = static_cast<ptrdiff_t>(needle_size - 1);
+    auto head_pattern = _mm_set1_epi8(needle[0]);
+    auto tail_pattern = _mm_set1_epi8(needle[tail]);
+    auto window_size = kMinFilterWindowSize;
+    while (last - first >= kWidth + tail) {
+        auto next = FindByteSSE2(first, last - tail, needle[0]);
+        if (!next) {
+            return nullptr;
+        }
+
+        window_size = NextFilterWindowSize(next - first, window_size);
+        first = next;
+
+        auto window_end = first + window_size;
+        for (; first < window_end && last - first >= kWidth + tail; first += kWidth) {
+            auto heads = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+            auto tails = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first + tail));
+            auto eq = _mm_and_si128(_mm_cmpeq_epi8(heads, head_pattern),
+                                    _mm_cmpeq_epi8(tails, tail_pattern));
+            auto mask = static_cast<uint32_t>(_mm_movemask_epi8(eq));
+            while (mask != 0) {
+                auto candidate = first + CountTrailingZeros(mask);
+                if (memcmp(candidate + 1, needle + 1, needle_size - 2) == 0) {
+                    return candidate;
+                }
+
+                mask &= mask - 1;
+            }
+        }
+    }
+
+    return FindBytesScalar(first, last, needle, needle_size);
+}
+
+EZIO_TARGET_AVX2
+const char* FindByteAVX2(const char* first, const char* last, char ch)
+{
+    constexpr ptrdiff_t kWidth = sizeof(__m256i);
+    auto pattern = _mm256_set1_epi8(ch);
+    if (last - first < kWidth) {
+        return FindByteSSE2(first, last, ch);
+    }
+
+    auto head = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first));
+    auto head_mask = static_cast<uint32_t>(
+        _mm256_movemask_epi8(_mm256_cmpeq_epi8(head, pattern)));
+    if (head_mask != 0) {
+        return first + CountTrailingZeros(head_mask);
+    }
+
+    first = NextAligned(first, kWidth);
+
+    for (; last - first >= 4 * kWidth; first += 4 * kWidth) {
+        auto p = reinterpret_cast<const __m256i*>(first);
+        auto eq0 = _mm256_cmpeq_epi8(_mm256_load_si256(p), pattern);
+        auto eq1 = _mm256_cmpeq_epi8(_mm256_load_si256(p + 1), pattern);
+        auto eq2 = _mm256_cmpeq_epi8(_mm256_load_si256(p + 2), pattern);
+        auto eq3 = _mm256_cmpeq_epi8(_mm256_load_si256(p + 3), pattern);
+        auto any = _mm256_or_si256(_mm256_or_si256(eq0, eq1), _mm256_or_si256(eq2, eq3));
+        if (_mm256_movemask_epi8(any) != 0) {
+            return LocateInMasks(first, kWidth,
+                                 static_cast<uint32_t>(_mm256_movemask_epi8(eq0)),
+                                 static_cast<uint32_t>(_mm256_movemask_epi8(eq1)),
+                                 static_cast<uint32_t>(_mm256_movemask_epi8(eq2)),
+                                 static_cast<uint32_t>(_mm256_movemask_epi8(eq3)));
+        }
+    }
+
+    for (; last - first >= kWidth; first += kWidth) {
+        auto chunk = _mm256_load_si256(reinterpret_cast<const __m256i*>(first));
+        auto mask = static_cast<uint32_t>(
+            _mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, pattern)));
+        if (mask != 0) {
+            return first + CountTrailingZeros(mask);
+        }
+    }
+
+    return FindByteSSE2(first, last, ch);
+}
+
+EZIO_TARGET_AVX2
+const char* FindBytesAVX2(const char* first, const char* last, const char* needle,
+                          size_t needle_size)
+{
+    if (needle_size == 1) {
+        return FindByteAVX2(first, last, needle[0]);
+    }
+
+    constexpr ptrdiff_t kWidth = sizeof(__m256i);
+    auto tail = static_cast<ptrdiff_t>(needle_size - 1);
+    auto head_pattern = _mm256_set1_epi8(needle[0]);
+    auto tail_pattern = _mm256_set1_epi8(needle[tail]);
+    auto window_size = kMinFilterWindowSize;
+    while (last - first >= kWidth + tail) {
+        auto next = FindByteAVX2(first, last - tail, needle[0]);
+        if (!next) {
+            return nullptr;
+        }
+
+        window_size = NextFilterWindowSize(next - first, window_size);
+        first = next;
+
+        auto window_end = first + window_size;
+        for (; first < window_end && last - first >= kWidth + tail; first += kWidth) {
+            auto heads = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first));
+            auto tails = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first + tail));
+            auto eq = _mm256_and_si256(_mm256_cmpeq_epi8(heads, head_pattern),
+                                       _mm256_cmpeq_epi8(tails, tail_pattern));
+            auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(eq));
+            while (mask != 0) {
+                auto candidate = first + CountTrailingZeros(mask);
+                if (memcmp(candidate + 1, needle + 1, needle_size - 2) == 0) {
+                    return candidate;
+                }
+
+                mask &= mask - 1;
+            }
+        }
+    }
+
+    return FindBytesSSE2(first, last, needle, needle_size);
+}
+
+bool CPUSupportsAVX2() noexcept
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return false;
+    }
+
+    // OS must save YMM registers on context switches.
+    __cpuid(info, 1);
+    constexpr int kOSXSave = 1 << 27;
+    constexpr int kAVX = 1 << 28;
+    if ((info[2] & kOSXSave) == 0 || (info[2] & kAVX) == 0 || (_xgetbv(0) & 0x6) != 0x6) {
+        return false;
+    }
+
+    __cpuidex(info, 7, 0);
+    constexpr int kAVX2 = 1 << 5;
+    return (info[1] & kAVX2) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+
+#endif  // EZIO_X86_SIMD
+
+struct SearchFuncs {
+    SearchImpl impl;
+    FindByteFunc find_byte;
+    FindBytesFunc find_bytes;
+};
+
+SearchFuncs MakeSearchFuncs(SearchImpl impl) noexcept
+{
+    switch (impl) {
+#if defined(EZIO_X86_SIMD)
+        case SearchImpl::AVX2:
+            return {SearchImpl::AVX2, FindByteAVX2, FindBytesAVX2};
+
+        case SearchImpl::SSE2:
+            return {SearchImpl::SSE2, FindByteSSE2, FindBytesSSE2};
+#endif
+
+        default:
+            return {SearchImpl::Scalar, FindByteScalar, FindBytesScalar};
+    }
+}
+
+SearchImpl BestSearchImpl() noexcept
+{
+#if defined(EZIO_X86_SIMD)
+    return CPUSupportsAVX2() ? SearchImpl::AVX2 : SearchImpl::SSE2;
+#else
+    return SearchImpl::Scalar;
+#endif
+}
+
+SearchFuncs& ActiveSearchFuncs() noexcept
+{
+    static SearchFuncs funcs = MakeSearchFuncs(BestSearchImpl());
+    return funcs;
+}
+
+}   // namespace
+
+namespace ezio {
+namespace internal {
+
+const char* FindByte(const char* first, const char* last, char ch) noexcept
+{
+    return ActiveSearchFuncs().find_byte(first, last, ch);
+}
+
+const char* FindBytes(const char* first, const char* last, const char* needle,
+                      size_t needle_size) noexcept
+{
+    return ActiveSearchFuncs().find_bytes(first, last, needle, needle_size);
+}
+
+bool IsSearchImplSupported(SearchImpl impl) noexcept
+{
+    return static_cast<int>(impl) <= static_cast<int>(BestSearchImpl());
+}
+
+SearchImpl ActiveSearchImpl() noexcept
+{
+    return ActiveSearchFuncs().impl;
+}
+
+bool UseSearchImpl(SearchImpl impl) noexcept
+{
+    if (!IsSearchImplSupported(impl)) {
+        return false;
+    }
+
+    ActiveSearchFuncs() = MakeSearchFuncs(impl);
+
+    return true;
+}
+
+}   // namespace internal
+}   // namespace ezio
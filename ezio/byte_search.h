@@ -0,0 +1,42 @@
+/*
+ @ 0xCCCCCCCC
+*/
+
+#ifndef EZIO_BYTE_SEARCH_H_
+#define EZIO_BYTE_SEARCH_H_
+
+#include <cstddef>
+
+namespace ezio {
+namespace internal {
+
+// Implementations of byte searching, from the slowest to the fastest.
+// The fastest one the CPU supports is selected at runtime.
+enum class SearchImpl {
+    Scalar,
+    SSE2,
+    AVX2
+};
+
+// Returns the pointer to the first occurrence of `ch` in [first, last), or nullptr if not
+// found.
+const char* FindByte(const char* first, const char* last, char ch) noexcept;
+
+// Returns the pointer to the first occurrence of the `needle` in [first, last), or nullptr
+// if not found.
+// `needle_size` must be greater than 0.
+const char* FindBytes(const char* first, const char* last, const char* needle,
+                      size_t needle_size) noexcept;
+
+bool IsSearchImplSupported(SearchImpl impl) noexcept;
+
+SearchImpl ActiveSearchImpl() noexcept;
+
+// Switches to `impl` if it is supported by the CPU; returns false otherwise.
+// Used by tests and benchmarks only, and this function is not thread-safe.
+bool UseSearchImpl(SearchImpl impl) noexcept;
+
+}   // namespace internal
+}   // namespace ezio
+
+#endif  // EZIO_BYTE_SEARCH_H_
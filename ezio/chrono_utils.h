@@ -7,6 +7,10 @@
 
 #include <chrono>
 
+#if defined(OS_POSIX)
+#include <time.h>
+#endif
+
 namespace ezio {
 
 #if defined(OS_POSIX)
@@ -15,7 +19,9 @@ using TimeDuration = std::chrono::microseconds;
 using TimeDuration = std::chrono::milliseconds;
 #endif
 
-using TimePoint = std::chrono::time_point<std::chrono::system_clock, TimeDuration>;
+// TimePoint is on the monotonic clock, thus timers are immune to steps of the wall clock.
+// On Linux, std::chrono::steady_clock reads CLOCK_MONOTONIC, which timer-fd is armed on.
+using TimePoint = std::chrono::time_point<std::chrono::steady_clock, TimeDuration>;
 
 template<typename From>
 TimePoint ToTimePoint(const From& tp)
@@ -23,6 +29,39 @@ TimePoint ToTimePoint(const From& tp)
     return std::chrono::time_point_cast<TimePoint::duration>(tp);
 }
 
+inline TimePoint MonotonicNow()
+{
+    return ToTimePoint(std::chrono::steady_clock::now());
+}
+
+// Reads CLOCK_MONOTONIC_COARSE on Linux, which skips the hardware clock at the resolution
+// of a scheduler tick, i.e. 1 to 4 ms; reads the precise clock elsewhere.
+inline TimePoint CoarseMonotonicNow()
+{
+#if defined(OS_POSIX)
+    timespec ts {};
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return TimePoint(std::chrono::duration_cast<TimeDuration>(
+        std::chrono::seconds(ts.tv_sec) + std::chrono::nanoseconds(ts.tv_nsec)));
+#else
+    return MonotonicNow();
+#endif
+}
+
+// Wall-clock time points are converted by their distance from now.
+template<typename Duration>
+TimePoint ToTimePoint(const std::chrono::time_point<std::chrono::system_clock, Duration>& tp)
+{
+    return MonotonicNow() +
+           std::chrono::duration_cast<TimeDuration>(tp - std::chrono::system_clock::now());
+}
+
+inline std::chrono::system_clock::time_point ToSystemTime(TimePoint tp)
+{
+    return std::chrono::system_clock::now() +
+           std::chrono::duration_cast<std::chrono::system_clock::duration>(tp - MonotonicNow());
+}
+
 }   // namespace ezio
 
 #endif  // EZIO_CHRONO_UTILS_H_
@@ -21,6 +21,9 @@ using ConnectionEventHandler = std::function<void(const TCPConnectionPtr&)>;
 using CloseEventHandler = std::function<void(const TCPConnectionPtr&)>;
 using DestroyEventHandler = std::function<void(const TCPConnectionPtr&)>;
 using MessageEventHandler = std::function<void(const TCPConnectionPtr&, Buffer&, TimePoint)>;
+using FileSentEventHandler = std::function<void(const TCPConnectionPtr&, bool completed)>;
+using HighWaterMarkEventHandler = std::function<void(const TCPConnectionPtr&, size_t queued_size)>;
+using WriteCompleteEventHandler = std::function<void(const TCPConnectionPtr&)>;
 
 }   // namespace ezio
 
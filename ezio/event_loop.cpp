@@ -20,6 +20,13 @@ constexpr auto kPumpTimeout = std::chrono::seconds(10);
 
 namespace ezio {
 
+constexpr size_t EventLoop::kRecvSpillAreaSize;
+constexpr size_t EventLoop::kMaxCachedPendingTasks;
+
+#if defined(OS_POSIX)
+constexpr size_t EventLoop::kMaxWriteVecCount;
+#endif
+
 thread_local EventLoop* tls_loop_in_thread {nullptr};
 
 EventLoop::EventLoop()
@@ -27,7 +34,15 @@ EventLoop::EventLoop()
       owner_thread_id_(this_thread::GetID()),
       event_pump_(this),
       timer_queue_(this),
-      executing_pending_task_(false)
+#if defined(OS_POSIX)
+      zerocopy_graveyard_(this),
+#endif
+      coarse_clock_(false),
+      now_(MonotonicNow()),
+      waiting_for_events_(false),
+      wakeup_count_(0),
+      free_pending_tasks_(nullptr),
+      busy_poll_window_(0)
 {
     ENSURE(CHECK, tls_loop_in_thread == nullptr).Require();
     tls_loop_in_thread = this;
@@ -37,6 +52,20 @@ EventLoop::~EventLoop()
 {
     ENSURE(CHECK, tls_loop_in_thread != nullptr).Require();
     tls_loop_in_thread = nullptr;
+
+    auto pending = free_pending_tasks_.exchange(nullptr, std::memory_order_acquire);
+    while (pending) {
+        std::unique_ptr<PendingTask> node(pending);
+        pending = pending->next_free;
+    }
+}
+
+EventLoop::PendingTaskCache::~PendingTaskCache()
+{
+    while (head) {
+        std::unique_ptr<PendingTask> node(head);
+        head = head->next_free;
+    }
 }
 
 void EventLoop::Run()
@@ -48,7 +77,7 @@ void EventLoop::Run()
 
     is_running_.store(true, std::memory_order_release);
     while (is_running_.load(std::memory_order_acquire)) {
-        auto pumped_time = event_pump_.Pump(GetPumpTimeout(), active_notifications);
+        auto pumped_time = PumpEvents(active_notifications);
 
         // We handle expired timers right here on Windows, while they are handled on Linux
         // inside timer_fd notifier.
@@ -60,7 +89,13 @@ void EventLoop::Run()
             item.first->HandleEvent(pumped_time, item.second);
         }
 
-        ProcessPendingTasks();
+        auto task_count = ProcessPendingTasks();
+
+        ProcessIterationEndTasks();
+
+        if (busy_poll_window_.count() > 0 && (!active_notifications.empty() || task_count > 0)) {
+            last_active_time_ = now_;
+        }
 
         active_notifications.clear();
     }
@@ -90,10 +125,32 @@ void EventLoop::RunTask(Task task)
     }
 }
 
+void EventLoop::RunAtIterationEnd(Task task)
+{
+    ENSURE(CHECK, BelongsToCurrentThread()).Require();
+    iteration_end_tasks_.push_back(std::move(task));
+}
+
+TimePoint EventLoop::Now() const
+{
+    if (BelongsToCurrentThread() && is_running_.load(std::memory_order_relaxed)) {
+        return now_;
+    }
+
+    return MonotonicNow();
+}
+
+void EventLoop::SetCoarseClock(bool enable)
+{
+    RunTask([this, enable] {
+        coarse_clock_ = enable;
+    });
+}
+
 TimerID EventLoop::RunTaskAfter(Task task, TimeDuration delay)
 {
     return timer_queue_.AddTimer(std::move(task),
-                                 ToTimePoint(std::chrono::system_clock::now()) + delay,
+                                 Now() + delay,
                                  TimeDuration::zero());
 }
 
@@ -107,7 +164,7 @@ TimerID EventLoop::RunTaskAt(Task task, TimePoint when)
 TimerID EventLoop::RunTaskEvery(Task task, TimeDuration interval)
 {
     return timer_queue_.AddTimer(std::move(task),
-                                 ToTimePoint(std::chrono::system_clock::now()) + interval,
+                                 Now() + interval,
                                  interval);
 }
 
@@ -116,14 +173,93 @@ void EventLoop::CancelTimedTask(TimerID timer_id)
     timer_queue_.Cancel(timer_id);
 }
 
+void EventLoop::SetBusyPollWindow(std::chrono::microseconds window)
+{
+    RunTask([this, window] {
+        busy_poll_window_ = window;
+    });
+}
+
+void EventLoop::SetIterationBudget(const IterationBudget& budget)
+{
+    RunTask([this, budget] {
+        iteration_budget_ = budget;
+    });
+}
+
+char* EventLoop::recv_spill_area()
+{
+    if (!recv_spill_area_) {
+        recv_spill_area_ = std::make_unique<char[]>(kRecvSpillAreaSize);
+    }
+
+    return recv_spill_area_.get();
+}
+
+#if defined(OS_POSIX)
+iovec* EventLoop::write_vecs()
+{
+    if (!write_vecs_) {
+        write_vecs_ = std::make_unique<iovec[]>(kMaxWriteVecCount);
+    }
+
+    return write_vecs_.get();
+}
+#endif
+
+std::unique_ptr<EventLoop::PendingTask> EventLoop::AcquirePendingTask()
+{
+    // Nodes are allocated the same way for every loop, thus those cached may go to any.
+    thread_local PendingTaskCache cache;
+
+    if (!cache.head) {
+        auto pending = free_pending_tasks_.exchange(nullptr, std::memory_order_acquire);
+        size_t cached_count = 0;
+        while (pending) {
+            std::unique_ptr<PendingTask> node(pending);
+            pending = pending->next_free;
+            if (cached_count < kMaxCachedPendingTasks) {
+                node->next_free = cache.head;
+                cache.head = node.release();
+                ++cached_count;
+            }
+        }
+    }
+
+    if (!cache.head) {
+        return std::make_unique<PendingTask>();
+    }
+
+    std::unique_ptr<PendingTask> node(cache.head);
+    cache.head = node->next_free;
+    node->next_free = nullptr;
+
+    return node;
+}
+
+void EventLoop::RecyclePendingTask(std::unique_ptr<PendingTask> pending) noexcept
+{
+    auto node = pending.release();
+    node->next_free = free_pending_tasks_.load(std::memory_order_relaxed);
+    while (!free_pending_tasks_.compare_exchange_weak(node->next_free, node,
+                                                      std::memory_order_release,
+                                                      std::memory_order_relaxed)) {}
+}
+
 void EventLoop::QueueTask(Task task)
 {
-    {
-        std::lock_guard<std::mutex> lock(task_queue_mutex_);
-        task_queue_.push_back(std::move(task));
+    auto pending = AcquirePendingTask();
+    pending->task = std::move(task);
+
+    if (!task_queue_.Push(std::move(pending))) {
+        // Whoever made the queue non-empty has taken care of the wakeup.
+        return;
     }
 
-    if (!BelongsToCurrentThread() || executing_pending_task_) {
+    // Pairs with the fence in PumpEvents(): either we see the loop waiting, or the loop
+    // sees our task before it starts to wait.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiting_for_events_.load(std::memory_order_relaxed)) {
         Wakeup();
     }
 }
@@ -148,7 +284,7 @@ std::chrono::milliseconds EventLoop::GetPumpTimeout() const
         return kPumpTimeout;
     }
 
-    auto now = ToTimePoint(std::chrono::system_clock::now());
+    auto now = ReadClock();
     auto timeout = expiration.second - now;
     if (timeout < TimeDuration::zero()) {
         LOG(WARNING) << "Negative timeout; next expiration: "
@@ -161,20 +297,89 @@ std::chrono::milliseconds EventLoop::GetPumpTimeout() const
 #endif
 }
 
-void EventLoop::ProcessPendingTasks()
+TimePoint EventLoop::PumpEvents(std::vector<IONotification>& active_notifications)
 {
-    executing_pending_task_ = true;
-    ON_SCOPE_EXIT { executing_pending_task_ = false; };
+    // Producers needn't wake up a spinning loop.
+    if (IsInBusyPollWindow()) {
+        ++busy_poll_stats_.spins;
+        event_pump_.Pump(std::chrono::milliseconds::zero(), active_notifications);
+        now_ = ReadClock();
+        if (!active_notifications.empty() || !task_queue_.empty()) {
+            ++busy_poll_stats_.useful_spins;
+        }
+
+        return now_;
+    }
 
-    decltype(task_queue_) pending_tasks;
+    waiting_for_events_.store(true, std::memory_order_relaxed);
+    ON_SCOPE_EXIT { waiting_for_events_.store(false, std::memory_order_relaxed); };
 
-    {
-        std::lock_guard<std::mutex> lock(task_queue_mutex_);
-        pending_tasks.swap(task_queue_);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    // Tasks queued while we were busy came with no wakeup; only poll for events then.
+    auto timeout = task_queue_.empty() ? GetPumpTimeout() : std::chrono::milliseconds::zero();
+    if (timeout.count() > 0) {
+        ++busy_poll_stats_.blocking_waits;
     }
 
-    for (auto& task : pending_tasks) {
-        task();
+    event_pump_.Pump(timeout, active_notifications);
+    now_ = ReadClock();
+
+    return now_;
+}
+
+bool EventLoop::IsInBusyPollWindow() const
+{
+    // Measured until the last pump returned, which saves reading the clock.
+    return busy_poll_window_.count() > 0 && now_ - last_active_time_ < busy_poll_window_;
+}
+
+size_t EventLoop::ProcessPendingTasks()
+{
+    auto run_task = [this](std::unique_ptr<PendingTask> pending) {
+        pending->task();
+        // Captures of the task are released here rather than by whoever reuses the node.
+        pending->task = nullptr;
+        RecyclePendingTask(std::move(pending));
+    };
+
+    // Tasks queued by these tasks are left for the next iteration.
+    if (iteration_budget_.max_tasks == 0 && iteration_budget_.max_time.count() == 0) {
+        return task_queue_.ConsumeAll(run_task);
+    }
+
+    // At least one task runs, thus tasks make progress however long events took.
+    size_t nth_task = 0;
+    return task_queue_.ConsumeWhile(run_task, [this, &nth_task] {
+        return ++nth_task == 1 || HasTaskBudgetFor(nth_task);
+    });
+}
+
+bool EventLoop::HasTaskBudgetFor(size_t nth_task)
+{
+    if (iteration_budget_.max_tasks > 0 && nth_task > iteration_budget_.max_tasks) {
+        ++budget_stats_.task_budget_hits;
+        return false;
+    }
+
+    if (iteration_budget_.max_time.count() > 0 &&
+        ReadClock() - now_ >= iteration_budget_.max_time) {
+        ++budget_stats_.time_budget_hits;
+        return false;
+    }
+
+    return true;
+}
+
+void EventLoop::ProcessIterationEndTasks()
+{
+    while (!iteration_end_tasks_.empty()) {
+        decltype(iteration_end_tasks_) tasks;
+        tasks.swap(iteration_end_tasks_);
+
+        for (auto& task : tasks) {
+            task();
+        }
     }
 }
 
@@ -6,24 +6,75 @@
 #define EZIO_EVENT_LOOP_H_
 
 #include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <functional>
-#include <mutex>
+#include <memory>
 #include <vector>
 
 #include "kbase/basic_macros.h"
 
+#include "ezio/block_pool.h"
 #include "ezio/chrono_utils.h"
 #include "ezio/event_pump.h"
+#include "ezio/mpsc_queue.h"
+#include "ezio/task.h"
 #include "ezio/this_thread.h"
 #include "ezio/timer_queue.h"
 
+#if defined(OS_POSIX)
+#include <climits>
+
+#include <sys/uio.h>
+
+#include "ezio/zerocopy_graveyard.h"
+#endif
+
 namespace ezio {
 
 class Notifier;
 
 class EventLoop {
 public:
-    using Task = std::function<void()>;
+    using Task = ezio::Task;
+
+    static constexpr size_t kRecvSpillAreaSize = 64 * 1024;
+
+#if defined(OS_POSIX)
+#if defined(IOV_MAX)
+    static constexpr size_t kMaxWriteVecCount = IOV_MAX;
+#else
+    static constexpr size_t kMaxWriteVecCount = 1024;
+#endif
+#endif
+
+    struct BusyPollStats {
+        // Polls made without blocking within the busy-poll window, and those of them which
+        // found events or tasks to handle.
+        uint64_t spins = 0;
+        uint64_t useful_spins = 0;
+        // Pumps that blocked waiting for events.
+        uint64_t blocking_waits = 0;
+    };
+
+    // Bounds of work one loop iteration takes on, thus neither a flood of tasks nor a busy
+    // connection holds back others on the loop for long; 0 means no bound.
+    struct IterationBudget {
+        // Queued tasks to run; at least one runs each iteration anyway.
+        size_t max_tasks = 0;
+        // Time since events were pumped, after which no more task runs.
+        std::chrono::microseconds max_time {0};
+        // Bytes a connection reads upon one read event; POSIX only.
+        size_t max_read_bytes = 0;
+    };
+
+    struct BudgetStats {
+        // Iterations which left tasks to the next for running out of tasks, or of time.
+        uint64_t task_budget_hits = 0;
+        uint64_t time_budget_hits = 0;
+        // Read events which left bytes in the socket for running out of bytes.
+        uint64_t read_budget_hits = 0;
+    };
 
     EventLoop();
 
@@ -42,6 +93,9 @@ public:
 
     // Queue the task in the loop thread.
     // The task will be executed shortly after the return from pumping events.
+    // The loop is woken up only if it is waiting for events and the task is the first one
+    // pending; other tasks go along with the wakeup already sent, or are picked up when the
+    // loop is done with current iteration.
     // This function is thread-safe.
     void QueueTask(Task task);
 
@@ -51,6 +105,28 @@ public:
     // This function is thread-safe.
     void RunTask(Task task);
 
+    // Queues the task to run at the end of current loop iteration, after active events and
+    // pending tasks are all handled; useful for gathering work done by them.
+    // Must be called on the loop thread.
+    void RunAtIterationEnd(Task task);
+
+    // Returns the time the loop last returned from pumping events, which handlers and timer
+    // scheduling on the loop share instead of reading the clock each; thus it falls behind
+    // the real time by as long as current iteration has taken so far.
+    // Reads the clock if called off the loop thread, or while the loop is not running.
+    TimePoint Now() const;
+
+    // Reads CLOCK_MONOTONIC_COARSE for Now(), which is cheaper to read, at the resolution of
+    // a scheduler tick, i.e. 1 to 4 ms; timers and the busy-poll window are then as coarse.
+    // This function is thread-safe.
+    void SetCoarseClock(bool enable);
+
+    // Must be called on the loop thread.
+    bool coarse_clock() const noexcept
+    {
+        return coarse_clock_;
+    }
+
     TimerID RunTaskAt(Task task, TimePoint when);
 
     TimerID RunTaskAfter(Task task, TimeDuration delay);
@@ -74,25 +150,196 @@ public:
 
     void Wakeup()
     {
+        wakeup_count_.fetch_add(1, std::memory_order_relaxed);
         event_pump_.Wakeup();
     }
 
+    // Returns the number of wakeups sent to the loop so far.
+    // This function is thread-safe.
+    size_t wakeup_count() const noexcept
+    {
+        return wakeup_count_.load(std::memory_order_relaxed);
+    }
+
+#if defined(OS_POSIX)
+    // Returns the number of changes of notifiers' interests handed to the kernel so far,
+    // i.e. epoll_ctl() calls.
+    // Changes of notifiers' watching events are committed right before the loop waits for
+    // events, and those cancelling out cost no call.
+    // Must be called on the loop thread.
+    size_t interest_update_count() const noexcept
+    {
+        return event_pump_.interest_update_count();
+    }
+
+    // Returns true if the loop runs on io_uring, which takes ezio built with
+    // EZIO_ENABLE_IO_URING and Linux 6.0 or later; the loop runs on epoll alone otherwise.
+    // Notifiers then choose whether their reads run on the ring; see Notifier::SetRingRead().
+    bool io_ring_enabled() const noexcept
+    {
+        return event_pump_.io_ring_enabled();
+    }
+
+    // Sends data in `vecs` on the socket of `notifier` via the ring, along with other
+    // requests right before the loop waits for events; the data must stay intact until the
+    // result is reported to the write handler of the notifier.
+    // A notifier has at most one send in flight.
+    // Must be called on the loop thread.
+    void SubmitSend(Notifier* notifier, const iovec* vecs, size_t count)
+    {
+        event_pump_.SubmitSend(notifier, vecs, count);
+    }
+#endif
+
+    // Pool of buffer blocks for connections running on the loop.
+    // The pool must be used on the loop thread only.
+    BlockPool* block_pool() noexcept
+    {
+        return &block_pool_;
+    }
+
+    // Scratch space in kRecvSpillAreaSize bytes, shared by connections running on the loop
+    // for receiving data beyond their predicted sizes.
+    // The area is allocated on first use, and must be used on the loop thread only.
+    char* recv_spill_area();
+
+#if defined(OS_POSIX)
+    // Scratch iovecs in kMaxWriteVecCount entries, shared by connections running on the loop
+    // for gathering output into one writev().
+    // The array is allocated on first use, and must be used on the loop thread only.
+    iovec* write_vecs();
+
+    // Holds payloads of zero-copy sends left by connections torn down on the loop.
+    // Must be used on the loop thread only.
+    ZeroCopyGraveyard* zerocopy_graveyard() noexcept
+    {
+        return &zerocopy_graveyard_;
+    }
+#endif
+
+    // Keeps polling for events without blocking for `window` after the loop last handled
+    // events or tasks, and blocks only after that; events arriving in the window are then
+    // picked up without a scheduler wakeup, at the cost of a busy CPU.
+    // 0 disables it, as is default.
+    // This function is thread-safe.
+    void SetBusyPollWindow(std::chrono::microseconds window);
+
+    // Must be called on the loop thread.
+    const BusyPollStats& busy_poll_stats() const noexcept
+    {
+        return busy_poll_stats_;
+    }
+
+    // Work left over by an iteration is picked up by the next, which doesn't block waiting
+    // for events then.
+    // This function is thread-safe.
+    void SetIterationBudget(const IterationBudget& budget);
+
+    // Must be called on the loop thread.
+    const IterationBudget& iteration_budget() const noexcept
+    {
+        return iteration_budget_;
+    }
+
+    // Must be called on the loop thread.
+    const BudgetStats& budget_stats() const noexcept
+    {
+        return budget_stats_;
+    }
+
+    // Connections on the loop count their read events cut short by the budget.
+    void CountReadBudgetHit() noexcept
+    {
+        ++budget_stats_.read_budget_hits;
+    }
+
 private:
+    // Nodes are recycled once their tasks have run, thus a steady stream of tasks queued
+    // allocates no node.
+    struct PendingTask : MPSCQueueNode {
+        Task task;
+        // Links nodes free for reuse.
+        PendingTask* next_free = nullptr;
+    };
+
+    // Nodes a thread has taken from a loop's free list for its following tasks.
+    struct PendingTaskCache {
+        PendingTask* head = nullptr;
+
+        ~PendingTaskCache();
+    };
+
+    // Nodes more than this many taken at once by a thread are freed.
+    static constexpr size_t kMaxCachedPendingTasks = 256;
+
+    // Takes a node from the cache of current thread, which is refilled with all nodes
+    // recycled by the loop once it runs out; allocates only if neither has any.
+    // This function is thread-safe.
+    std::unique_ptr<PendingTask> AcquirePendingTask();
+
+    // Makes the node, whose task has run, free for reuse.
+    // Must be called on the loop thread.
+    void RecyclePendingTask(std::unique_ptr<PendingTask> pending) noexcept;
+
+    TimePoint ReadClock() const
+    {
+        return coarse_clock_ ? CoarseMonotonicNow() : MonotonicNow();
+    }
+
     std::chrono::milliseconds GetPumpTimeout() const;
 
-    void ProcessPendingTasks();
+    TimePoint PumpEvents(std::vector<IONotification>& active_notifications);
+
+    bool IsInBusyPollWindow() const;
+
+    // Returns the number of tasks run.
+    size_t ProcessPendingTasks();
+
+    // Returns true if the budget allows running the `nth_task` pending task of the iteration.
+    bool HasTaskBudgetFor(size_t nth_task);
+
+    void ProcessIterationEndTasks();
 
 private:
     std::atomic<bool> is_running_;
     this_thread::ThreadID owner_thread_id_;
     EventPump event_pump_;
 
+    // Declared before the task queue, whose pending tasks may keep connections alive.
+    BlockPool block_pool_;
+    std::unique_ptr<char[]> recv_spill_area_;
+#if defined(OS_POSIX)
+    std::unique_ptr<iovec[]> write_vecs_;
+#endif
+
     TimerQueue timer_queue_;
 
-    bool executing_pending_task_;
+#if defined(OS_POSIX)
+    ZeroCopyGraveyard zerocopy_graveyard_;
+#endif
+
+    bool coarse_clock_;
+    TimePoint now_;
+
+    // Set while the loop is, or is about to be, blocked in pumping events; only then would
+    // queuing a task need a wakeup.
+    std::atomic<bool> waiting_for_events_;
+    std::atomic<size_t> wakeup_count_;
+
+    // Tasks are queued from any threads without locking.
+    MPSCQueue<PendingTask> task_queue_;
+    // Pushed by the loop thread only, and taken as a whole by any threads, which is free of
+    // the ABA problem that popping one node would have.
+    std::atomic<PendingTask*> free_pending_tasks_;
+
+    std::vector<Task> iteration_end_tasks_;
+
+    std::chrono::microseconds busy_poll_window_;
+    TimePoint last_active_time_;
+    BusyPollStats busy_poll_stats_;
 
-    std::mutex task_queue_mutex_;
-    std::vector<Task> task_queue_;
+    IterationBudget iteration_budget_;
+    BudgetStats budget_stats_;
 };
 
 }   // namespace ezio
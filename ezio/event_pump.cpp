@@ -32,13 +32,13 @@ EventPump::~EventPump()
 #endif
 }
 
-TimePoint EventPump::Pump(std::chrono::milliseconds timeout,
-                          std::vector<IONotification>& notifications)
+void EventPump::Pump(std::chrono::milliseconds timeout,
+                     std::vector<IONotification>& notifications)
 {
     FORCE_AS_NON_CONST_FUNCTION();
 
     ENSURE(CHECK, notifications.empty()).Require();
-    return impl_->Pump(timeout, notifications);
+    impl_->Pump(timeout, notifications);
 }
 
 void EventPump::Wakeup()
@@ -63,4 +63,26 @@ void EventPump::UnregisterNotifier(Notifier* notifier)
     impl_->UnregisterNotifier(notifier);
 }
 
+#if defined(OS_POSIX)
+
+size_t EventPump::interest_update_count() const noexcept
+{
+    return impl_->interest_update_count();
+}
+
+bool EventPump::io_ring_enabled() const noexcept
+{
+    return impl_->io_ring_enabled();
+}
+
+void EventPump::SubmitSend(Notifier* notifier, const iovec* vecs, size_t count)
+{
+    FORCE_AS_NON_CONST_FUNCTION();
+
+    ENSURE(CHECK, count > 0).Require();
+    impl_->SubmitSend(notifier, vecs, count);
+}
+
+#endif
+
 }   // namespace ezio
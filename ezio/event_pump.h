@@ -12,9 +12,12 @@
 
 #include "kbase/basic_macros.h"
 
-#include "ezio/chrono_utils.h"
 #include "ezio/io_context.h"
 
+#if defined(OS_POSIX)
+#include <sys/uio.h>
+#endif
+
 namespace ezio {
 
 class EventLoop;
@@ -32,7 +35,7 @@ public:
 
     DISALLOW_MOVE(EventPump);
 
-    TimePoint Pump(std::chrono::milliseconds timeout, std::vector<IONotification>& notifications);
+    void Pump(std::chrono::milliseconds timeout, std::vector<IONotification>& notifications);
 
     void Wakeup();
 
@@ -40,6 +43,16 @@ public:
 
     void UnregisterNotifier(Notifier* notifier);
 
+#if defined(OS_POSIX)
+    // Returns the number of changes of notifiers' interests handed to the kernel so far,
+    // i.e. epoll_ctl() calls.
+    size_t interest_update_count() const noexcept;
+
+    bool io_ring_enabled() const noexcept;
+
+    void SubmitSend(Notifier* notifier, const iovec* vecs, size_t count);
+#endif
+
 private:
     static constexpr size_t kInitialEventNum = 16;
 
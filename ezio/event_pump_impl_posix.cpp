@@ -4,6 +4,7 @@
 
 #include "ezio/event_pump_impl_posix.h"
 
+#include <algorithm>
 #include <type_traits>
 
 #include <sys/eventfd.h>
@@ -38,24 +39,61 @@ namespace ezio {
 EventPump::Impl::Impl(EventLoop* loop)
     : epfd_(CreateEpollFD()),
       io_events_(kInitialEventNum),
+      interest_update_count_(0),
       wakeup_fd_(CreateEventFD()),
       wakeup_notifier_(loop, wakeup_fd_)
-{}
+#if defined(EZIO_ENABLE_IO_URING)
+      , ring_(IORing::Create()),
+      epoll_polled_(false)
+#endif
+{
+#if defined(EZIO_ENABLE_IO_URING)
+    LOG_IF(WARNING, !ring_) << "io_uring is unavailable; the loop runs on epoll alone";
+#endif
+}
 
 EventPump::Impl::~Impl()
 {
     ENSURE(CHECK, wakeup_notifier_.state() == Notifier::State::Unused).Require();
 }
 
-TimePoint EventPump::Impl::Pump(std::chrono::milliseconds timeout,
-                                std::vector<IONotification>& notifications)
+void EventPump::Impl::Pump(std::chrono::milliseconds timeout,
+                           std::vector<IONotification>& notifications)
+{
+    CommitInterestChanges();
+
+    // Owners of notifiers failed to commit are told at once.
+    if (!failed_notifiers_.empty()) {
+        timeout = std::chrono::milliseconds::zero();
+    }
+
+#if defined(EZIO_ENABLE_IO_URING)
+    if (ring_) {
+        // The epoll set is checked only once the poll on the ring reports events ready.
+        if (WaitOnRing(timeout, notifications)) {
+            WaitOnEpoll(std::chrono::milliseconds::zero(), notifications);
+        }
+    } else {
+        WaitOnEpoll(timeout, notifications);
+    }
+#else
+    WaitOnEpoll(timeout, notifications);
+#endif
+
+    for (auto notifier : failed_notifiers_) {
+        notifications.emplace_back(notifier, IOContext(EPOLLHUP));
+    }
+
+    failed_notifiers_.clear();
+}
+
+void EventPump::Impl::WaitOnEpoll(std::chrono::milliseconds timeout,
+                                  std::vector<IONotification>& notifications)
 {
     int count = epoll_wait(epfd_.get(), io_events_.data(), static_cast<int>(io_events_.size()),
                            static_cast<int>(timeout.count()));
     auto err = errno;
 
-    TimePoint returned_time = ToTimePoint(std::chrono::system_clock::now());
-
     if (count == -1) {
         if (err != EINTR) {
             LOG(ERROR) << "epoll_wait() failed: " << err;
@@ -66,8 +104,6 @@ TimePoint EventPump::Impl::Pump(std::chrono::milliseconds timeout,
             io_events_.resize(io_events_.size() * 2);
         }
     }
-
-    return returned_time;
 }
 
 void EventPump::Impl::EnableWakeupNotification()
@@ -104,40 +140,157 @@ void EventPump::Impl::RegisterNotifier(Notifier* notifier)
     auto cur_state = notifier->state();
     if (cur_state == Notifier::State::Unused || cur_state == Notifier::State::Inactive) {
         notifier->set_state(Notifier::State::Active);
-        UpdateEpoll(EPOLL_CTL_ADD, notifier);
-    } else {
-        if (notifier->WatchNoneEvent()) {
-            notifier->set_state(Notifier::State::Inactive);
-            UpdateEpoll(EPOLL_CTL_DEL, notifier);
-        } else {
-            UpdateEpoll(EPOLL_CTL_MOD, notifier);
+    } else if (notifier->WatchNoneEvent()) {
+        notifier->set_state(Notifier::State::Inactive);
+    }
+
+    static_assert(std::is_same<uint32_t, IOEventType>::value,
+                  "IOEventType should be identical to uint32_t");
+    uint32_t events = 0;
+    if (!notifier->WatchNoneEvent()) {
+        events = static_cast<uint32_t>(notifier->watching_events());
+        if (notifier->edge_triggered()) {
+            events |= EPOLLET;
+        }
+    }
+
+    auto& interest = GetInterest(notifier);
+    interest.wanted_events = events;
+
+#if defined(EZIO_ENABLE_IO_URING)
+    // Reads on the ring are armed, or cancelled, along with other changes, and so are the
+    // rest of events of such a notifier.
+    if (IsReadingOnRing(interest)) {
+        QueueChange(notifier, interest);
+        return;
+    }
+#endif
+
+    // Adding a fd takes effect at once, thus failures are reported to the caller.
+    if (interest.committed_events == 0) {
+        if (events != 0) {
+            auto err = UpdateEpoll(EPOLL_CTL_ADD, notifier, events);
+            ENSURE(THROW, err == 0)(err).Require();
+            interest.committed_events = events;
         }
+
+        return;
     }
+
+    QueueChange(notifier, interest);
 }
 
 void EventPump::Impl::UnregisterNotifier(Notifier* notifier)
 {
-    if (notifier->state() == Notifier::State::Active) {
-        UpdateEpoll(EPOLL_CTL_DEL, notifier);
+    auto& interest = GetInterest(notifier);
+#if defined(EZIO_ENABLE_IO_URING)
+    DiscardRingRequests(interest);
+#endif
+
+    if (interest.committed_events != 0) {
+        UpdateEpoll(EPOLL_CTL_DEL, notifier, 0);
     }
 
+    // A pending change, if any, is left with nothing to commit.
+    interest.notifier = nullptr;
+    interest.committed_events = 0;
+    interest.wanted_events = 0;
+
     notifier->set_state(Notifier::State::Unused);
 }
 
-void EventPump::Impl::UpdateEpoll(int operation, const Notifier* notifier)
+EventPump::Impl::Interest& EventPump::Impl::GetInterest(const Notifier* notifier)
+{
+    auto fd = static_cast<size_t>(notifier->socket());
+    if (fd >= interests_.size()) {
+        interests_.resize(std::max(fd + 1, interests_.size() * 2));
+    }
+
+    auto& interest = interests_[fd];
+    if (interest.notifier != notifier) {
+        // The fd was closed and reused without its last notifier being unregistered, and
+        // had been removed from the epoll set along with the close.
+#if defined(EZIO_ENABLE_IO_URING)
+        DiscardRingRequests(interest);
+#endif
+        interest.notifier = notifier;
+        interest.committed_events = 0;
+        interest.wanted_events = 0;
+    }
+
+    return interest;
+}
+
+void EventPump::Impl::QueueChange(const Notifier* notifier, Interest& interest)
+{
+    if (!interest.change_pending) {
+        interest.change_pending = true;
+        changed_fds_.push_back(notifier->socket());
+    }
+}
+
+void EventPump::Impl::CommitInterestChanges()
+{
+    for (auto fd : changed_fds_) {
+        auto& interest = interests_[static_cast<size_t>(fd)];
+        interest.change_pending = false;
+#if defined(EZIO_ENABLE_IO_URING)
+        if (IsReadingOnRing(interest)) {
+            CommitRingInterest(interest);
+            continue;
+        }
+#endif
+        CommitEvents(interest, interest.wanted_events);
+    }
+
+    changed_fds_.clear();
+}
+
+void EventPump::Impl::CommitEvents(Interest& interest, uint32_t events)
+{
+    if (events == interest.committed_events) {
+        return;
+    }
+
+    if (events == 0) {
+        UpdateEpoll(EPOLL_CTL_DEL, interest.notifier, 0);
+        interest.committed_events = 0;
+        return;
+    }
+
+    // Fds leaving the ring are added here, rather than upon registering.
+    auto operation = interest.committed_events == 0 ? EPOLL_CTL_ADD : EPOLL_CTL_MOD;
+    if (UpdateEpoll(operation, interest.notifier, events) == 0) {
+        interest.committed_events = events;
+        return;
+    }
+
+    // The change was made in an earlier handler, thus throwing from here would fail the
+    // loop for nothing of its own; the fd is detached and reported as hung up instead.
+    if (interest.committed_events != 0) {
+        UpdateEpoll(EPOLL_CTL_DEL, interest.notifier, 0);
+        interest.committed_events = 0;
+    }
+
+    failed_notifiers_.push_back(const_cast<Notifier*>(interest.notifier));
+}
+
+int EventPump::Impl::UpdateEpoll(int operation, const Notifier* notifier, uint32_t events)
 {
+    ++interest_update_count_;
+
     struct epoll_event ev {};
-    static_assert(std::is_same<uint32_t, IOEventType>::value,
-                  "IOEventType should be identical to uint32_t");
-    ev.events = static_cast<uint32_t>(notifier->watching_events());
+    ev.events = events;
     ev.data.ptr = const_cast<Notifier*>(notifier);
 
     if (epoll_ctl(epfd_.get(), operation, notifier->socket(), &ev) < 0) {
         auto err = errno;
         LOG(WARNING) << "epoll_ctl() failed for operation " << operation
                      << " with fd" << notifier->socket() << " due to " << err;
-        ENSURE(THROW, operation == EPOLL_CTL_DEL)(operation)(err).Require();
+        return err;
     }
+
+    return 0;
 }
 
 void EventPump::Impl::FillActiveNotifications(size_t count,
@@ -150,4 +303,142 @@ void EventPump::Impl::FillActiveNotifications(size_t count,
     }
 }
 
+void EventPump::Impl::SubmitSend(Notifier* notifier, const iovec* vecs, size_t count)
+{
+#if defined(EZIO_ENABLE_IO_URING)
+    ENSURE(CHECK, ring_ != nullptr).Require();
+
+    auto& interest = GetInterest(notifier);
+    ENSURE(CHECK, interest.ring_write == nullptr).Require();
+    interest.ring_write = ring_->Send(notifier->socket(), vecs, count, notifier);
+#else
+    ENSURE(CHECK, kbase::NotReached())(notifier->socket())(count).Require();
+#endif
+}
+
+#if defined(EZIO_ENABLE_IO_URING)
+
+bool EventPump::Impl::IsReadingOnRing(const Interest& interest) const noexcept
+{
+    return ring_ && interest.notifier &&
+           (interest.notifier->ring_read() != Notifier::RingRead::None || interest.ring_read);
+}
+
+void EventPump::Impl::CommitRingInterest(Interest& interest)
+{
+    auto notifier = const_cast<Notifier*>(interest.notifier);
+    auto ring_read = notifier->ring_read();
+    bool wants_read = ring_read != Notifier::RingRead::None &&
+                      (interest.wanted_events & IOEvent::Read) != 0;
+    if (wants_read && !interest.ring_read) {
+        interest.ring_read = ring_read == Notifier::RingRead::Accept ?
+                             ring_->Accept(notifier->socket(), notifier) :
+                             ring_->Receive(notifier->socket(), notifier);
+    } else if (!wants_read && interest.ring_read && ring_->Cancel(interest.ring_read)) {
+        interest.ring_read = nullptr;
+    }
+
+    // A notifier leaving the ring has read events held until its last read there is done,
+    // which then queues the change again.
+    auto events = interest.wanted_events;
+    if (IsReadingOnRing(interest)) {
+        events &= ~static_cast<uint32_t>(IOEvent::Read);
+        if ((events & ~static_cast<uint32_t>(EPOLLET)) == 0) {
+            events = 0;
+        }
+    }
+
+    CommitEvents(interest, events);
+}
+
+void EventPump::Impl::DiscardRingRequests(Interest& interest)
+{
+    if (interest.ring_read) {
+        ring_->Discard(interest.ring_read);
+        interest.ring_read = nullptr;
+    }
+
+    if (interest.ring_write) {
+        ring_->Discard(interest.ring_write);
+        interest.ring_write = nullptr;
+    }
+}
+
+bool EventPump::Impl::WaitOnRing(std::chrono::milliseconds timeout,
+                                 std::vector<IONotification>& notifications)
+{
+    if (!epoll_polled_) {
+        ring_->PollReadable(epfd_.get(), this);
+        epoll_polled_ = true;
+    }
+
+    ring_->Submit(timeout);
+    ring_->ReapCompletions(completions_);
+
+    bool epoll_ready = false;
+    for (const auto& completion : completions_) {
+        epoll_ready |= HandleRingCompletion(completion, notifications);
+    }
+
+    completions_.clear();
+
+    return epoll_ready;
+}
+
+bool EventPump::Impl::HandleRingCompletion(const IORing::Completion& completion,
+                                           std::vector<IONotification>& notifications)
+{
+    if (completion.op == IORing::Op::PollReadable) {
+        epoll_polled_ = false;
+        return true;
+    }
+
+    auto notifier = static_cast<Notifier*>(completion.owner);
+    auto& interest = interests_[static_cast<size_t>(completion.fd)];
+    switch (completion.op) {
+        case IORing::Op::Accept:
+        case IORing::Op::Receive:
+            // The read is re-armed, or handed over to epoll, by the next commit.
+            if (!completion.more) {
+                interest.ring_read = nullptr;
+                QueueChange(notifier, interest);
+            }
+
+            // Receives having run out of buffers are re-armed once buffers are given back.
+            if (completion.result == -ENOBUFS || completion.result == -ECANCELED) {
+                break;
+            }
+
+            notifications.emplace_back(
+                notifier, IOContext(EPOLLIN, {completion.result, completion.data}));
+            break;
+
+        case IORing::Op::Send:
+            // The socket is full, and the send completes with nothing written once the
+            // socket can take more.
+            if (completion.result == -EAGAIN) {
+                interest.ring_write = ring_->PollWritable(completion.fd, notifier);
+                break;
+            }
+
+            interest.ring_write = nullptr;
+            notifications.emplace_back(notifier,
+                                       IOContext(EPOLLOUT, {completion.result, nullptr}));
+            break;
+
+        case IORing::Op::PollWritable:
+            // Failures of the socket, if any, are reported by the next send.
+            interest.ring_write = nullptr;
+            notifications.emplace_back(notifier, IOContext(EPOLLOUT, {0, nullptr}));
+            break;
+
+        case IORing::Op::PollReadable:
+            break;
+    }
+
+    return false;
+}
+
+#endif  // EZIO_ENABLE_IO_URING
+
 }   // namespace ezio
@@ -6,9 +6,11 @@
 #define EZIO_EVENT_PUMP_IMPL_POSIX_H_
 
 #include <chrono>
+#include <memory>
 #include <vector>
 
 #include <sys/epoll.h>
+#include <sys/uio.h>
 
 #include "kbase/basic_macros.h"
 #include "kbase/scoped_handle.h"
@@ -16,6 +18,10 @@
 #include "ezio/event_pump.h"
 #include "ezio/notifier.h"
 
+#if defined(EZIO_ENABLE_IO_URING)
+#include "ezio/io_ring.h"
+#endif
+
 namespace ezio {
 
 class EventLoop;
@@ -31,7 +37,7 @@ public:
 
     DISALLOW_MOVE(Impl);
 
-    TimePoint Pump(std::chrono::milliseconds timeout, std::vector<IONotification>& notifications);
+    void Pump(std::chrono::milliseconds timeout, std::vector<IONotification>& notifications);
 
     void EnableWakeupNotification();
 
@@ -43,18 +49,101 @@ public:
 
     void UnregisterNotifier(Notifier* notifier);
 
+    size_t interest_update_count() const noexcept
+    {
+        return interest_update_count_;
+    }
+
+    bool io_ring_enabled() const noexcept
+    {
+#if defined(EZIO_ENABLE_IO_URING)
+        return ring_ != nullptr;
+#else
+        return false;
+#endif
+    }
+
+    void SubmitSend(Notifier* notifier, const iovec* vecs, size_t count);
+
 private:
-    void UpdateEpoll(int operation, const Notifier* notifier);
+    // Interest of a fd as epoll sees it, and as the notifier on the fd wants it.
+    struct Interest {
+        const Notifier* notifier = nullptr;
+        // 0 if the fd is not in the epoll set.
+        uint32_t committed_events = 0;
+        uint32_t wanted_events = 0;
+        bool change_pending = false;
+#if defined(EZIO_ENABLE_IO_URING)
+        // The multishot receive, or accept, run for the notifier on the ring.
+        IORing::Request* ring_read = nullptr;
+        // The send run for the notifier, or the poll for the socket to take more.
+        IORing::Request* ring_write = nullptr;
+#endif
+    };
+
+    Interest& GetInterest(const Notifier* notifier);
+
+    void QueueChange(const Notifier* notifier, Interest& interest);
+
+    // Applies net changes of interests since last call, right before waiting for events;
+    // changes that cancel out, e.g. disabling writing and then enabling it again within one
+    // handler, cost no syscall.
+    // Note that, an edge-triggered notifier therefore isn't re-armed by such changes, and its
+    // owner has to check the fd on its own after re-enabling, as TCPConnection does.
+    // A fd failed to commit is removed from the epoll set, and its notifier is notified
+    // with EPOLLHUP by the same Pump() call.
+    void CommitInterestChanges();
+
+    // Makes `events` the events of the fd in the epoll set.
+    void CommitEvents(Interest& interest, uint32_t events);
+
+    // Returns 0 on success, or the errno otherwise.
+    int UpdateEpoll(int operation, const Notifier* notifier, uint32_t events);
+
+    void WaitOnEpoll(std::chrono::milliseconds timeout,
+                     std::vector<IONotification>& notifications);
 
     void FillActiveNotifications(size_t count, std::vector<IONotification>& notifications) const;
 
+#if defined(EZIO_ENABLE_IO_URING)
+    // Returns true if reads of the notifier run on the ring, or are yet to finish there.
+    bool IsReadingOnRing(const Interest& interest) const noexcept;
+
+    // Arms, or cancels, the read on the ring as the notifier wants, and commits the rest of
+    // its events to the epoll set; readiness of reading is watched only once no read runs
+    // on the ring.
+    void CommitRingInterest(Interest& interest);
+
+    void DiscardRingRequests(Interest& interest);
+
+    // Returns true if the epoll set has events ready.
+    bool WaitOnRing(std::chrono::milliseconds timeout,
+                    std::vector<IONotification>& notifications);
+
+    // Returns true if the completion is of the poll on the epoll set.
+    bool HandleRingCompletion(const IORing::Completion& completion,
+                              std::vector<IONotification>& notifications);
+#endif
+
     void OnWakeup();
 
 private:
     kbase::ScopedFD epfd_;
     std::vector<epoll_event> io_events_;
+    // Indexed by fd.
+    std::vector<Interest> interests_;
+    std::vector<int> changed_fds_;
+    std::vector<Notifier*> failed_notifiers_;
+    size_t interest_update_count_;
     kbase::ScopedFD wakeup_fd_;
     Notifier wakeup_notifier_;
+#if defined(EZIO_ENABLE_IO_URING)
+    // Null if the kernel doesn't support io_uring well enough, and epoll does all the work.
+    std::unique_ptr<IORing> ring_;
+    // The epoll set is polled on the ring along with other requests.
+    bool epoll_polled_;
+    std::vector<IORing::Completion> completions_;
+#endif
 };
 
 }   // namespace ezio
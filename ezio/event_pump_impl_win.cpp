@@ -35,8 +35,8 @@ EventPump::Impl::Impl(EventLoop*)
 EventPump::Impl::~Impl()
 {}
 
-TimePoint EventPump::Impl::Pump(std::chrono::milliseconds timeout,
-                                std::vector<IONotification>& notifications)
+void EventPump::Impl::Pump(std::chrono::milliseconds timeout,
+                           std::vector<IONotification>& notifications)
 {
     unsigned long dequeued_num = 0;
     auto succeed = GetQueuedCompletionStatusEx(io_port_.get(),
@@ -46,8 +46,6 @@ TimePoint EventPump::Impl::Pump(std::chrono::milliseconds timeout,
                                                static_cast<DWORD>(timeout.count()),
                                                FALSE);
 
-    TimePoint returned_time = ToTimePoint(std::chrono::system_clock::now());
-
     if (!succeed) {
         auto err = WSAGetLastError();
         LOG_IF(ERROR, err != WAIT_TIMEOUT) << "Dequeue for completion failure: " << err;
@@ -57,8 +55,6 @@ TimePoint EventPump::Impl::Pump(std::chrono::milliseconds timeout,
             io_events_.resize(io_events_.size() * 2);
         }
     }
-
-    return returned_time;
 }
 
 void EventPump::Impl::Wakeup()
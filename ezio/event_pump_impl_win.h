@@ -29,7 +29,7 @@ public:
 
     DISALLOW_MOVE(Impl);
 
-    TimePoint Pump(std::chrono::milliseconds timeout, std::vector<IONotification>& notifications);
+    void Pump(std::chrono::milliseconds timeout, std::vector<IONotification>& notifications);
 
     void Wakeup();
 
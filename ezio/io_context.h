@@ -35,21 +35,40 @@ using IOEventType = std::underlying_type_t<IOEvent>;
 #if defined(OS_POSIX)
 
 struct IOContext {
-    IOEventType events;
-
-    // Details on Linux is currently no use.
+    // Readiness events carry no details; those reporting completions of reads or writes run
+    // by the loop's io_uring carry their results.
     struct Details {
-        constexpr Details() noexcept = default;
+        bool completed;
+        // Bytes transferred, or the accepted socket; -errno on failure.
+        int result;
+        // Received bytes, which stay valid until the handler returns.
+        const char* data;
+
+        constexpr Details() noexcept
+            : completed(false), result(0), data(nullptr)
+        {}
+
+        constexpr Details(int io_result, const char* io_data) noexcept
+            : completed(true), result(io_result), data(io_data)
+        {}
+
         ~Details() = default;
     };
 
+    IOEventType events;
+    Details details;
+
     constexpr explicit IOContext(IOEventType epoll_events) noexcept
         : events(epoll_events)
     {}
 
+    constexpr IOContext(IOEventType epoll_events, const Details& io_details) noexcept
+        : events(epoll_events), details(io_details)
+    {}
+
     constexpr Details ToDetails() const noexcept
     {
-        return Details{};
+        return details;
     }
 };
 
@@ -0,0 +1,467 @@
+/*
+ @ 0xCCCCCCCC
+*/
+
+#include "ezio/io_ring.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "kbase/error_exception_util.h"
+#include "kbase/logging.h"
+
+namespace {
+
+constexpr unsigned int kSQEntries = 256;
+constexpr unsigned int kCQEntries = 4096;
+
+constexpr uint16_t kBufferGroup = 0;
+
+// Marks requests whose completions are of no interest, i.e. cancellations.
+constexpr uint64_t kIgnoredUserData = 0;
+
+int io_uring_setup(unsigned int entries, io_uring_params* params)
+{
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int io_uring_enter(int ring_fd, unsigned int to_submit, unsigned int min_complete,
+                   unsigned int flags, const void* arg, size_t arg_size)
+{
+    return static_cast<int>(syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete,
+                                    flags, arg, arg_size));
+}
+
+int io_uring_register(int ring_fd, unsigned int opcode, const void* arg, unsigned int nr_args)
+{
+    return static_cast<int>(syscall(__NR_io_uring_register, ring_fd, opcode, arg, nr_args));
+}
+
+// The kernel and we publish indices of the rings to each other.
+unsigned int LoadAcquire(const unsigned int* index)
+{
+    return __atomic_load_n(index, __ATOMIC_ACQUIRE);
+}
+
+template<typename T>
+void StoreRelease(T* index, T value)
+{
+    __atomic_store_n(index, value, __ATOMIC_RELEASE);
+}
+
+void* MapRegion(size_t size, int fd, off_t offset)
+{
+    auto flags = fd < 0 ? MAP_PRIVATE | MAP_ANONYMOUS : MAP_SHARED | MAP_POPULATE;
+    auto addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, flags, fd, offset);
+    return addr == MAP_FAILED ? nullptr : addr;
+}
+
+// Entries of the buffer ring start right at the ring, as the kernel sees it; `bufs` of the
+// struct is shifted in C++, where the empty struct wrapping it takes a byte.
+io_uring_buf* GetBufferEntries(io_uring_buf_ring* buf_ring)
+{
+    return reinterpret_cast<io_uring_buf*>(buf_ring);
+}
+
+// Multishot receives arrived along with IORING_OP_SEND_ZC in Linux 6.0.
+bool SupportsMultishotReceive(int ring_fd)
+{
+    constexpr size_t kProbeOps = 256;
+    auto probe_size = sizeof(io_uring_probe) + kProbeOps * sizeof(io_uring_probe_op);
+    std::unique_ptr<char[]> storage(new char[probe_size]());
+    auto probe = reinterpret_cast<io_uring_probe*>(storage.get());
+    if (io_uring_register(ring_fd, IORING_REGISTER_PROBE, probe, kProbeOps) < 0) {
+        return false;
+    }
+
+    return probe->last_op >= IORING_OP_SEND_ZC &&
+           (probe->ops[IORING_OP_SEND_ZC].flags & IO_URING_OP_SUPPORTED) != 0;
+}
+
+}   // namespace
+
+namespace ezio {
+
+constexpr size_t IORing::kBufferSize;
+constexpr size_t IORing::kBufferCount;
+
+// static
+std::unique_ptr<IORing> IORing::Create()
+{
+    io_uring_params params {};
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = kCQEntries;
+
+    int ring_fd = io_uring_setup(kSQEntries, &params);
+    if (ring_fd < 0) {
+        LOG(WARNING) << "io_uring_setup() failed: " << errno;
+        return nullptr;
+    }
+
+    std::unique_ptr<IORing> ring(new IORing(ring_fd, params));
+    if (!ring->Setup(params)) {
+        return nullptr;
+    }
+
+    return ring;
+}
+
+IORing::IORing(int ring_fd, const io_uring_params& params)
+    : ring_fd_(ring_fd),
+      rings_(nullptr),
+      rings_size_(0),
+      sqes_(nullptr),
+      sqes_size_(0),
+      sq_head_(nullptr),
+      sq_tail_(nullptr),
+      sq_flags_(nullptr),
+      sq_mask_(0),
+      sq_entries_(params.sq_entries),
+      local_sq_tail_(0),
+      cq_head_(nullptr),
+      cq_tail_(nullptr),
+      cq_mask_(0),
+      cqes_(nullptr),
+      buf_ring_(nullptr),
+      buf_ring_size_(0),
+      buf_ring_tail_(0)
+{}
+
+IORing::~IORing()
+{
+    // Closing the ring cancels requests still in the kernel, before their memory goes away.
+    ring_fd_ = nullptr;
+
+    if (buf_ring_) {
+        munmap(buf_ring_, buf_ring_size_);
+    }
+
+    if (sqes_) {
+        munmap(sqes_, sqes_size_);
+    }
+
+    if (rings_) {
+        munmap(rings_, rings_size_);
+    }
+}
+
+bool IORing::Setup(const io_uring_params& params)
+{
+    // Completions must never be dropped, and waiting takes a timeout along.
+    constexpr auto kRequiredFeatures = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP |
+                                       IORING_FEAT_EXT_ARG;
+    if ((params.features & kRequiredFeatures) != kRequiredFeatures ||
+        !SupportsMultishotReceive(ring_fd_.get())) {
+        LOG(WARNING) << "io_uring of the kernel lacks features required; features: "
+                     << params.features;
+        return false;
+    }
+
+    rings_size_ = std::max(params.sq_off.array + params.sq_entries * sizeof(unsigned int),
+                           params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+    rings_ = MapRegion(rings_size_, ring_fd_.get(), IORING_OFF_SQ_RING);
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    sqes_ = static_cast<io_uring_sqe*>(MapRegion(sqes_size_, ring_fd_.get(), IORING_OFF_SQES));
+    if (!rings_ || !sqes_) {
+        LOG(WARNING) << "Failed to map rings of io_uring: " << errno;
+        return false;
+    }
+
+    auto base = static_cast<char*>(rings_);
+    sq_head_ = reinterpret_cast<unsigned int*>(base + params.sq_off.head);
+    sq_tail_ = reinterpret_cast<unsigned int*>(base + params.sq_off.tail);
+    sq_flags_ = reinterpret_cast<unsigned int*>(base + params.sq_off.flags);
+    sq_mask_ = *reinterpret_cast<unsigned int*>(base + params.sq_off.ring_mask);
+    local_sq_tail_ = *sq_tail_;
+
+    // Entries of the submission queue map to those of the array one to one.
+    auto sq_array = reinterpret_cast<unsigned int*>(base + params.sq_off.array);
+    for (unsigned int i = 0; i < params.sq_entries; ++i) {
+        sq_array[i] = i;
+    }
+
+    cq_head_ = reinterpret_cast<unsigned int*>(base + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned int*>(base + params.cq_off.tail);
+    cq_mask_ = *reinterpret_cast<unsigned int*>(base + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(base + params.cq_off.cqes);
+
+    buf_ring_size_ = kBufferCount * sizeof(io_uring_buf);
+    buf_ring_ = static_cast<io_uring_buf_ring*>(MapRegion(buf_ring_size_, -1, 0));
+    if (!buf_ring_) {
+        LOG(WARNING) << "Failed to map the buffer ring: " << errno;
+        return false;
+    }
+
+    io_uring_buf_reg reg {};
+    reg.ring_addr = reinterpret_cast<uint64_t>(buf_ring_);
+    reg.ring_entries = kBufferCount;
+    reg.bgid = kBufferGroup;
+    if (io_uring_register(ring_fd_.get(), IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        LOG(WARNING) << "Failed to register buffers for io_uring: " << errno;
+        munmap(buf_ring_, buf_ring_size_);
+        buf_ring_ = nullptr;
+        return false;
+    }
+
+    buffers_.reset(new char[kBufferSize * kBufferCount]);
+    for (size_t id = 0; id < kBufferCount; ++id) {
+        AddBuffer(static_cast<uint16_t>(id));
+    }
+
+    StoreRelease(&buf_ring_->tail, buf_ring_tail_);
+
+    return true;
+}
+
+IORing::Request* IORing::NewRequest(Op op, int fd, void* owner)
+{
+    Request* request;
+    if (free_requests_.empty()) {
+        requests_.push_back(std::make_unique<Request>());
+        request = requests_.back().get();
+    } else {
+        request = free_requests_.back();
+        free_requests_.pop_back();
+    }
+
+    request->op = op;
+    request->fd = fd;
+    request->owner = owner;
+    request->submitted = false;
+    request->cancelling = false;
+
+    queued_requests_.push_back(request);
+
+    return request;
+}
+
+void IORing::ReleaseRequest(Request* request)
+{
+    request->owner = nullptr;
+    request->vecs.clear();
+    free_requests_.push_back(request);
+}
+
+IORing::Request* IORing::Accept(int fd, void* owner)
+{
+    return NewRequest(Op::Accept, fd, owner);
+}
+
+IORing::Request* IORing::Receive(int fd, void* owner)
+{
+    return NewRequest(Op::Receive, fd, owner);
+}
+
+IORing::Request* IORing::Send(int fd, const iovec* vecs, size_t count, void* owner)
+{
+    auto request = NewRequest(Op::Send, fd, owner);
+    request->vecs.assign(vecs, vecs + count);
+    return request;
+}
+
+IORing::Request* IORing::PollReadable(int fd, void* owner)
+{
+    return NewRequest(Op::PollReadable, fd, owner);
+}
+
+IORing::Request* IORing::PollWritable(int fd, void* owner)
+{
+    return NewRequest(Op::PollWritable, fd, owner);
+}
+
+bool IORing::Cancel(Request* request)
+{
+    if (!request->submitted) {
+        queued_requests_.erase(std::find(queued_requests_.begin(), queued_requests_.end(),
+                                         request));
+        ReleaseRequest(request);
+        return true;
+    }
+
+    // Sends complete upon submission, and have nothing to cancel.
+    if (request->cancelling || request->op == Op::Send) {
+        return false;
+    }
+
+    request->cancelling = true;
+
+    auto sqe = GetSQE();
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = reinterpret_cast<uint64_t>(request);
+    sqe->user_data = kIgnoredUserData;
+
+    return false;
+}
+
+void IORing::Discard(Request* request)
+{
+    if (Cancel(request)) {
+        return;
+    }
+
+    request->owner = nullptr;
+
+    // The fd is usually closed right after, and a request in the kernel keeps the file open,
+    // e.g. a listening socket would still be bound; thus the cancellation goes at once.
+    Enter(local_sq_tail_ - LoadAcquire(sq_head_), 0, nullptr);
+}
+
+void IORing::Submit(std::chrono::milliseconds timeout)
+{
+    // Handlers of completions reaped last time are done with the data.
+    for (auto id : used_buffers_) {
+        AddBuffer(id);
+    }
+
+    if (!used_buffers_.empty()) {
+        StoreRelease(&buf_ring_->tail, buf_ring_tail_);
+        used_buffers_.clear();
+    }
+
+    for (auto request : queued_requests_) {
+        PrepareRequest(request);
+    }
+
+    queued_requests_.clear();
+
+    struct __kernel_timespec ts {};
+    auto secs = std::chrono::duration_cast<std::chrono::seconds>(timeout);
+    ts.tv_sec = secs.count();
+    ts.tv_nsec = std::chrono::duration_cast<std::chrono::nanoseconds>(timeout - secs).count();
+
+    auto to_submit = local_sq_tail_ - LoadAcquire(sq_head_);
+    if (Enter(to_submit, timeout.count() > 0 ? 1 : 0, &ts) < 0) {
+        auto err = errno;
+        if (err != ETIME && err != EINTR) {
+            LOG(ERROR) << "io_uring_enter() failed: " << err;
+        }
+    }
+}
+
+void IORing::ReapCompletions(std::vector<Completion>& completions)
+{
+    while (true) {
+        auto head = *cq_head_;
+        auto tail = LoadAcquire(cq_tail_);
+        for (; head != tail; ++head) {
+            const auto& cqe = cqes_[head & cq_mask_];
+            if (cqe.user_data == kIgnoredUserData) {
+                continue;
+            }
+
+            auto request = reinterpret_cast<Request*>(cqe.user_data);
+            bool more = (cqe.flags & IORING_CQE_F_MORE) != 0;
+            const char* data = nullptr;
+            if (cqe.flags & IORING_CQE_F_BUFFER) {
+                auto id = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+                data = buffers_.get() + id * kBufferSize;
+                used_buffers_.push_back(id);
+            }
+
+            if (request->owner) {
+                completions.push_back({request->op, request->fd, request->owner, cqe.res, more,
+                                       data});
+            } else if (request->op == Op::Accept && cqe.res >= 0) {
+                close(cqe.res);
+            }
+
+            if (!more) {
+                ReleaseRequest(request);
+            }
+        }
+
+        StoreRelease(cq_head_, head);
+
+        // Completions overflowed are kept by the kernel, and are flushed into the queue
+        // upon entering.
+        if (!(__atomic_load_n(sq_flags_, __ATOMIC_RELAXED) & IORING_SQ_CQ_OVERFLOW)) {
+            break;
+        }
+
+        Enter(0, 0, nullptr);
+    }
+}
+
+io_uring_sqe* IORing::GetSQE()
+{
+    if (local_sq_tail_ - LoadAcquire(sq_head_) == sq_entries_) {
+        Enter(sq_entries_, 0, nullptr);
+    }
+
+    auto sqe = &sqes_[local_sq_tail_ & sq_mask_];
+    memset(sqe, 0, sizeof(*sqe));
+    StoreRelease(sq_tail_, ++local_sq_tail_);
+
+    return sqe;
+}
+
+void IORing::PrepareRequest(Request* request)
+{
+    auto sqe = GetSQE();
+    sqe->fd = request->fd;
+    sqe->user_data = reinterpret_cast<uint64_t>(request);
+
+    switch (request->op) {
+        case Op::Accept:
+            sqe->opcode = IORING_OP_ACCEPT;
+            sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+            sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+            break;
+
+        case Op::Receive:
+            sqe->opcode = IORING_OP_RECV;
+            sqe->ioprio = IORING_RECV_MULTISHOT;
+            sqe->flags = IOSQE_BUFFER_SELECT;
+            sqe->buf_group = kBufferGroup;
+            break;
+
+        case Op::Send:
+            request->msg = msghdr {};
+            request->msg.msg_iov = request->vecs.data();
+            request->msg.msg_iovlen = request->vecs.size();
+            sqe->opcode = IORING_OP_SENDMSG;
+            sqe->addr = reinterpret_cast<uint64_t>(&request->msg);
+            sqe->len = 1;
+            sqe->msg_flags = MSG_DONTWAIT | MSG_NOSIGNAL;
+            break;
+
+        case Op::PollReadable:
+            sqe->opcode = IORING_OP_POLL_ADD;
+            sqe->poll32_events = POLLIN;
+            break;
+
+        case Op::PollWritable:
+            sqe->opcode = IORING_OP_POLL_ADD;
+            sqe->poll32_events = POLLOUT;
+            break;
+    }
+
+    request->submitted = true;
+}
+
+int IORing::Enter(unsigned int to_submit, unsigned int min_complete,
+                  const struct __kernel_timespec* timeout)
+{
+    io_uring_getevents_arg arg {};
+    arg.ts = reinterpret_cast<uint64_t>(timeout);
+    return io_uring_enter(ring_fd_.get(), to_submit, min_complete,
+                          IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+}
+
+void IORing::AddBuffer(uint16_t id)
+{
+    auto& buf = GetBufferEntries(buf_ring_)[buf_ring_tail_ & (kBufferCount - 1)];
+    buf.addr = reinterpret_cast<uint64_t>(buffers_.get() + id * kBufferSize);
+    buf.len = kBufferSize;
+    buf.bid = id;
+    ++buf_ring_tail_;
+}
+
+}   // namespace ezio
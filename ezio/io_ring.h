@@ -0,0 +1,160 @@
+/*
+ @ 0xCCCCCCCC
+*/
+
+#ifndef EZIO_IO_RING_H_
+#define EZIO_IO_RING_H_
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include <linux/io_uring.h>
+
+#include "kbase/basic_macros.h"
+#include "kbase/scoped_handle.h"
+
+namespace ezio {
+
+// IORing runs IO requests of sockets on an io_uring instance, which are handed to the
+// kernel in batches and are reported once completed.
+// Accepts and receives are multishot, i.e. one request keeps completing for each connection
+// accepted, or for each chunk of data received, until it is cancelled or fails.
+// Received data land in buffers registered with the kernel up front, which the kernel picks
+// from as data arrive; they are given back once the completions are handled.
+// Sends never wait for the socket and fail with EAGAIN if it is full; thus the kernel is
+// done with the data by the time the send is submitted.
+class IORing {
+public:
+    enum class Op {
+        Accept,
+        Receive,
+        Send,
+        PollReadable,
+        PollWritable
+    };
+
+    struct Completion {
+        Op op;
+        int fd;
+        void* owner;
+        // Bytes transferred, the accepted socket, or the poll mask; -errno on failure.
+        int result;
+        // Set if the request keeps completing, i.e. is still armed.
+        bool more;
+        // Received bytes, which stay valid until the next Submit().
+        const char* data;
+    };
+
+    static constexpr size_t kBufferSize = 16 * 1024;
+    static constexpr size_t kBufferCount = 256;
+
+    // Returns null if the kernel lacks any feature required, e.g. it's older than Linux 6.0.
+    static std::unique_ptr<IORing> Create();
+
+    ~IORing();
+
+    DISALLOW_COPY(IORing);
+
+    DISALLOW_MOVE(IORing);
+
+    // Functions below queue a request owned by `owner`, which is handed to the kernel by
+    // the next Submit(), and return the request.
+    // The request can be referred to until its last completion is reaped.
+
+    struct Request;
+
+    Request* Accept(int fd, void* owner);
+
+    Request* Receive(int fd, void* owner);
+
+    // Data in `vecs` must stay intact until the request is submitted.
+    Request* Send(int fd, const iovec* vecs, size_t count, void* owner);
+
+    Request* PollReadable(int fd, void* owner);
+
+    Request* PollWritable(int fd, void* owner);
+
+    // Cancels the request; completions arriving before the cancellation are still reported.
+    // Returns true if the request was dropped before being submitted, and is gone.
+    bool Cancel(Request* request);
+
+    // Cancels the request, if it may be waiting, and drops its completions from now on.
+    // Unlike Cancel(), the cancellation is handed to the kernel at once.
+    void Discard(Request* request);
+
+    // Gives buffers of completions reaped so far back to the kernel, submits requests queued,
+    // and then waits for a completion for up to `timeout`.
+    void Submit(std::chrono::milliseconds timeout);
+
+    // Appends completions reaped, except those of requests discarded.
+    void ReapCompletions(std::vector<Completion>& completions);
+
+private:
+    IORing(int ring_fd, const io_uring_params& params);
+
+    bool Setup(const io_uring_params& params);
+
+    Request* NewRequest(Op op, int fd, void* owner);
+
+    void ReleaseRequest(Request* request);
+
+    // Returns a zeroed entry of the submission queue, submitting those filled if it's full.
+    io_uring_sqe* GetSQE();
+
+    void PrepareRequest(Request* request);
+
+    int Enter(unsigned int to_submit, unsigned int min_complete,
+              const struct __kernel_timespec* timeout);
+
+    void AddBuffer(uint16_t id);
+
+private:
+    kbase::ScopedFD ring_fd_;
+
+    void* rings_;
+    size_t rings_size_;
+    io_uring_sqe* sqes_;
+    size_t sqes_size_;
+
+    unsigned int* sq_head_;
+    unsigned int* sq_tail_;
+    unsigned int* sq_flags_;
+    unsigned int sq_mask_;
+    unsigned int sq_entries_;
+    unsigned int local_sq_tail_;
+
+    unsigned int* cq_head_;
+    unsigned int* cq_tail_;
+    unsigned int cq_mask_;
+    io_uring_cqe* cqes_;
+
+    io_uring_buf_ring* buf_ring_;
+    size_t buf_ring_size_;
+    std::unique_ptr<char[]> buffers_;
+    uint16_t buf_ring_tail_;
+    std::vector<uint16_t> used_buffers_;
+
+    std::vector<std::unique_ptr<Request>> requests_;
+    std::vector<Request*> free_requests_;
+    std::vector<Request*> queued_requests_;
+};
+
+struct IORing::Request {
+    Op op;
+    int fd;
+    // Null once discarded.
+    void* owner;
+    bool submitted;
+    bool cancelling;
+    msghdr msg;
+    std::vector<iovec> vecs;
+};
+
+}   // namespace ezio
+
+#endif  // EZIO_IO_RING_H_
@@ -0,0 +1,153 @@
+/*
+ @ 0xCCCCCCCC
+*/
+
+#include "ezio/length_prefix_codec.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+
+#include "kbase/error_exception_util.h"
+#include "kbase/logging.h"
+
+#include "ezio/tcp_connection.h"
+
+namespace {
+
+constexpr size_t kMaxHeaderSize = sizeof(uint64_t);
+
+}   // namespace
+
+namespace ezio {
+
+LengthPrefixCodec::LengthPrefixCodec()
+    : LengthPrefixCodec(Options())
+{}
+
+LengthPrefixCodec::LengthPrefixCodec(const Options& opts)
+    : opts_(opts)
+{
+    auto header_size = opts_.header_size;
+    ENSURE(CHECK, header_size == 1 || header_size == 2 || header_size == 4 || header_size == 8)
+        (header_size).Require();
+
+    // Frames larger than the header can describe are rejected anyway.
+    if (header_size < kMaxHeaderSize) {
+        auto max_describable = (static_cast<uint64_t>(1) << (header_size * 8)) - 1;
+        if (opts_.max_frame_size > max_describable) {
+            opts_.max_frame_size = static_cast<size_t>(max_describable);
+        }
+    }
+}
+
+void LengthPrefixCodec::WriteHeader(size_t payload_size, Buffer& buf) const
+{
+    ENSURE(CHECK, payload_size <= opts_.max_frame_size)
+        (payload_size)(opts_.max_frame_size).Require();
+
+    char header[kMaxHeaderSize];
+    auto size = static_cast<uint64_t>(payload_size);
+    for (size_t i = 0; i < opts_.header_size; ++i) {
+        auto shift = opts_.byte_order == ByteOrder::BigEndian ?
+                     (opts_.header_size - 1 - i) * 8 : i * 8;
+        header[i] = static_cast<char>((size >> shift) & 0xFF);
+    }
+
+    buf.Write(header, opts_.header_size);
+}
+
+void LengthPrefixCodec::Encode(kbase::StringView payload, Buffer& buf) const
+{
+    WriteHeader(payload.size(), buf);
+    buf.Write(payload.data(), payload.size());
+}
+
+std::string LengthPrefixCodec::Encode(kbase::StringView payload) const
+{
+    Buffer buf(opts_.header_size + payload.size());
+    Encode(payload, buf);
+    return buf.ReadAllAsString();
+}
+
+size_t LengthPrefixCodec::ReadHeader(const char* header) const noexcept
+{
+    uint64_t size = 0;
+    for (size_t i = 0; i < opts_.header_size; ++i) {
+        auto byte = static_cast<uint64_t>(static_cast<unsigned char>(header[i]));
+        auto shift = opts_.byte_order == ByteOrder::BigEndian ?
+                     (opts_.header_size - 1 - i) * 8 : i * 8;
+        size |= byte << shift;
+    }
+
+    // Clamped on 32-bit platforms, where it then exceeds the limit for sure.
+    return static_cast<size_t>(
+        std::min<uint64_t>(size, std::numeric_limits<size_t>::max()));
+}
+
+void LengthPrefixCodec::OnDataReceive(const TCPConnectionPtr& conn, Buffer& buf,
+                                      TimePoint ts) const
+{
+    const auto header_size = opts_.header_size;
+
+    while (buf.readable_size() >= header_size) {
+        // Frames lying entirely in the leading contiguous region are delivered in place, and
+        // are consumed in bulk.
+        auto region_size = buf.contiguous_readable_size();
+        auto region = buf.Linearize(region_size);
+        size_t offset = 0;
+        while (region_size - offset >= header_size) {
+            auto frame_size = ReadHeader(region + offset);
+            if (frame_size > opts_.max_frame_size) {
+                buf.Consume(offset);
+                HandleFrameError(conn, buf, frame_size);
+                return;
+            }
+
+            if (region_size - offset - header_size < frame_size) {
+                break;
+            }
+
+            on_frame_(conn, kbase::StringView(region + offset + header_size, frame_size), ts);
+            offset += header_size + frame_size;
+        }
+
+        if (offset > 0) {
+            buf.Consume(offset);
+            continue;
+        }
+
+        // The leading frame spans blocks, or is incomplete.
+        auto frame_size = ReadHeader(buf.Linearize(header_size));
+        if (frame_size > opts_.max_frame_size) {
+            HandleFrameError(conn, buf, frame_size);
+            return;
+        }
+
+        if (buf.readable_size() - header_size < frame_size) {
+            return;
+        }
+
+        auto frame = buf.Linearize(header_size + frame_size) + header_size;
+        on_frame_(conn, kbase::StringView(frame, frame_size), ts);
+        buf.Consume(header_size + frame_size);
+    }
+}
+
+void LengthPrefixCodec::HandleFrameError(const TCPConnectionPtr& conn, Buffer& buf,
+                                         size_t frame_size) const
+{
+    // The stream can't be resynchronized.
+    buf.ConsumeAll();
+
+    if (on_frame_error_) {
+        on_frame_error_(conn, frame_size);
+        return;
+    }
+
+    LOG(ERROR) << "Frame size " << frame_size << " exceeds the limit " << opts_.max_frame_size
+               << " on " << conn->name();
+    conn->Shutdown();
+}
+
+}   // namespace ezio
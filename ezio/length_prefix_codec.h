@@ -0,0 +1,103 @@
+/*
+ @ 0xCCCCCCCC
+*/
+
+#ifndef EZIO_LENGTH_PREFIX_CODEC_H_
+#define EZIO_LENGTH_PREFIX_CODEC_H_
+
+#include <functional>
+#include <string>
+
+#include "kbase/basic_macros.h"
+#include "kbase/string_view.h"
+
+#include "ezio/buffer.h"
+#include "ezio/common_event_handlers.h"
+
+namespace ezio {
+
+// LengthPrefixCodec splits a byte stream into frames, each of which is a payload preceded
+// by a header carrying the size of the payload.
+// Complete frames are delivered to the frame handler as views into the input buffer, which
+// are valid only during the call; frames decoded in one go are consumed at once after.
+// A frame spanning blocks of a chained buffer is gathered into one block first, which takes
+// a cached block if the buffer is pooled and the frame fits in a block.
+class LengthPrefixCodec {
+public:
+    enum class ByteOrder {
+        BigEndian,
+        LittleEndian
+    };
+
+    struct Options {
+        // Must be 1, 2, 4 or 8.
+        size_t header_size;
+        ByteOrder byte_order;
+        // Max size of a payload; a frame beyond that is a protocol error.
+        size_t max_frame_size;
+
+        Options()
+            : header_size(4),
+              byte_order(ByteOrder::BigEndian),
+              max_frame_size(64 * 1024 * 1024)
+        {}
+    };
+
+    using FrameHandler =
+        std::function<void(const TCPConnectionPtr&, kbase::StringView, TimePoint)>;
+
+    // Called with the declared payload size when it exceeds the max frame size.
+    using FrameErrorHandler = std::function<void(const TCPConnectionPtr&, size_t)>;
+
+    LengthPrefixCodec();
+
+    explicit LengthPrefixCodec(const Options& opts);
+
+    ~LengthPrefixCodec() = default;
+
+    DISALLOW_COPY(LengthPrefixCodec);
+
+    DEFAULT_MOVE(LengthPrefixCodec);
+
+    const Options& options() const noexcept
+    {
+        return opts_;
+    }
+
+    void set_on_frame(FrameHandler handler)
+    {
+        on_frame_ = std::move(handler);
+    }
+
+    // If no frame error handler is set, the connection is shut down on errors.
+    void set_on_frame_error(FrameErrorHandler handler)
+    {
+        on_frame_error_ = std::move(handler);
+    }
+
+    // Writes the header of a frame carrying `payload_size` bytes into `buf`.
+    void WriteHeader(size_t payload_size, Buffer& buf) const;
+
+    void Encode(kbase::StringView payload, Buffer& buf) const;
+
+    std::string Encode(kbase::StringView payload) const;
+
+    // Serves as the message handler of a TCPServer or a TCPClient.
+    // Frames are delivered in order until the buffer runs out of complete frames or an error
+    // occurs; bytes of the remaining incomplete frame are kept in the buffer.
+    void OnDataReceive(const TCPConnectionPtr& conn, Buffer& buf, TimePoint ts) const;
+
+private:
+    size_t ReadHeader(const char* header) const noexcept;
+
+    void HandleFrameError(const TCPConnectionPtr& conn, Buffer& buf, size_t frame_size) const;
+
+private:
+    Options opts_;
+    FrameHandler on_frame_;
+    FrameErrorHandler on_frame_error_;
+};
+
+}   // namespace ezio
+
+#endif  // EZIO_LENGTH_PREFIX_CODEC_H_
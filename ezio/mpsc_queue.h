@@ -0,0 +1,164 @@
+/*
+ @ 0xCCCCCCCC
+*/
+
+#ifndef EZIO_MPSC_QUEUE_H_
+#define EZIO_MPSC_QUEUE_H_
+
+#include <atomic>
+#include <memory>
+#include <utility>
+
+#include "kbase/basic_macros.h"
+#include "kbase/scope_guard.h"
+
+namespace ezio {
+
+template<typename T>
+class MPSCQueue;
+
+// Element types of MPSCQueue derive from it, thus pushing an element needs no allocation
+// other than the element itself.
+class MPSCQueueNode {
+protected:
+    MPSCQueueNode() noexcept
+        : next_(nullptr)
+    {}
+
+    ~MPSCQueueNode() = default;
+
+private:
+    template<typename T>
+    friend class MPSCQueue;
+
+    MPSCQueueNode* next_;
+};
+
+// MPSCQueue is a lock-free multi-producer single-consumer queue.
+// Producers push elements from any threads with a CAS loop; the consumer takes all pushed
+// elements with one atomic exchange, and then visits them in the order they were pushed.
+// Since Push() tells whether the queue was empty, the producer seeing so can be the only
+// one to arrange for the consumer to run.
+template<typename T>
+class MPSCQueue {
+public:
+    MPSCQueue() noexcept
+        : head_(nullptr),
+          taken_(nullptr),
+          taken_tail_(nullptr)
+    {}
+
+    ~MPSCQueue()
+    {
+        ConsumeAll([](std::unique_ptr<T>) {});
+    }
+
+    DISALLOW_COPY(MPSCQueue);
+
+    DISALLOW_MOVE(MPSCQueue);
+
+    // Returns true if the queue was empty before pushing `elem`; elements the consumer has
+    // taken but left for its next call don't count.
+    // This function is thread-safe.
+    bool Push(std::unique_ptr<T> elem) noexcept
+    {
+        // The node belongs to the consumer once pushed, thus what it was pushed onto is kept
+        // aside instead of read back from it.
+        MPSCQueueNode* node = elem.release();
+        MPSCQueueNode* head = head_.load(std::memory_order_relaxed);
+        do {
+            node->next_ = head;
+        } while (!head_.compare_exchange_weak(head, node,
+                                              std::memory_order_release,
+                                              std::memory_order_relaxed));
+
+        return head == nullptr;
+    }
+
+    // Takes all elements pushed so far, and hands them over to `consumer` in FIFO order.
+    // Elements pushed meanwhile are left for the next call.
+    // Returns the number of elements consumed.
+    // Must be called by one thread at a time.
+    template<typename Consumer>
+    size_t ConsumeAll(Consumer&& consumer)
+    {
+        return ConsumeWhile(std::forward<Consumer>(consumer), [] { return true; });
+    }
+
+    // Like ConsumeAll(), but stops once `keep_going()`, asked before each element, returns
+    // false; elements left are handed over first on next call.
+    // If `consumer` throws, elements not visited are released.
+    template<typename Consumer, typename Predicate>
+    size_t ConsumeWhile(Consumer&& consumer, Predicate&& keep_going)
+    {
+        // Pushed elements are chained in LIFO order.
+        MPSCQueueNode* node = head_.exchange(nullptr, std::memory_order_acquire);
+        MPSCQueueNode* fifo = nullptr;
+        MPSCQueueNode* fifo_tail = node;
+        while (node) {
+            auto next = node->next_;
+            node->next_ = fifo;
+            fifo = node;
+            node = next;
+        }
+
+        if (!taken_) {
+            taken_ = fifo;
+            taken_tail_ = fifo_tail;
+        } else if (fifo) {
+            taken_tail_->next_ = fifo;
+            taken_tail_ = fifo_tail;
+        }
+
+        bool completed = false;
+        ON_SCOPE_EXIT {
+            if (!completed) {
+                ReleaseTaken();
+            }
+        };
+
+        size_t count = 0;
+        while (taken_ && keep_going()) {
+            std::unique_ptr<T> elem(static_cast<T*>(taken_));
+            taken_ = taken_->next_;
+            consumer(std::move(elem));
+            ++count;
+        }
+
+        if (!taken_) {
+            taken_tail_ = nullptr;
+        }
+
+        completed = true;
+
+        return count;
+    }
+
+    // Elements left by the consumer are only seen on the consumer's thread.
+    bool empty() const noexcept
+    {
+        return !taken_ && head_.load(std::memory_order_acquire) == nullptr;
+    }
+
+private:
+    void ReleaseTaken() noexcept
+    {
+        while (taken_) {
+            std::unique_ptr<T> elem(static_cast<T*>(taken_));
+            taken_ = taken_->next_;
+        }
+
+        taken_tail_ = nullptr;
+    }
+
+private:
+    std::atomic<MPSCQueueNode*> head_;
+
+    // Elements taken but not yet visited, in FIFO order; owned by the consumer.
+    MPSCQueueNode* taken_;
+    MPSCQueueNode* taken_tail_;
+};
+
+}   // namespace ezio
+
+#endif  // EZIO_MPSC_QUEUE_H_
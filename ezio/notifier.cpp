@@ -16,6 +16,10 @@ Notifier::Notifier(ezio::EventLoop* loop, const ezio::ScopedSocket& socket) noex
       weakly_bound_(false),
       state_(State::Unused),
       watching_events_(IOEvent::None)
+#if defined(OS_POSIX)
+      , edge_triggered_(false),
+      ring_read_(RingRead::None)
+#endif
 {}
 
 void Notifier::EnableReading()
@@ -31,6 +31,18 @@ public:
         Inactive
     };
 
+#if defined(OS_POSIX)
+    // How reads of the socket are run, if the loop runs on io_uring.
+    enum class RingRead {
+        // Readiness of the socket is reported as usual.
+        None,
+        // Data are received, or connections are accepted, by the loop, and read events
+        // carry the results along in their details.
+        Receive,
+        Accept
+    };
+#endif
+
     Notifier(EventLoop* loop, const ScopedSocket& socket) noexcept;
 
     ~Notifier() = default;
@@ -91,6 +103,28 @@ public:
 
     void Detach();
 
+#if defined(OS_POSIX)
+    // Events are reported only when the socket turns readable or writable, rather than for
+    // as long as it stays so; handlers must then read or write until EAGAIN, or pick up
+    // the rest on their own. Notifiers are level-triggered by default.
+    void SetEdgeTriggered(bool enable);
+
+    bool edge_triggered() const noexcept
+    {
+        return edge_triggered_;
+    }
+
+    // Takes effect only if the loop runs on io_uring; see EventLoop::io_ring_enabled().
+    // Read events of a notifier switching back to readiness are held until reads already
+    // run by the loop are done.
+    void SetRingRead(RingRead ring_read);
+
+    RingRead ring_read() const noexcept
+    {
+        return ring_read_;
+    }
+#endif
+
     // Prevent the associated object being destroyed during HandleEvent() or executing
     // HandleEvent() after the object being dead.
     void WeaklyBind(const std::shared_ptr<void>& obj);
@@ -132,6 +166,11 @@ private:
     State state_;
 
     IOEventType watching_events_;
+
+#if defined(OS_POSIX)
+    bool edge_triggered_;
+    RingRead ring_read_;
+#endif
 };
 
 }   // namespace ezio
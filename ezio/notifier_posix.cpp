@@ -6,10 +6,26 @@
 
 namespace ezio {
 
+void Notifier::SetEdgeTriggered(bool enable)
+{
+    edge_triggered_ = enable;
+    if (state_ == State::Active) {
+        Update();
+    }
+}
+
+void Notifier::SetRingRead(RingRead ring_read)
+{
+    ring_read_ = ring_read;
+    if (state_ == State::Active) {
+        Update();
+    }
+}
+
 void Notifier::DoHandleEvent(TimePoint receive_time, IOContext io_ctx) const
 {
     auto events = io_ctx.events;
-    constexpr auto details = io_ctx.ToDetails();
+    auto details = io_ctx.ToDetails();
 
     if ((events & EPOLLHUP) && !(events & EPOLLIN)) {
         if (on_close_) {
@@ -0,0 +1,228 @@
+/*
+ @ 0xCCCCCCCC
+*/
+
+#include "ezio/output_queue.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "kbase/error_exception_util.h"
+
+namespace {
+
+constexpr size_t kMinCopiedSegmentSize = 1024;
+
+}   // namespace
+
+namespace ezio {
+
+OutputQueue::OutputQueue()
+    : OutputQueue(nullptr)
+{}
+
+OutputQueue::OutputQueue(BlockPool* pool)
+    : size_(0),
+      pool_(pool)
+{}
+
+void OutputQueue::Append(kbase::StringView data)
+{
+    if (data.empty()) {
+        return;
+    }
+
+    size_ += data.size();
+
+    // Chained buffers never relocate bytes on appending.
+    if (pool_) {
+        if (segments_.empty() || segments_.back().type != SegmentType::Copied) {
+            segments_.emplace_back(SegmentType::Copied);
+            segments_.back().buf = std::make_unique<Buffer>(Buffer::MakeChained(pool_));
+        }
+
+        segments_.back().buf->Write(data.data(), data.size());
+        return;
+    }
+
+    // Never let the trailing segment grow beyond its capacity, in case its bytes are being
+    // sent asynchronously.
+    if (segments_.empty() || segments_.back().type != SegmentType::Copied ||
+        segments_.back().str.capacity() - segments_.back().str.size() < data.size()) {
+        segments_.emplace_back(SegmentType::Copied);
+        segments_.back().str.reserve(std::max(data.size(), kMinCopiedSegmentSize));
+    }
+
+    segments_.back().str.append(data.data(), data.size());
+}
+
+void OutputQueue::Append(std::string&& data)
+{
+    if (data.empty()) {
+        return;
+    }
+
+    size_ += data.size();
+    segments_.emplace_back(SegmentType::String);
+    segments_.back().str = std::move(data);
+}
+
+void OutputQueue::Append(Buffer&& buf)
+{
+    if (buf.readable_size() == 0) {
+        return;
+    }
+
+#if defined(OS_WIN)
+    // Each segment is handed over to WSASend() as one region.
+    buf.Linearize();
+#endif
+
+    size_ += buf.readable_size();
+    segments_.emplace_back(SegmentType::Buffer);
+    segments_.back().buf = std::make_unique<Buffer>(std::move(buf));
+}
+
+void OutputQueue::Append(std::vector<char>&& data)
+{
+    if (data.empty()) {
+        return;
+    }
+
+    auto owner = std::make_shared<const std::vector<char>>(std::move(data));
+    kbase::StringView view(owner->data(), owner->size());
+    Append(std::move(owner), view);
+}
+
+void OutputQueue::Append(std::shared_ptr<const void> owner, kbase::StringView data)
+{
+    if (data.empty()) {
+        return;
+    }
+
+    size_ += data.size();
+    segments_.emplace_back(SegmentType::Shared);
+    segments_.back().owner = std::move(owner);
+    segments_.back().slice = data;
+}
+
+void OutputQueue::Append(const SharedPayload& payload)
+{
+    Append(payload.storage(), payload.view());
+}
+
+#if defined(OS_POSIX)
+void OutputQueue::AppendFile(int fd, int64_t offset, size_t size, FileRegionHandler on_done)
+{
+    if (size == 0) {
+        if (on_done) {
+            on_done(true);
+        }
+
+        return;
+    }
+
+    size_ += size;
+    segments_.emplace_back(SegmentType::File);
+    auto& seg = segments_.back();
+    seg.fd = fd;
+    seg.file_offset = offset;
+    seg.file_size = size;
+    seg.on_done = std::move(on_done);
+}
+
+OutputQueue::FileRegion OutputQueue::PeekFileRegion() const
+{
+    ENSURE(CHECK, IsFileRegionAtFront()).Require();
+
+    const auto& head = segments_.front();
+    return FileRegion{head.fd, head.file_offset + static_cast<int64_t>(head.offset), head.size()};
+}
+#endif
+
+void OutputQueue::Consume(size_t data_size)
+{
+    ENSURE(CHECK, data_size <= size_)(data_size)(size_).Require();
+
+    // Handlers may queue more data, thus are run after the queue is consistent.
+    std::vector<FileRegionHandler> done_handlers;
+
+    size_ -= data_size;
+    while (data_size > 0) {
+        auto& head = segments_.front();
+        auto n = std::min(head.size(), data_size);
+        if (head.buf) {
+            head.buf->Consume(n);
+        } else {
+            head.offset += n;
+        }
+
+        data_size -= n;
+
+        if (head.size() == 0) {
+            if (head.on_done) {
+                done_handlers.push_back(std::move(head.on_done));
+            }
+
+            segments_.pop_front();
+        }
+    }
+
+    for (const auto& handler : done_handlers) {
+        handler(true);
+    }
+}
+
+OutputQueue::SharedSegment OutputQueue::ShareFront(size_t min_size)
+{
+    if (segments_.empty() || segments_.front().size() < min_size) {
+        return {};
+    }
+
+    auto& head = segments_.front();
+    switch (head.type) {
+        case SegmentType::String: {
+            auto owner = std::make_shared<const std::string>(std::move(head.str));
+            head.slice = kbase::StringView(*owner);
+            head.owner = std::move(owner);
+            head.type = SegmentType::Shared;
+            break;
+        }
+
+        case SegmentType::Buffer: {
+            if (head.buf->contiguous_readable_size() != head.buf->readable_size()) {
+                return {};
+            }
+
+            std::shared_ptr<const Buffer> owner(std::move(head.buf));
+            head.slice = kbase::StringView(owner->Peek(), owner->readable_size());
+            head.owner = std::move(owner);
+            head.offset = 0;
+            head.type = SegmentType::Shared;
+            break;
+        }
+
+        case SegmentType::Shared:
+            break;
+
+        default:
+            return {};
+    }
+
+    return {head.owner, head.data()};
+}
+
+void OutputQueue::Clear()
+{
+    std::deque<Segment> dropped;
+    dropped.swap(segments_);
+    size_ = 0;
+
+    for (const auto& seg : dropped) {
+        if (seg.on_done) {
+            seg.on_done(false);
+        }
+    }
+}
+
+}   // namespace ezio
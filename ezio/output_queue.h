@@ -0,0 +1,193 @@
+/*
+ @ 0xCCCCCCCC
+*/
+
+#ifndef EZIO_OUTPUT_QUEUE_H_
+#define EZIO_OUTPUT_QUEUE_H_
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "kbase/basic_macros.h"
+#include "kbase/string_view.h"
+
+#include "ezio/buffer.h"
+#include "ezio/shared_payload.h"
+
+#if defined(OS_POSIX)
+#include <sys/uio.h>
+#elif defined(OS_WIN)
+#include <WinSock2.h>
+#endif
+
+namespace ezio {
+
+// OutputQueue keeps outgoing data as a sequence of segments, each of which owns, or shares
+// the ownership of, its payload.
+// Payloads handed over by move are queued as they are and then gathered into one write
+// call, and therefore are never copied before reaching the socket.
+// Data bytes appended via a view are copied, and small ones are coalesced into the trailing
+// copied segment, without relocating bytes already queued.
+// If a BlockPool is given, copied bytes are stored in blocks borrowed from the pool, which
+// are returned as soon as they are sent.
+// On POSIX, regions of files can be queued as well; they are never read into memory, and
+// must be sent via sendfile() once they reach the front.
+class OutputQueue {
+public:
+    // Run with true once all bytes of a file region are consumed, or with false if the
+    // region is dropped by Clear().
+    using FileRegionHandler = std::function<void(bool completed)>;
+
+    // Unsent bytes of a segment, along with a share of the ownership of their storage.
+    struct SharedSegment {
+        std::shared_ptr<const void> owner;
+        kbase::StringView data;
+    };
+
+#if defined(OS_POSIX)
+    struct FileRegion {
+        int fd;
+        int64_t offset;
+        size_t size;
+    };
+#endif
+
+    OutputQueue();
+
+    explicit OutputQueue(BlockPool* pool);
+
+    ~OutputQueue() = default;
+
+    DISALLOW_COPY(OutputQueue);
+
+    DEFAULT_MOVE(OutputQueue);
+
+    // Total number of bytes queued.
+    size_t size() const noexcept
+    {
+        return size_;
+    }
+
+    bool empty() const noexcept
+    {
+        return size_ == 0;
+    }
+
+    size_t segment_count() const noexcept
+    {
+        return segments_.size();
+    }
+
+    void Append(kbase::StringView data);
+
+    void Append(std::string&& data);
+
+    void Append(Buffer&& buf);
+
+    void Append(std::vector<char>&& data);
+
+    // Appends data bytes in `data` without copying; `owner` keeps them alive until they
+    // are consumed.
+    void Append(std::shared_ptr<const void> owner, kbase::StringView data);
+
+    // Shares bytes of `payload` without copying.
+    void Append(const SharedPayload& payload);
+
+#if defined(OS_POSIX)
+    // Queues `size` bytes of the file `fd` starting at `offset`.
+    // The file must stay open until `on_done` is run.
+    void AppendFile(int fd, int64_t offset, size_t size, FileRegionHandler on_done);
+#endif
+
+    // Discards `data_size` bytes from the front; released segments free their payloads.
+    void Consume(size_t data_size);
+
+    // Drops all queued data and notifies pending file regions.
+    void Clear();
+
+    // Shares the storage of the front segment, if at least `min_size` bytes are unsent, the
+    // bytes are contiguous and their storage was handed over to the queue, rather than
+    // copied into it; the storage then stays alive after the bytes are consumed, as long
+    // as the returned owner is held. Returns an empty one otherwise.
+    SharedSegment ShareFront(size_t min_size);
+
+#if defined(OS_POSIX)
+    // Returns true if the front bytes come from a file region.
+    bool IsFileRegionAtFront() const noexcept
+    {
+        return !segments_.empty() && segments_.front().type == SegmentType::File;
+    }
+
+    // Returns the unsent part of the file region at the front.
+    FileRegion PeekFileRegion() const;
+
+    // Fills `vecs` with at most `max_count` regions of queued data, in order, and returns
+    // the number of entries filled.
+    // Stops at the first file region, which can only be sent on its own.
+    size_t PeekIOVecs(iovec* vecs, size_t max_count) const;
+#elif defined(OS_WIN)
+    // Same as PeekIOVecs() but in WSABUF.
+    size_t PeekWSABufs(WSABUF* bufs, size_t max_count) const;
+#endif
+
+private:
+    enum class SegmentType {
+        Copied,
+        String,
+        Buffer,
+        Shared,
+        File
+    };
+
+    struct Segment {
+        SegmentType type;
+        std::string str;
+        std::unique_ptr<ezio::Buffer> buf;
+        std::shared_ptr<const void> owner;
+        kbase::StringView slice;
+        int fd;
+        int64_t file_offset;
+        size_t file_size;
+        FileRegionHandler on_done;
+        size_t offset;
+
+        explicit Segment(SegmentType segment_type)
+            : type(segment_type),
+              fd(-1),
+              file_offset(0),
+              file_size(0),
+              offset(0)
+        {}
+
+        // Unsent bytes in contiguous segments; not applicable to segments backed by a buffer.
+        kbase::StringView data() const noexcept
+        {
+            if (type == SegmentType::Shared) {
+                return {slice.data() + offset, slice.size() - offset};
+            }
+
+            return {str.data() + offset, str.size() - offset};
+        }
+
+        size_t size() const noexcept
+        {
+            if (type == SegmentType::File) {
+                return file_size - offset;
+            }
+
+            return buf ? buf->readable_size() : data().size();
+        }
+    };
+
+    std::deque<Segment> segments_;
+    size_t size_;
+    BlockPool* pool_;
+};
+
+}   // namespace ezio
+
+#endif  // EZIO_OUTPUT_QUEUE_H_
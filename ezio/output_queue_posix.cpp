@@ -0,0 +1,31 @@
+/*
+ @ 0xCCCCCCCC
+*/
+
+#include "ezio/output_queue.h"
+
+namespace ezio {
+
+size_t OutputQueue::PeekIOVecs(iovec* vecs, size_t max_count) const
+{
+    size_t count = 0;
+    for (auto it = segments_.cbegin(); it != segments_.cend() && count < max_count; ++it) {
+        if (it->type == SegmentType::File) {
+            break;
+        }
+
+        if (it->buf) {
+            count += it->buf->PeekIOVecs(vecs + count, max_count - count);
+            continue;
+        }
+
+        auto data = it->data();
+        vecs[count].iov_base = const_cast<char*>(data.data());
+        vecs[count].iov_len = data.size();
+        ++count;
+    }
+
+    return count;
+}
+
+}   // namespace ezio
@@ -0,0 +1,28 @@
+/*
+ @ 0xCCCCCCCC
+*/
+
+#include "ezio/output_queue.h"
+
+namespace ezio {
+
+size_t OutputQueue::PeekWSABufs(WSABUF* bufs, size_t max_count) const
+{
+    size_t count = 0;
+    for (auto it = segments_.cbegin(); it != segments_.cend() && count < max_count; ++it) {
+        if (it->buf) {
+            bufs[count].buf = const_cast<char*>(it->buf->Peek());
+            bufs[count].len = static_cast<ULONG>(it->buf->readable_size());
+        } else {
+            auto data = it->data();
+            bufs[count].buf = const_cast<char*>(data.data());
+            bufs[count].len = static_cast<ULONG>(data.size());
+        }
+
+        ++count;
+    }
+
+    return count;
+}
+
+}   // namespace ezio
@@ -0,0 +1,92 @@
+/*
+ @ 0xCCCCCCCC
+*/
+
+#include "ezio/recv_size_predictor.h"
+
+#include <algorithm>
+
+#include "kbase/error_exception_util.h"
+
+namespace {
+
+constexpr size_t kIndexIncrement = 4;
+constexpr size_t kIndexDecrement = 1;
+
+constexpr size_t kLinearStep = 16;
+constexpr size_t kLinearSteps = 31;
+constexpr size_t kMaxIndex = kLinearSteps + 22;
+
+// Sizes are 16, 32, ..., 496, then 512, 1024, ... up to 2 GiB.
+size_t SizeAt(size_t index) noexcept
+{
+    if (index < kLinearSteps) {
+        return (index + 1) * kLinearStep;
+    }
+
+    return (kLinearSteps + 1) * kLinearStep << (index - kLinearSteps);
+}
+
+// Returns the index of the smallest size not less than `size`.
+size_t IndexOf(size_t size) noexcept
+{
+    size_t index = 0;
+    while (index < kMaxIndex && SizeAt(index) < size) {
+        ++index;
+    }
+
+    return index;
+}
+
+}   // namespace
+
+namespace ezio {
+
+constexpr size_t RecvSizePredictor::kDefaultMinimum;
+constexpr size_t RecvSizePredictor::kDefaultInitial;
+constexpr size_t RecvSizePredictor::kDefaultMaximum;
+
+RecvSizePredictor::RecvSizePredictor()
+    : RecvSizePredictor(kDefaultMinimum, kDefaultInitial, kDefaultMaximum)
+{}
+
+RecvSizePredictor::RecvSizePredictor(size_t minimum, size_t initial, size_t maximum)
+    : min_index_(IndexOf(minimum)),
+      max_index_(IndexOf(maximum)),
+      index_(IndexOf(initial)),
+      next_size_(SizeAt(index_)),
+      decrease_now_(false)
+{
+    ENSURE(CHECK, minimum > 0 && minimum <= initial && initial <= maximum)
+        (minimum)(initial)(maximum).Require();
+
+    // Sizes not in the table are rounded up, thus the maximum may exceed.
+    if (SizeAt(max_index_) > maximum && max_index_ > min_index_) {
+        --max_index_;
+    }
+
+    index_ = std::min(std::max(index_, min_index_), max_index_);
+    next_size_ = SizeAt(index_);
+}
+
+void RecvSizePredictor::Record(size_t bytes_read) noexcept
+{
+    auto lower_index = index_ > kIndexDecrement ? index_ - kIndexDecrement : 0;
+    if (bytes_read <= SizeAt(lower_index)) {
+        if (decrease_now_) {
+            index_ = std::max(lower_index, min_index_);
+            next_size_ = SizeAt(index_);
+            decrease_now_ = false;
+        } else {
+            decrease_now_ = true;
+        }
+    } else if (bytes_read >= next_size_) {
+        index_ = std::min(index_ + kIndexIncrement, max_index_);
+        next_size_ = SizeAt(index_);
+        decrease_now_ = false;
+    } else {
+        decrease_now_ = false;
+    }
+}
+
+}   // namespace ezio
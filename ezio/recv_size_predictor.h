@@ -0,0 +1,47 @@
+/*
+ @ 0xCCCCCCCC
+*/
+
+#ifndef EZIO_RECV_SIZE_PREDICTOR_H_
+#define EZIO_RECV_SIZE_PREDICTOR_H_
+
+#include <cstddef>
+
+namespace ezio {
+
+// RecvSizePredictor predicts how many bytes the next read of a connection would get, from
+// its recent reads, so that we can prepare just enough space in the input buffer.
+// Candidate sizes go up by 16 bytes below 512, and double from then on.
+// The prediction grows quickly when a read fills the predicted size, and shrinks by one
+// step only after two consecutive reads fall well below it.
+class RecvSizePredictor {
+public:
+    static constexpr size_t kDefaultMinimum = 64;
+    static constexpr size_t kDefaultInitial = 2048;
+    static constexpr size_t kDefaultMaximum = 65536;
+
+    RecvSizePredictor();
+
+    RecvSizePredictor(size_t minimum, size_t initial, size_t maximum);
+
+    ~RecvSizePredictor() = default;
+
+    size_t next_size() const noexcept
+    {
+        return next_size_;
+    }
+
+    // Adjusts the prediction with the number of bytes the latest read got.
+    void Record(size_t bytes_read) noexcept;
+
+private:
+    size_t min_index_;
+    size_t max_index_;
+    size_t index_;
+    size_t next_size_;
+    bool decrease_now_;
+};
+
+}   // namespace ezio
+
+#endif  // EZIO_RECV_SIZE_PREDICTOR_H_
@@ -0,0 +1,77 @@
+/*
+ @ 0xCCCCCCCC
+*/
+
+#ifndef EZIO_SHARED_PAYLOAD_H_
+#define EZIO_SHARED_PAYLOAD_H_
+
+#include <memory>
+#include <string>
+
+#include "kbase/basic_macros.h"
+#include "kbase/string_view.h"
+
+namespace ezio {
+
+// SharedPayload is a reference-counted, immutable sequence of data bytes.
+// Copying an instance only bumps the reference count, thus a payload can be sent over any
+// number of connections, on any threads, while its bytes are allocated and encoded once.
+// Connections queue the bytes themselves, which are released when the last one of them
+// finishes sending.
+class SharedPayload {
+public:
+    SharedPayload() = default;
+
+    // Takes over the bytes of `data` without copying.
+    explicit SharedPayload(std::string&& data)
+        : data_(std::make_shared<const std::string>(std::move(data)))
+    {}
+
+    explicit SharedPayload(kbase::StringView data)
+        : data_(std::make_shared<const std::string>(data.data(), data.size()))
+    {}
+
+    ~SharedPayload() = default;
+
+    DEFAULT_COPY(SharedPayload);
+
+    DEFAULT_MOVE(SharedPayload);
+
+    const char* data() const noexcept
+    {
+        return data_ ? data_->data() : nullptr;
+    }
+
+    size_t size() const noexcept
+    {
+        return data_ ? data_->size() : 0;
+    }
+
+    bool empty() const noexcept
+    {
+        return size() == 0;
+    }
+
+    kbase::StringView view() const noexcept
+    {
+        return data_ ? kbase::StringView(*data_) : kbase::StringView();
+    }
+
+    // Number of instances, including queued ones, sharing the payload.
+    long use_count() const noexcept
+    {
+        return data_.use_count();
+    }
+
+    const std::shared_ptr<const std::string>& storage() const noexcept
+    {
+        return data_;
+    }
+
+private:
+    std::shared_ptr<const std::string> data_;
+};
+
+}   // namespace ezio
+
+#endif  // EZIO_SHARED_PAYLOAD_H_
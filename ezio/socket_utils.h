@@ -12,6 +12,7 @@
 
 #if defined(OS_POSIX)
 #include <cerrno>
+#include <cstdint>
 #include <sys/socket.h>
 #elif defined(OS_WIN)
 #include <Winsock2.h>
@@ -57,6 +58,25 @@ void SetTCPNoDelay(const ScopedSocket& sock, bool enable);
 
 void EnableTCPQuickACK(const ScopedSocket& sock);
 
+// Enables sending with MSG_ZEROCOPY on the socket.
+// Returns false if the kernel doesn't support it.
+bool EnableZeroCopy(const ScopedSocket& sock);
+
+// Sets SO_BUSY_POLL, thus receiving on the socket busy-polls the device queue for up to
+// `usec` microseconds when no data is ready.
+// Returns false if not permitted, e.g. exceeding net.core.busy_read without CAP_NET_ADMIN.
+bool SetBusyPoll(const ScopedSocket& sock, int usec);
+
+// Sets SO_REUSEPORT, thus sockets having it set before binding can bind to the same
+// address, and connections are spread among those listening.
+void SetReusePort(const ScopedSocket& sock, bool enable);
+
+// Attaches a classic BPF program to the SO_REUSEPORT group of the listening socket, which
+// hands a new connection to the socket indexed by the CPU receiving it, modulo
+// `group_size`; socket indices follow the order they started listening.
+// Returns false if the kernel doesn't support it.
+bool AttachReusePortCPUSteering(const ScopedSocket& sock, uint32_t group_size);
+
 bool IsSelfConnected(const ScopedSocket& sock);
 
 #endif
@@ -6,11 +6,20 @@
 
 #include <cstring>
 
+#include <linux/filter.h>
 #include <netinet/tcp.h>
 
 #include "kbase/error_exception_util.h"
 #include "kbase/logging.h"
 
+#if !defined(SO_ZEROCOPY)
+#define SO_ZEROCOPY 60
+#endif
+
+#if !defined(SO_ATTACH_REUSEPORT_CBPF)
+#define SO_ATTACH_REUSEPORT_CBPF 51
+#endif
+
 namespace ezio {
 namespace socket {
 
@@ -41,6 +50,65 @@ void EnableTCPQuickACK(const ScopedSocket& sock)
     }
 }
 
+bool EnableZeroCopy(const ScopedSocket& sock)
+{
+    int optval = 1;
+    if (setsockopt(sock.get(), SOL_SOCKET, SO_ZEROCOPY, &optval, sizeof(optval)) < 0) {
+        auto err = errno;
+        LOG(WARNING) << "Enable socket SO_ZEROCOPY failed: " << err;
+        return false;
+    }
+
+    return true;
+}
+
+bool SetBusyPoll(const ScopedSocket& sock, int usec)
+{
+    if (setsockopt(sock.get(), SOL_SOCKET, SO_BUSY_POLL, &usec, sizeof(usec)) < 0) {
+        auto err = errno;
+        LOG(WARNING) << "Set socket SO_BUSY_POLL " << usec << " failed: " << err;
+        return false;
+    }
+
+    return true;
+}
+
+void SetReusePort(const ScopedSocket& sock, bool enable)
+{
+    int optval = enable ? 1 : 0;
+    if (setsockopt(sock.get(), SOL_SOCKET, SO_REUSEPORT, &optval, sizeof(optval)) < 0) {
+        auto err = errno;
+        LOG(ERROR) << "Set socket SO_REUSEPORT " << enable << " failed: " << err;
+        ENSURE(CHECK, kbase::NotReached())(err)(enable).Require();
+    }
+}
+
+bool AttachReusePortCPUSteering(const ScopedSocket& sock, uint32_t group_size)
+{
+    ENSURE(CHECK, group_size > 0).Require();
+
+    sock_filter code[] {
+        // A = current CPU
+        {BPF_LD | BPF_W | BPF_ABS, 0, 0, static_cast<uint32_t>(SKF_AD_OFF + SKF_AD_CPU)},
+        // A = A % group_size
+        {BPF_ALU | BPF_MOD | BPF_K, 0, 0, group_size},
+        // return A
+        {BPF_RET | BPF_A, 0, 0, 0}
+    };
+
+    sock_fprog prog {};
+    prog.len = static_cast<unsigned short>(sizeof(code) / sizeof(code[0]));
+    prog.filter = code;
+
+    if (setsockopt(sock.get(), SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof(prog)) < 0) {
+        auto err = errno;
+        LOG(WARNING) << "Attach SO_REUSEPORT CPU steering program failed: " << err;
+        return false;
+    }
+
+    return true;
+}
+
 bool IsSelfConnected(const ScopedSocket& sock)
 {
     sockaddr_in local_addr, peer_addr;
@@ -0,0 +1,79 @@
+/*
+ @ 0xCCCCCCCC
+*/
+
+#include "ezio/splice_pipe.h"
+
+#include <cerrno>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "kbase/error_exception_util.h"
+#include "kbase/logging.h"
+
+namespace {
+
+// Larger pipes take fewer rounds of splicing on bulk transfers; the kernel may refuse it
+// for exceeding /proc/sys/fs/pipe-max-size, and then the default one is used.
+constexpr int kPreferredPipeSize = 256 * 1024;
+
+constexpr unsigned int kSpliceFlags = SPLICE_F_MOVE | SPLICE_F_NONBLOCK;
+
+}   // namespace
+
+namespace ezio {
+
+SplicePipe::SplicePipe()
+    : capacity_(0),
+      buffered_size_(0)
+{
+    int fds[2] {};
+    ENSURE(THROW, pipe2(fds, O_NONBLOCK | O_CLOEXEC) == 0)(errno).Require();
+    read_end_.reset(fds[0]);
+    write_end_.reset(fds[1]);
+
+    int size = fcntl(write_end_.get(), F_SETPIPE_SZ, kPreferredPipeSize);
+    if (size < 0) {
+        size = fcntl(write_end_.get(), F_GETPIPE_SZ);
+    }
+
+    ENSURE(THROW, size > 0)(errno).Require();
+    capacity_ = static_cast<size_t>(size);
+}
+
+ssize_t SplicePipe::SpliceFrom(int fd)
+{
+    ENSURE(CHECK, buffered_size_ < capacity_)(buffered_size_)(capacity_).Require();
+
+    auto bytes_spliced = splice(fd, nullptr, write_end_.get(), nullptr,
+                                capacity_ - buffered_size_, kSpliceFlags);
+    if (bytes_spliced > 0) {
+        buffered_size_ += static_cast<size_t>(bytes_spliced);
+    }
+
+    return bytes_spliced;
+}
+
+ssize_t SplicePipe::SpliceTo(int fd)
+{
+    size_t total = 0;
+    while (buffered_size_ > 0) {
+        auto bytes_spliced = splice(read_end_.get(), nullptr, fd, nullptr, buffered_size_,
+                                    kSpliceFlags);
+        if (bytes_spliced < 0) {
+            if (errno == EAGAIN) {
+                break;
+            }
+
+            return -1;
+        }
+
+        buffered_size_ -= static_cast<size_t>(bytes_spliced);
+        total += static_cast<size_t>(bytes_spliced);
+    }
+
+    return static_cast<ssize_t>(total);
+}
+
+}   // namespace ezio
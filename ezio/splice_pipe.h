@@ -0,0 +1,56 @@
+/*
+ @ 0xCCCCCCCC
+*/
+
+#ifndef EZIO_SPLICE_PIPE_H_
+#define EZIO_SPLICE_PIPE_H_
+
+#include <sys/types.h>
+
+#include "kbase/basic_macros.h"
+#include "kbase/scoped_handle.h"
+
+namespace ezio {
+
+// SplicePipe moves data bytes from one socket to another in kernel space, by splicing them
+// into and then out of a pipe, and therefore they are never copied into user space.
+// Bytes spliced in but not yet out stay buffered in the pipe.
+class SplicePipe {
+public:
+    SplicePipe();
+
+    ~SplicePipe() = default;
+
+    DISALLOW_COPY(SplicePipe);
+
+    DEFAULT_MOVE(SplicePipe);
+
+    size_t capacity() const noexcept
+    {
+        return capacity_;
+    }
+
+    size_t buffered_size() const noexcept
+    {
+        return buffered_size_;
+    }
+
+    // Splices as many bytes as the pipe can take from `fd`.
+    // Returns the number of bytes spliced, or 0 if `fd` reached EOF, or -1 with errno set.
+    ssize_t SpliceFrom(int fd);
+
+    // Splices buffered bytes into `fd`, until the pipe is empty or `fd` can't take more.
+    // Returns the number of bytes spliced, which may be 0, or -1 with errno set if `fd`
+    // ran into an error other than EAGAIN.
+    ssize_t SpliceTo(int fd);
+
+private:
+    kbase::ScopedFD read_end_;
+    kbase::ScopedFD write_end_;
+    size_t capacity_;
+    size_t buffered_size_;
+};
+
+}   // namespace ezio
+
+#endif  // EZIO_SPLICE_PIPE_H_
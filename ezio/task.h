@@ -0,0 +1,226 @@
+/*
+ @ 0xCCCCCCCC
+*/
+
+#ifndef EZIO_TASK_H_
+#define EZIO_TASK_H_
+
+#include <cstddef>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "kbase/basic_macros.h"
+
+// Callables up to this many bytes are stored within a Task.
+// Must be defined the same for every translation unit, e.g. via a compile definition.
+#if !defined(EZIO_TASK_INLINE_SIZE)
+#define EZIO_TASK_INLINE_SIZE 64
+#endif
+
+namespace ezio {
+
+// Task is a move-only counterpart of std::function<void()>, with a larger inline storage.
+// Callables in no more than kInlineSize bytes, such as lambdas capturing a few strings and
+// shared pointers, or binds of member functions, are stored in place without allocation,
+// as long as they are nothrow move-constructible; others are allocated on the heap.
+class Task {
+public:
+    static constexpr size_t kInlineSize = EZIO_TASK_INLINE_SIZE;
+
+    Task() noexcept
+        : ops_(nullptr)
+    {}
+
+    Task(std::nullptr_t) noexcept
+        : ops_(nullptr)
+    {}
+
+    // Only callables taking no argument are accepted, thus misuses fail at the call site,
+    // and Task doesn't take part in overload resolution for other types.
+    template<typename F,
+             typename = std::enable_if_t<!std::is_same<std::decay_t<F>, Task>::value>,
+             typename = decltype(std::declval<std::decay_t<F>&>()())>
+    Task(F&& fn)
+        : ops_(nullptr)
+    {
+        if (!IsEmpty(fn)) {
+            Emplace<std::decay_t<F>>(std::forward<F>(fn), IsStoredInline<std::decay_t<F>>());
+        }
+    }
+
+    Task(Task&& other) noexcept
+        : ops_(nullptr)
+    {
+        TakeFrom(other);
+    }
+
+    Task& operator=(Task&& other) noexcept
+    {
+        if (this != &other) {
+            Reset();
+            TakeFrom(other);
+        }
+
+        return *this;
+    }
+
+    Task& operator=(std::nullptr_t) noexcept
+    {
+        Reset();
+        return *this;
+    }
+
+    ~Task()
+    {
+        Reset();
+    }
+
+    DISALLOW_COPY(Task);
+
+    // Like std::function, the call operator is const while the callable may mutate itself.
+    void operator()() const
+    {
+        if (!ops_) {
+            throw std::bad_function_call();
+        }
+
+        ops_->invoke(storage_);
+    }
+
+    explicit operator bool() const noexcept
+    {
+        return ops_ != nullptr;
+    }
+
+    // Returns true if `F` would be stored without allocation.
+    template<typename F>
+    static constexpr bool StoresInline() noexcept
+    {
+        return IsStoredInline<std::decay_t<F>>::value;
+    }
+
+private:
+    struct Ops {
+        void (*invoke)(void* storage);
+        // Move-constructs the callable into `dst` and destroys the one in `src`.
+        void (*relocate)(void* dst, void* src);
+        void (*destroy)(void* storage);
+    };
+
+    template<typename F>
+    using IsStoredInline = std::integral_constant<bool,
+        sizeof(F) <= kInlineSize && alignof(F) <= alignof(std::max_align_t) &&
+        std::is_nothrow_move_constructible<F>::value>;
+
+    template<typename F>
+    struct InlineOps {
+        static void Invoke(void* storage)
+        {
+            (*static_cast<F*>(storage))();
+        }
+
+        static void Relocate(void* dst, void* src)
+        {
+            auto fn = static_cast<F*>(src);
+            new (dst) F(std::move(*fn));
+            fn->~F();
+        }
+
+        static void Destroy(void* storage)
+        {
+            static_cast<F*>(storage)->~F();
+        }
+
+        static const Ops table;
+    };
+
+    template<typename F>
+    struct HeapOps {
+        static F*& Held(void* storage)
+        {
+            return *static_cast<F**>(storage);
+        }
+
+        static void Invoke(void* storage)
+        {
+            (*Held(storage))();
+        }
+
+        static void Relocate(void* dst, void* src)
+        {
+            new (dst) F*(Held(src));
+        }
+
+        static void Destroy(void* storage)
+        {
+            delete Held(storage);
+        }
+
+        static const Ops table;
+    };
+
+    template<typename F>
+    static bool IsEmpty(const F&) noexcept
+    {
+        return false;
+    }
+
+    template<typename R, typename... Args>
+    static bool IsEmpty(R (*fn)(Args...)) noexcept
+    {
+        return fn == nullptr;
+    }
+
+    template<typename Signature>
+    static bool IsEmpty(const std::function<Signature>& fn) noexcept
+    {
+        return !fn;
+    }
+
+    template<typename F, typename Arg>
+    void Emplace(Arg&& fn, std::true_type)
+    {
+        new (storage_) F(std::forward<Arg>(fn));
+        ops_ = &InlineOps<F>::table;
+    }
+
+    template<typename F, typename Arg>
+    void Emplace(Arg&& fn, std::false_type)
+    {
+        new (storage_) F*(new F(std::forward<Arg>(fn)));
+        ops_ = &HeapOps<F>::table;
+    }
+
+    void TakeFrom(Task& other) noexcept
+    {
+        if (other.ops_) {
+            other.ops_->relocate(storage_, other.storage_);
+            ops_ = other.ops_;
+            other.ops_ = nullptr;
+        }
+    }
+
+    void Reset() noexcept
+    {
+        if (ops_) {
+            ops_->destroy(storage_);
+            ops_ = nullptr;
+        }
+    }
+
+private:
+    alignas(std::max_align_t) mutable unsigned char storage_[kInlineSize];
+    const Ops* ops_;
+};
+
+template<typename F>
+const Task::Ops Task::InlineOps<F>::table {&Invoke, &Relocate, &Destroy};
+
+template<typename F>
+const Task::Ops Task::HeapOps<F>::table {&Invoke, &Relocate, &Destroy};
+
+}   // namespace ezio
+
+#endif  // EZIO_TASK_H_
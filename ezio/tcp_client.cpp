@@ -30,6 +30,7 @@ TCPClient::TCPClient(EventLoop* loop, const SocketAddress& remote_addr, std::str
       auto_reconnect_(false),
       connector_(MakeConnector(loop, remote_addr)),
       on_connection_destroy_(&OnConnectionDestroyDefault),
+      high_water_mark_(0),
       alive_token_(std::make_shared<AliveToken>())
 {
     connector_->set_on_new_connection(std::bind(&TCPClient::HandleNewConnection, this, _1, _2));
@@ -140,6 +141,8 @@ void TCPClient::HandleNewConnection(ScopedSocket&& sock, const SocketAddress& lo
     conn->set_on_destroy(on_connection_destroy_);
 
     conn->set_on_message(on_message_);
+    conn->set_on_high_water_mark(on_high_water_mark_, high_water_mark_);
+    conn->set_on_write_complete(on_write_complete_);
 
     {
         std::lock_guard<std::mutex> lock(conn_mutex_);
@@ -95,6 +95,18 @@ public:
         on_message_ = std::move(handler);
     }
 
+    // Handlers are installed on every new connection; see TCPConnection for details.
+    void set_on_high_water_mark(HighWaterMarkEventHandler handler, size_t mark)
+    {
+        on_high_water_mark_ = std::move(handler);
+        high_water_mark_ = mark;
+    }
+
+    void set_on_write_complete(WriteCompleteEventHandler handler)
+    {
+        on_write_complete_ = std::move(handler);
+    }
+
 private:
     void HandleNewConnection(ScopedSocket&& sock, const SocketAddress& local_addr);
 
@@ -114,6 +126,9 @@ private:
     DestroyEventHandler on_connection_destroy_;
 
     MessageEventHandler on_message_;
+    HighWaterMarkEventHandler on_high_water_mark_;
+    size_t high_water_mark_;
+    WriteCompleteEventHandler on_write_complete_;
 
     mutable std::mutex conn_mutex_;
     TCPConnectionPtr conn_;
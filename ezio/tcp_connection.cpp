@@ -18,6 +18,44 @@ using namespace std::placeholders;
 
 namespace ezio {
 
+template<typename Payload>
+class TCPConnection::PendingPayload : public PendingSend {
+public:
+    explicit PendingPayload(Payload&& payload)
+        : payload_(std::move(payload))
+    {}
+
+    explicit PendingPayload(const Payload& payload)
+        : payload_(payload)
+    {}
+
+    void SendOn(TCPConnection* conn) override
+    {
+        conn->DoSendOwned(std::move(payload_));
+    }
+
+private:
+    Payload payload_;
+};
+
+class TCPConnection::PendingFile : public PendingSend {
+public:
+    PendingFile(int fd, int64_t offset, size_t length, FileSentEventHandler on_sent)
+        : fd_(fd), offset_(offset), length_(length), on_sent_(std::move(on_sent))
+    {}
+
+    void SendOn(TCPConnection* conn) override
+    {
+        conn->DoSendFile(fd_, offset_, length_, std::move(on_sent_));
+    }
+
+private:
+    int fd_;
+    int64_t offset_;
+    size_t length_;
+    FileSentEventHandler on_sent_;
+};
+
 TCPConnection::TCPConnection(EventLoop* loop,
                              std::string name,
                              ScopedSocket&& conn_sock,
@@ -29,7 +67,31 @@ TCPConnection::TCPConnection(EventLoop* loop,
       conn_sock_(std::move(conn_sock)),
       conn_notifier_(loop, conn_sock_),
       local_addr_(local_addr),
-      peer_addr_(peer_addr)
+      peer_addr_(peer_addr),
+      reading_paused_(false),
+      input_buffer_limit_(0),
+      input_limit_reached_(false)
+#if defined(OS_POSIX)
+      // Readiness-based reads scatter into any number of blocks, thus the connection can
+      // borrow its storage from the loop and give it back once drained.
+      // Completion-based reads on Windows need a contiguous region instead.
+      , input_buf_(Buffer::MakeChained(loop->block_pool())),
+      output_queue_(loop->block_pool()),
+      relay_eof_(false),
+      zerocopy_threshold_(0),
+      zerocopy_enabled_(false),
+      zerocopy_next_id_(0),
+      auto_cork_(false),
+      corked_write_queued_(false),
+      edge_triggered_(false),
+      awaiting_writable_(false),
+      read_resumption_queued_(false),
+      write_resumption_queued_(false),
+      io_ring_(false),
+      ring_send_in_flight_(false)
+#endif
+      , high_water_mark_(0),
+      write_complete_queued_(false)
 {
     conn_notifier_.set_on_read(std::bind(&TCPConnection::HandleRead, this, _1, _2));
     conn_notifier_.set_on_write(std::bind(&TCPConnection::HandleWrite, this, _1));
@@ -55,18 +117,89 @@ void TCPConnection::Send(kbase::StringView data)
     if (loop_->BelongsToCurrentThread()) {
         DoSend(data);
     } else {
-        loop_->QueueTask([replica = data.ToString(), self = shared_from_this()] () mutable {
-            self->DoSend(std::move(replica));
-        });
+        QueuePendingSend(std::make_unique<PendingPayload<std::string>>(data.ToString()));
+    }
+}
+
+template<typename Payload>
+void TCPConnection::SendOwned(Payload&& payload)
+{
+    if (state() != State::Connected) {
+        LOG(WARNING) << "Writing to a not-connected connection!";
+        return;
+    }
+
+    if (loop_->BelongsToCurrentThread()) {
+        DoSendOwned(std::forward<Payload>(payload));
+    } else {
+        using Pending = PendingPayload<std::decay_t<Payload>>;
+        QueuePendingSend(std::make_unique<Pending>(std::forward<Payload>(payload)));
+    }
+}
+
+void TCPConnection::Send(std::string&& data)
+{
+    SendOwned(std::move(data));
+}
+
+void TCPConnection::Send(Buffer&& buf)
+{
+    // Pooled blocks have to go back to their pool on its own thread, thus such a buffer,
+    // e.g. the input buffer echoed back in the message handler, is sent as a copy.
+    if (buf.pooled()) {
+        Buffer copy(buf);
+        buf.ConsumeAll();
+        SendOwned(std::move(copy));
+        return;
+    }
+
+    SendOwned(std::move(buf));
+}
+
+void TCPConnection::Send(std::vector<char>&& data)
+{
+    SendOwned(std::move(data));
+}
+
+void TCPConnection::Send(const SharedPayload& payload)
+{
+    // Takes a share of the payload, which is all queuing it takes anyway.
+    SendOwned(SharedPayload(payload));
+}
+
+void TCPConnection::SendFile(int fd, int64_t offset, size_t length,
+                             FileSentEventHandler on_sent)
+{
+    if (state() != State::Connected) {
+        LOG(WARNING) << "Writing to a not-connected connection!";
+        if (on_sent) {
+            loop_->RunTask(std::bind(on_sent, shared_from_this(), false));
+        }
+
+        return;
+    }
+
+    if (loop_->BelongsToCurrentThread()) {
+        DoSendFile(fd, offset, length, std::move(on_sent));
+    } else {
+        QueuePendingSend(std::make_unique<PendingFile>(fd, offset, length, std::move(on_sent)));
+    }
+}
+
+void TCPConnection::QueuePendingSend(std::unique_ptr<PendingSend> send)
+{
+    if (pending_sends_.Push(std::move(send))) {
+        loop_->QueueTask(std::bind(&TCPConnection::DrainPendingSends, shared_from_this()));
     }
 }
 
-void TCPConnection::DoSend(std::string&& data)
+void TCPConnection::DrainPendingSends()
 {
     ENSURE(CHECK, loop_->BelongsToCurrentThread()).Require();
 
-    auto str = std::move(data);
-    DoSend(str);
+    pending_sends_.ConsumeAll([this](std::unique_ptr<PendingSend> send) {
+        send->SendOn(this);
+    });
 }
 
 void TCPConnection::MakeEstablished()
@@ -77,13 +210,25 @@ void TCPConnection::MakeEstablished()
     set_state(State::Connected);
 
     conn_notifier_.WeaklyBind(shared_from_this());
-    conn_notifier_.EnableReading();
+
+#if defined(OS_POSIX)
+    if (loop_->io_ring_enabled() && zerocopy_threshold_ == 0 && input_buffer_limit_ == 0) {
+        io_ring_ = true;
+        conn_notifier_.SetRingRead(Notifier::RingRead::Receive);
+    }
+#endif
+
+    if (!reading_paused_) {
+        conn_notifier_.EnableReading();
+    }
 
     on_connect_(shared_from_this());
 
 #if defined(OS_WIN)
-    ENSURE(CHECK, io_reqs_.read_req.IsProbing())(io_reqs_.read_req.events).Require();
-    PostRead();
+    if (conn_notifier_.WatchReading()) {
+        ENSURE(CHECK, io_reqs_.read_req.IsProbing())(io_reqs_.read_req.events).Require();
+        PostRead();
+    }
 #endif
 }
 
@@ -102,6 +247,44 @@ void TCPConnection::MakeTeardown()
     on_destroy_(shared_from_this());
 
     conn_notifier_.Detach();
+
+    ReleaseBuffers();
+}
+
+void TCPConnection::PauseReading()
+{
+    loop_->RunTask(std::bind(&TCPConnection::DoPauseReading, shared_from_this()));
+}
+
+void TCPConnection::DoPauseReading()
+{
+    ENSURE(CHECK, loop_->BelongsToCurrentThread()).Require();
+
+    reading_paused_ = true;
+    UpdateReading();
+}
+
+void TCPConnection::ResumeReading()
+{
+    loop_->RunTask(std::bind(&TCPConnection::DoResumeReading, shared_from_this()));
+}
+
+void TCPConnection::DoResumeReading()
+{
+    ENSURE(CHECK, loop_->BelongsToCurrentThread()).Require();
+
+    reading_paused_ = false;
+
+    // Bytes held in the input buffer are reachable only from the message handler.
+    if (input_limit_reached_ && state() != State::Disconnected) {
+        input_limit_reached_ = false;
+        if (input_buf_.readable_size() > 0) {
+            on_message_(shared_from_this(), input_buf_, loop_->Now());
+            input_limit_reached_ = IsInputBufferFull();
+        }
+    }
+
+    UpdateReading();
 }
 
 void TCPConnection::Shutdown()
@@ -119,7 +302,9 @@ void TCPConnection::DoShutdown()
 
     ENSURE(CHECK, loop_->BelongsToCurrentThread()).Require();
 
-    if (!conn_notifier_.WatchWriting()) {
+    // Data not yet written are waiting for either the socket to become writable, or the
+    // end of the loop iteration if corked.
+    if (!IsWaitingForWritable() && output_queue_.empty()) {
         socket::ShutdownWrite(conn_sock_);
     }
 }
@@ -167,9 +352,67 @@ void TCPConnection::HandleClose()
     on_close_(conn);
 }
 
-void TCPConnection::HandleError() const
+void TCPConnection::ReleaseBuffers()
+{
+    // Pooled blocks must be returned on the loop thread, and the connection itself may be
+    // destroyed elsewhere, or even after its loop.
+    // Not done in HandleClose(), which may be reached from within a message handler that
+    // still refers to the input buffer.
+    // Buffers on Windows are not pooled and may still be referenced by pending IO requests.
+#if defined(OS_POSIX)
+    input_buf_.ConsumeAll();
+    output_queue_.Clear();
+    DetachRelaySink();
+    // The kernel may still be transmitting from these payloads, e.g. while the socket
+    // lingers after shutdown, thus they are kept until completions are reported.
+    if (zerocopy_enabled_) {
+        ReapZeroCopyCompletions();
+    }
+
+    if (!zerocopy_pending_.empty()) {
+        loop_->zerocopy_graveyard()->Adopt(conn_sock_, std::move(zerocopy_pending_));
+        zerocopy_pending_.clear();
+    }
+#endif
+}
+
+void TCPConnection::CheckHighWaterMark(size_t prev_size)
+{
+    auto queued_size = output_queue_.size();
+    if (on_high_water_mark_ && prev_size < high_water_mark_ && queued_size >= high_water_mark_) {
+        on_high_water_mark_(shared_from_this(), queued_size);
+    }
+}
+
+void TCPConnection::NotifyWriteComplete()
+{
+    if (!on_write_complete_ || write_complete_queued_) {
+        return;
+    }
+
+    write_complete_queued_ = true;
+    loop_->QueueTask([this, self = shared_from_this()] {
+        write_complete_queued_ = false;
+        if (output_queue_.empty() && state() != State::Disconnected) {
+            on_write_complete_(self);
+        }
+    });
+}
+
+void TCPConnection::HandleError()
 {
     auto err_code = socket::GetSocketErrorCode(conn_sock_);
+#if defined(OS_POSIX)
+    // Completion reports of zero-copy sends are queued as errors as well, and the error
+    // event keeps coming until all of them are read, even if no send is pending.
+    if (zerocopy_enabled_) {
+        ReapZeroCopyCompletions();
+        if (err_code == 0) {
+            return;
+        }
+    }
+#endif
+
     LOG(ERROR) << "Error occurred on " << name() << " with code " << err_code;
 }
 
@@ -6,19 +6,29 @@
 #define EZIO_TCP_CONNECTION_H_
 
 #include <atomic>
+#include <cstdint>
+#include <limits>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "kbase/basic_macros.h"
 #include "kbase/string_view.h"
 
 #include "ezio/buffer.h"
 #include "ezio/common_event_handlers.h"
+#include "ezio/mpsc_queue.h"
 #include "ezio/notifier.h"
+#include "ezio/output_queue.h"
+#include "ezio/recv_size_predictor.h"
 #include "ezio/scoped_socket.h"
+#include "ezio/shared_payload.h"
 #include "ezio/socket_address.h"
 
-#if defined(OS_WIN)
+#if defined(OS_POSIX)
+#include "ezio/splice_pipe.h"
+#include "ezio/zerocopy_graveyard.h"
+#elif defined(OS_WIN)
 #include "ezio/io_context.h"
 #endif
 
@@ -28,6 +38,29 @@ class EventLoop;
 
 class TCPConnection : public std::enable_shared_from_this<TCPConnection> {
 public:
+#if defined(OS_POSIX)
+    // Bytes to read, or to write, for one edge-triggered event at most; the loop's read
+    // budget, if set, takes over for reading.
+    static constexpr size_t kIOBudgetPerEvent = 256 * 1024;
+
+    struct ZeroCopyStats {
+        // Send calls with MSG_ZEROCOPY that transmitted data, and bytes they transmitted.
+        uint64_t sends = 0;
+        uint64_t bytes = 0;
+        // Sends reported complete by the kernel, which has then released the payloads;
+        // `copied` of them ended up being copied by the kernel anyway, e.g. on loopback.
+        uint64_t completions = 0;
+        uint64_t copied = 0;
+        // Sends that fell back to copying, because the kernel ran out of its option memory.
+        uint64_t fallbacks = 0;
+
+        uint64_t pending() const noexcept
+        {
+            return sends - completions;
+        }
+    };
+#endif
+
     // The instance is created in `Connecting` state and becomes `Connected` after execution
     // of MakeEstablished(). Once Shutdown() is called, the state then transitions into
     // `Disconnecting` state, and it finally turns into `Disconnected` either by HandleClose()
@@ -48,9 +81,108 @@ public:
 
     DISALLOW_MOVE(TCPConnection);
 
+    // Data bytes are copied if called on other threads.
     // This function is thread-safe.
     void Send(kbase::StringView data);
 
+    // This function is thread-safe.
+    void Send(const char* data)
+    {
+        Send(kbase::StringView(data));
+    }
+
+    // Takes over the storage of `data`, which is then queued and written as it is, and
+    // thus is never copied on whichever thread the function is called.
+    // This function is thread-safe.
+    void Send(std::string&& data);
+
+    // Same as above, except that a buffer borrowing blocks from a BlockPool, e.g. the input
+    // buffer, is copied and then consumed.
+    // This function is thread-safe.
+    void Send(Buffer&& buf);
+
+    // Same as above.
+    // This function is thread-safe.
+    void Send(std::vector<char>&& data);
+
+    // Queues bytes of `payload` without copying them, even if called on other threads.
+    // Prefer this overload when sending the same data to many connections.
+    // This function is thread-safe.
+    void Send(const SharedPayload& payload);
+
+    // Queues `length` bytes of the file `fd` starting at `offset`, in order with data sent
+    // by other calls. On POSIX, the bytes are copied from the file into the socket by the
+    // kernel via sendfile(), and are never read into user space; a connection on a loop
+    // running on io_uring switches to readiness-based IO for it.
+    // The file must stay open until `on_sent` is run, on the loop thread, either with true
+    // once all bytes have been written, or with false if the region is abandoned, e.g. the
+    // connection is down.
+    // This function is thread-safe.
+    void SendFile(int fd, int64_t offset, size_t length, FileSentEventHandler on_sent);
+
+#if defined(OS_POSIX)
+    // Relays data bytes received from now on to `sink`, moving them in kernel space via
+    // splice() without reading them into user space; the message handler is not called for
+    // them. Bytes left in the input buffer are sent to `sink` first.
+    // Reading pauses whenever `sink` can't take more, and resumes once it drains.
+    // When the peer half-closes, the connection is closed as usual after all relayed bytes
+    // are written. If `sink` goes down, received bytes go to the message handler again.
+    // Both connections must run on the same loop; call it on each one to relay both ways.
+    // Both switch to readiness-based IO if the loop runs on io_uring.
+    // This function is thread-safe.
+    void RelayTo(const TCPConnectionPtr& sink);
+
+    // Sends payloads at least `threshold` bytes long via send() with MSG_ZEROCOPY, if they
+    // were handed over by move or shared, rather than copied; 0 disables it, as is default.
+    // Such a payload is released once the kernel reports it is done with the memory, which
+    // saves copying large payloads into the kernel, though each send takes extra work for
+    // pinning pages and reaping the report; it pays off only for payloads of hundreds of KB
+    // or larger. Enabling it switches a connection on io_uring to readiness-based IO.
+    // This function is thread-safe.
+    void SetZeroCopyThreshold(size_t threshold);
+
+    // Must be called on connection's loop thread.
+    const ZeroCopyStats& zerocopy_stats() const noexcept
+    {
+        return zerocopy_stats_;
+    }
+
+    // When enabled, data sent during a loop iteration are only queued, and then written
+    // together at the end of the iteration, in one writev() call if the socket takes them
+    // all; this saves syscalls for handlers making several sends for each message.
+    // This function is thread-safe.
+    void SetAutoCork(bool enable);
+
+    // When enabled, the socket is watched edge-triggered: each read or write event is
+    // handled until the socket is drained or full, up to kIOBudgetPerEvent bytes, or for
+    // reads, to the read budget of the loop if set; the rest, if any, is picked up after
+    // other events of the loop iteration. Write interest
+    // then stays registered, rather than being toggled whenever the socket fills up and
+    // drains, which saves an epoll_ctl() each time.
+    // Connections relaying data, or doing IO on the loop's io_uring, stay as they are.
+    // Call it on a connected connection, e.g. in the connect handler.
+    // This function is thread-safe.
+    void SetEdgeTriggered(bool enable);
+
+    // Lets reads on the socket busy-poll the device queue for up to `usec` microseconds;
+    // pairs with EventLoop::SetBusyPollWindow() for latency-critical connections.
+    // Returns false if not permitted.
+    // This function is thread-safe.
+    bool SetBusyPoll(int usec);
+#endif
+
+    // Stops reading from the socket, thus the peer is throttled by TCP flow control once
+    // socket buffers fill up. Bytes already received stay in the input buffer.
+    // On Windows, or on a loop running on io_uring, reads in flight still complete as usual.
+    // This function is thread-safe.
+    void PauseReading();
+
+    // Resumes reading paused either by PauseReading() or by the input buffer limit.
+    // In the latter case, the message handler is run again with bytes held in the input
+    // buffer first, and reading resumes only if they have dropped below the limit.
+    // This function is thread-safe.
+    void ResumeReading();
+
     // This function is thread-safe.
     void Shutdown();
 
@@ -115,7 +247,54 @@ public:
         on_destroy_ = std::move(handler);
     }
 
+    // Reading stops whenever the input buffer still holds at least `limit` bytes after the
+    // message handler returns, until ResumeReading() is called; 0 disables it, as is default.
+    // Setting a limit switches a connection on io_uring to readiness-based IO, because
+    // receives there take all the socket has, leaving nothing to hold back.
+    // Must be called on connection's loop thread, or before the connection is established.
+    void set_input_buffer_limit(size_t limit)
+    {
+        input_buffer_limit_ = limit;
+#if defined(OS_POSIX)
+        if (limit > 0) {
+            LeaveIORing();
+        }
+#endif
+    }
+
+    // `handler` is run each time the size of data waiting in the output queue rises to or
+    // above `mark` bytes from below, along with the size; producers should hold off sending
+    // until the write-complete handler is run.
+    // The handler is run on the loop thread right after the data are queued, thus producers
+    // on the loop thread see it before sending any more.
+    void set_on_high_water_mark(HighWaterMarkEventHandler handler, size_t mark)
+    {
+        on_high_water_mark_ = std::move(handler);
+        high_water_mark_ = mark;
+    }
+
+    // `handler` is run each time all data sent have been written into the socket.
+    // The handler is queued to the loop, since it is free to send more data.
+    void set_on_write_complete(WriteCompleteEventHandler handler)
+    {
+        on_write_complete_ = std::move(handler);
+    }
+
 private:
+    // Data sent from other threads wait in `pending_sends_` until the loop thread drains
+    // them, in the order they were sent.
+    class PendingSend : public MPSCQueueNode {
+    public:
+        virtual ~PendingSend() = default;
+
+        virtual void SendOn(TCPConnection* conn) = 0;
+    };
+
+    template<typename Payload>
+    class PendingPayload;
+
+    class PendingFile;
+
     State state() const noexcept
     {
         return state_.load(std::memory_order_acquire);
@@ -128,21 +307,142 @@ private:
 
     void DoSend(kbase::StringView data);
 
-    void DoSend(std::string&& data);
+    // Sends a payload whose storage, or share of it, is handed over to the output queue.
+    template<typename Payload>
+    void SendOwned(Payload&& payload);
+
+    // Queues the payload handed over by SendOwned() and writes it; instantiated in the
+    // platform-specific part for each type of payload taken.
+    template<typename Payload>
+    void DoSendOwned(Payload&& payload);
+
+    void DoSendFile(int fd, int64_t offset, size_t length, FileSentEventHandler on_sent);
+
+    // Queues `send` made on other threads; the first one queued after a drain schedules
+    // the next drain on the loop.
+    void QueuePendingSend(std::unique_ptr<PendingSend> send);
+
+    void DrainPendingSends();
 
     void DoShutdown();
 
     void DoForceClose();
 
+    // Returns true if data or relayed bytes are waiting for the socket to become writable.
+    bool IsWaitingForWritable() const noexcept
+    {
+#if defined(OS_POSIX)
+        if (ring_send_in_flight_) {
+            return true;
+        }
+
+        if (edge_triggered_) {
+            return awaiting_writable_;
+        }
+#endif
+        return conn_notifier_.WatchWriting();
+    }
+
+    void DoPauseReading();
+
+    void DoResumeReading();
+
+    // Returns true if the input buffer holds no less than the limit.
+    bool IsInputBufferFull() const noexcept
+    {
+        return input_buffer_limit_ > 0 && input_buf_.readable_size() >= input_buffer_limit_;
+    }
+
+    // Starts or stops watching reading, depending on whether reading is paused or held back.
+    void UpdateReading();
+
     void HandleRead(TimePoint timestamp, IOContext::Details details);
 
     void HandleWrite(IOContext::Details details);
 
     void HandleClose();
 
-    void HandleError() const;
+    void HandleError();
 
-#if defined(OS_WIN)
+    // Drops pending data bytes and returns pooled storage of both buffers; payloads of
+    // zero-copy sends not yet completed are handed to the loop instead.
+    void ReleaseBuffers();
+
+    // Runs the high-water-mark handler if the output queue, which was `prev_size` bytes
+    // before data were sent, has just risen to the mark.
+    void CheckHighWaterMark(size_t prev_size);
+
+    // Queues the write-complete handler, which is run only if the output queue is still
+    // drained by then.
+    void NotifyWriteComplete();
+
+#if defined(OS_POSIX)
+    // Writes data just queued into a previously empty output queue, or at the end of the
+    // loop iteration if auto-cork is enabled.
+    void WriteQueuedData();
+
+    // Writes queued data right away, and watches writing if any of them are left; on the
+    // ring, they are sent along with other requests of the loop instead, unless corked.
+    void WriteOutputQueue();
+
+    void HandleCorkedWrite();
+
+    void DoSetEdgeTriggered(bool enable);
+
+    // Watches writing, or just marks data as waiting if write interest stays registered.
+    void WaitForWritable();
+
+    void StopWaitingForWritable();
+
+    // Sends queued data on the ring, if no send is in flight.
+    void SubmitRingSend();
+
+    void HandleReceiveCompletion(TimePoint timestamp, IOContext::Details details);
+
+    void HandleSendCompletion(int result);
+
+    // Switches to readiness-based IO, for sendfile(), splice() and zero-copy sends, which
+    // have no counterparts on the ring working with our buffers, and for the input limit.
+    // A receive in flight still completes, and readiness of reading is watched only after
+    // that; a send in flight holds back other writes until it completes.
+    void LeaveIORing();
+
+    // Handles reads, or writes, left behind by an edge-triggered event out of budget.
+    void ResumeReadLater();
+
+    void ResumeWriteLater();
+
+    void DoRelayTo(const TCPConnectionPtr& sink);
+
+    void HandleRelayRead();
+
+    // Moves bytes buffered in the relay pipe into the sink, and pauses or resumes reading
+    // depending on whether the sink takes all of them.
+    void PumpRelay();
+
+    // Returns true if relayed bytes are waiting for the sink to become writable.
+    bool HasPendingRelayData() const noexcept;
+
+    void StopRelaying();
+
+    // Drops the relay pipe along with bytes in it, and lets the sink stop waiting for them.
+    void DetachRelaySink();
+
+    // Sends the front segment of the output queue with MSG_ZEROCOPY and holds its storage
+    // until the kernel reports completion.
+    ssize_t SendZeroCopy(OutputQueue::SharedSegment&& segment);
+
+    // Reads completion reports of zero-copy sends from the socket error queue until it is
+    // drained, and releases payloads of completed sends.
+    void ReapZeroCopyCompletions();
+
+    // Writes queued data, gathering in-memory data into one writev() call and sending file
+    // regions via sendfile(), until the socket is full or the queue is drained, or no less
+    // than `budget` bytes are written, in which case `budget_exhausted` is set if given.
+    // Returns false if the socket ran into an error other than EAGAIN.
+    bool FlushOutputQueue(size_t budget = std::numeric_limits<size_t>::max(),
+                          bool* budget_exhausted = nullptr);
+#elif defined(OS_WIN)
     void PostRead();
 
     void PostWrite();
@@ -159,8 +459,47 @@ private:
     SocketAddress local_addr_;
     SocketAddress peer_addr_;
 
+    bool reading_paused_;
+    size_t input_buffer_limit_;
+    bool input_limit_reached_;
+
     Buffer input_buf_;
-    Buffer output_buf_;
+    OutputQueue output_queue_;
+
+    MPSCQueue<PendingSend> pending_sends_;
+
+#if defined(OS_POSIX)
+    RecvSizePredictor recv_size_predictor_;
+
+    // Present while received bytes are relayed to `relay_sink_`.
+    std::unique_ptr<SplicePipe> relay_pipe_;
+    std::weak_ptr<TCPConnection> relay_sink_;
+    bool relay_eof_;
+
+    // The connection relaying its received bytes to this one.
+    std::weak_ptr<TCPConnection> relay_source_;
+
+    size_t zerocopy_threshold_;
+    // Set once SO_ZEROCOPY is on, after which completion reports may arrive at any time.
+    bool zerocopy_enabled_;
+    // The kernel numbers zero-copy sends on a socket sequentially from 0.
+    uint32_t zerocopy_next_id_;
+    ZeroCopyPendingSends zerocopy_pending_;
+    ZeroCopyStats zerocopy_stats_;
+
+    bool auto_cork_;
+    bool corked_write_queued_;
+
+    bool edge_triggered_;
+    // Under edge-triggered mode, whether data are waiting for the socket to become writable.
+    bool awaiting_writable_;
+    bool read_resumption_queued_;
+    bool write_resumption_queued_;
+
+    // Set while reads and writes run on the loop's io_uring.
+    bool io_ring_;
+    bool ring_send_in_flight_;
+#endif
 
 #if defined(OS_WIN)
     struct IORequests {
@@ -183,6 +522,10 @@ private:
     ConnectionEventHandler on_disconnect_;
     CloseEventHandler on_close_;
     DestroyEventHandler on_destroy_;
+    HighWaterMarkEventHandler on_high_water_mark_;
+    size_t high_water_mark_;
+    WriteCompleteEventHandler on_write_complete_;
+    bool write_complete_queued_;
 };
 
 using TCPConnectionPtr = std::shared_ptr<TCPConnection>;
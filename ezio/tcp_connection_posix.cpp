@@ -4,26 +4,140 @@
 
 #include "ezio/tcp_connection.h"
 
+#include <algorithm>
+#include <limits>
+
+#include <sys/sendfile.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
 #include "kbase/error_exception_util.h"
 #include "kbase/logging.h"
 
 #include "ezio/event_loop.h"
+#include "ezio/socket_utils.h"
+
+// Available since Linux 4.14, while libc headers may be older.
+#if !defined(MSG_ZEROCOPY)
+#define MSG_ZEROCOPY 0x4000000
+#endif
+
+namespace {
+
+// Linux transfers at most this many bytes in one sendfile() call.
+constexpr size_t kMaxSendFileSize = 0x7ffff000;
+
+}   // namespace
 
 namespace ezio {
 
-void TCPConnection::HandleRead(TimePoint timestamp, IOContext::Details)
+constexpr size_t TCPConnection::kIOBudgetPerEvent;
+
+void TCPConnection::HandleRead(TimePoint timestamp, IOContext::Details details)
 {
     ENSURE(CHECK, loop_->BelongsToCurrentThread()).Require();
 
-    ssize_t bytes_read = ReadFDInVec(conn_sock_.get(), input_buf_);
-    if (bytes_read < 0) {
-        auto err = errno;
-        LOG(ERROR) << "Failed to read data from socket " << conn_sock_.get() << "; err: " << err;
-        HandleError();
-    } else if (bytes_read == 0) {
-        HandleClose();
-    } else {
+    if (details.completed) {
+        HandleReceiveCompletion(timestamp, details);
+        return;
+    }
+
+    if (relay_pipe_) {
+        auto sink = relay_sink_.lock();
+        if (sink && sink->state() != State::Disconnected) {
+            HandleRelayRead();
+            return;
+        }
+
+        StopRelaying();
+    }
+
+    // Level-triggered events keep coming while bytes are left in the socket, and thus one
+    // read per event is enough; edge-triggered ones don't.
+    // Bytes read upon one event are capped by the loop's read budget, if any.
+    auto read_budget = loop_->iteration_budget().max_read_bytes;
+    if (read_budget == 0) {
+        read_budget = edge_triggered_ ? kIOBudgetPerEvent : std::numeric_limits<size_t>::max();
+    }
+
+    size_t total_read = 0;
+    while (true) {
+        auto budget_left = read_budget - total_read;
+        auto recv_size = std::min(recv_size_predictor_.next_size(), budget_left);
+        auto spill_size = std::min(EventLoop::kRecvSpillAreaSize, budget_left - recv_size);
+        ssize_t bytes_read = ReadFDInVec(conn_sock_.get(),
+                                         input_buf_,
+                                         recv_size,
+                                         loop_->recv_spill_area(),
+                                         spill_size);
+        if (bytes_read > 0) {
+            recv_size_predictor_.Record(static_cast<size_t>(bytes_read));
+        }
+
+        if (bytes_read < 0) {
+            // Nothing to read, e.g. the socket drained under edge-triggered mode, or a read
+            // resumed after the connection switched back to level-triggered.
+            auto err = errno;
+            if (err == EAGAIN) {
+                return;
+            }
+
+            LOG(ERROR) << "Failed to read data from socket " << conn_sock_.get()
+                       << "; err: " << err;
+            HandleError();
+            return;
+        }
+
+        if (bytes_read == 0) {
+            HandleClose();
+            return;
+        }
+
         on_message_(shared_from_this(), input_buf_, timestamp);
+        if (IsInputBufferFull()) {
+            input_limit_reached_ = true;
+            UpdateReading();
+            return;
+        }
+
+        total_read += static_cast<size_t>(bytes_read);
+        if (total_read >= read_budget) {
+            loop_->CountReadBudgetHit();
+            // Level-triggered events report the rest anyway.
+            if (edge_triggered_) {
+                ResumeReadLater();
+            }
+
+            return;
+        }
+
+        // Stop once a read short of the whole capacity has drained the socket, or reading
+        // is off.
+        if (!edge_triggered_ || static_cast<size_t>(bytes_read) < recv_size + spill_size ||
+            !conn_notifier_.WatchReading()) {
+            return;
+        }
+    }
+}
+
+void TCPConnection::UpdateReading()
+{
+    if (state() != State::Connected && state() != State::Disconnecting) {
+        return;
+    }
+
+    // Relayed bytes waiting for the sink, or the drained socket, hold back reading as well.
+    bool should_read = !reading_paused_ && !input_limit_reached_ && !relay_eof_ &&
+                       !HasPendingRelayData();
+    if (should_read && !conn_notifier_.WatchReading()) {
+        conn_notifier_.EnableReading();
+        // Re-enabling in the iteration that disabled reading cancels out and doesn't re-arm
+        // an edge-triggered fd, and bytes left in the socket raise no new edge anyway.
+        if (edge_triggered_) {
+            ResumeReadLater();
+        }
+    } else if (!should_read && conn_notifier_.WatchReading()) {
+        conn_notifier_.DisableReading();
     }
 }
 
@@ -37,10 +151,11 @@ void TCPConnection::DoSend(kbase::StringView data)
         return;
     }
 
-    // If no data queued in the output buffer, write to the socket directly.
+    // If no data queued in the output queue, write to the socket directly, unless relayed
+    // bytes are waiting for the socket to become writable, or writes are corked, or go to
+    // the ring.
     size_t remaining = data.size();
-    if (output_buf_.readable_size() == 0) {
-        ENSURE(CHECK, !conn_notifier_.WatchWriting())(conn_notifier_.watching_events()).Require();
+    if (output_queue_.empty() && !IsWaitingForWritable() && !auto_cork_ && !io_ring_) {
         auto bytes_written = write(conn_sock_.get(), data.data(), data.size());
         if (bytes_written < 0) {
             if (errno != EAGAIN) {
@@ -59,40 +174,667 @@ void TCPConnection::DoSend(kbase::StringView data)
     ENSURE(CHECK, remaining <= data.size())(remaining)(data.size()).Require();
 
     if (remaining == 0) {
+        NotifyWriteComplete();
         return;
     }
 
+    auto prev_size = output_queue_.size();
     auto written_size = data.size() - remaining;
-    output_buf_.Write(data.data() + written_size, remaining);
+    output_queue_.Append(kbase::StringView(data.data() + written_size, remaining));
 
-    if (!conn_notifier_.WatchWriting()) {
-        conn_notifier_.EnableWriting();
+    if (auto_cork_) {
+        if (prev_size == 0) {
+            WriteQueuedData();
+        }
+    } else {
+        WaitForWritable();
+    }
+
+    CheckHighWaterMark(prev_size);
+}
+
+template<typename Payload>
+void TCPConnection::DoSendOwned(Payload&& payload)
+{
+    ENSURE(CHECK, loop_->BelongsToCurrentThread()).Require();
+
+    if (state() != State::Connected) {
+        LOG(WARNING) << "Writing to a not-connected connection!";
+        return;
+    }
+
+    // The payload, or a share of it, is owned by the queue from now on, and is written from
+    // there.
+    auto prev_size = output_queue_.size();
+    output_queue_.Append(std::forward<Payload>(payload));
+
+    if (prev_size == 0) {
+        WriteQueuedData();
     }
+
+    CheckHighWaterMark(prev_size);
 }
 
-void TCPConnection::HandleWrite(IOContext::Details)
+template void TCPConnection::DoSendOwned<std::string>(std::string&&);
+template void TCPConnection::DoSendOwned<Buffer>(Buffer&&);
+template void TCPConnection::DoSendOwned<std::vector<char>>(std::vector<char>&&);
+template void TCPConnection::DoSendOwned<SharedPayload>(SharedPayload&&);
+
+void TCPConnection::DoSendFile(int fd, int64_t offset, size_t length,
+                               FileSentEventHandler on_sent)
 {
     ENSURE(CHECK, loop_->BelongsToCurrentThread()).Require();
-    ENSURE(CHECK, output_buf_.readable_size() > 0).Require();
 
-    if (!conn_notifier_.WatchWriting()) {
-        LOG(INFO) << "The connection of the socket " << conn_sock_.get() << " is down!";
+    if (state() != State::Connected) {
+        LOG(WARNING) << "Writing to a not-connected connection!";
+        if (on_sent) {
+            on_sent(shared_from_this(), false);
+        }
+
+        return;
+    }
+
+    LeaveIORing();
+
+    // The handler is deferred, because the queue may be in the middle of a flush when the
+    // region finishes, and the handler is free to send more data.
+    OutputQueue::FileRegionHandler on_done;
+    if (on_sent) {
+        on_done = [this, on_sent = std::move(on_sent)](bool completed) {
+            loop_->QueueTask(std::bind(on_sent, shared_from_this(), completed));
+        };
+    }
+
+    auto prev_size = output_queue_.size();
+    output_queue_.AppendFile(fd, offset, length, std::move(on_done));
+
+    if (prev_size == 0 && !output_queue_.empty()) {
+        WriteQueuedData();
+    }
+
+    CheckHighWaterMark(prev_size);
+}
+
+void TCPConnection::WriteQueuedData()
+{
+    // Relayed bytes are waiting for the socket, and queued data will follow them.
+    if (IsWaitingForWritable()) {
+        return;
+    }
+
+    if (auto_cork_) {
+        if (!corked_write_queued_) {
+            corked_write_queued_ = true;
+            loop_->RunAtIterationEnd(std::bind(&TCPConnection::HandleCorkedWrite,
+                                               shared_from_this()));
+        }
+
+        return;
+    }
+
+    WriteOutputQueue();
+}
+
+void TCPConnection::WriteOutputQueue()
+{
+    if (io_ring_ && !auto_cork_) {
+        SubmitRingSend();
+        return;
+    }
+
+    if (!FlushOutputQueue()) {
+        LOG(ERROR) << "Writing failure; abandon unwritten data!";
+        output_queue_.Clear();
+        return;
+    }
+
+    if (output_queue_.empty()) {
+        NotifyWriteComplete();
+    } else {
+        WaitForWritable();
+    }
+}
+
+bool TCPConnection::FlushOutputQueue(size_t budget, bool* budget_exhausted)
+{
+    // One call carries either a file region or in-memory data before the next region, thus
+    // keep writing as long as the socket takes everything handed over.
+    size_t total_written = 0;
+    while (!output_queue_.empty()) {
+        size_t expected_size = 0;
+        ssize_t bytes_written;
+        if (output_queue_.IsFileRegionAtFront()) {
+            auto region = output_queue_.PeekFileRegion();
+            auto offset = static_cast<off_t>(region.offset);
+            expected_size = std::min(region.size, kMaxSendFileSize);
+            bytes_written = sendfile(conn_sock_.get(), region.fd, &offset, expected_size);
+            if (bytes_written == 0) {
+                // The peer is expecting bytes that would never come.
+                LOG(ERROR) << "File " << region.fd << " ends before the region queued on "
+                           << name() << "; close the connection";
+                loop_->QueueTask(std::bind(&TCPConnection::ForceClose, shared_from_this()));
+                return false;
+            }
+        } else {
+            auto shared = zerocopy_threshold_ > 0 ? output_queue_.ShareFront(zerocopy_threshold_)
+                                                  : OutputQueue::SharedSegment();
+            if (shared.owner) {
+                expected_size = shared.data.size();
+                bytes_written = SendZeroCopy(std::move(shared));
+            } else {
+                auto vecs = loop_->write_vecs();
+                auto vec_cnt = output_queue_.PeekIOVecs(vecs, EventLoop::kMaxWriteVecCount);
+                for (size_t i = 0; i < vec_cnt; ++i) {
+                    expected_size += vecs[i].iov_len;
+                }
+
+                bytes_written = writev(conn_sock_.get(), vecs, static_cast<int>(vec_cnt));
+            }
+        }
+
+        if (bytes_written < 0) {
+            auto err = errno;
+            if (err == EAGAIN) {
+                return true;
+            }
+
+            LOG(ERROR) << "Failed to write to the socket " << conn_sock_.get()
+                       << "; errno: " << err;
+            return false;
+        }
+
+        output_queue_.Consume(static_cast<size_t>(bytes_written));
+
+        if (static_cast<size_t>(bytes_written) < expected_size) {
+            break;
+        }
+
+        total_written += static_cast<size_t>(bytes_written);
+        if (total_written >= budget && !output_queue_.empty()) {
+            if (budget_exhausted) {
+                *budget_exhausted = true;
+            }
+
+            break;
+        }
+    }
+
+    return true;
+}
+
+void TCPConnection::HandleWrite(IOContext::Details details)
+{
+    ENSURE(CHECK, loop_->BelongsToCurrentThread()).Require();
+
+    if (details.completed) {
+        HandleSendCompletion(details.result);
+        return;
+    }
+
+    // Queued data are being sent on the ring, which goes on with the rest once done.
+    if (ring_send_in_flight_) {
+        return;
+    }
+
+    // Write interest stays registered under edge-triggered mode, thus the socket may turn
+    // writable with nothing waiting.
+    if (!IsWaitingForWritable()) {
+        LOG_IF(INFO, !edge_triggered_) << "The connection of the socket " << conn_sock_.get()
+                                       << " is down!";
+        return;
+    }
+
+    if (!output_queue_.empty()) {
+        bool budget_exhausted = false;
+        auto budget = edge_triggered_ ? kIOBudgetPerEvent : std::numeric_limits<size_t>::max();
+        if (!FlushOutputQueue(budget, &budget_exhausted)) {
+            return;
+        }
+
+        if (!output_queue_.empty()) {
+            if (budget_exhausted) {
+                ResumeWriteLater();
+            }
+
+            return;
+        }
+
+        NotifyWriteComplete();
+    }
+
+    // Relayed bytes are written after queued ones; the source may have gone down meanwhile,
+    // leaving nothing to wait for.
+    auto source = relay_source_.lock();
+    if (source) {
+        source->PumpRelay();
+        if (source->HasPendingRelayData()) {
+            return;
+        }
+    }
+
+    StopWaitingForWritable();
+    if (state() == State::Disconnecting) {
+        DoShutdown();
+    }
+}
+
+void TCPConnection::SetAutoCork(bool enable)
+{
+    loop_->RunTask([self = shared_from_this(), enable] {
+        self->auto_cork_ = enable;
+    });
+}
+
+void TCPConnection::HandleCorkedWrite()
+{
+    ENSURE(CHECK, loop_->BelongsToCurrentThread()).Require();
+
+    corked_write_queued_ = false;
+
+    // Queued data may have been taken over by relayed bytes waiting for the socket.
+    if (state() == State::Disconnected || IsWaitingForWritable()) {
+        return;
+    }
+
+    if (!output_queue_.empty()) {
+        WriteOutputQueue();
+    }
+
+    if (output_queue_.empty() && state() == State::Disconnecting) {
+        DoShutdown();
+    }
+}
+
+void TCPConnection::SetEdgeTriggered(bool enable)
+{
+    loop_->RunTask(std::bind(&TCPConnection::DoSetEdgeTriggered, shared_from_this(), enable));
+}
+
+void TCPConnection::DoSetEdgeTriggered(bool enable)
+{
+    ENSURE(CHECK, loop_->BelongsToCurrentThread()).Require();
+
+    if (enable == edge_triggered_ || state() == State::Disconnected) {
+        return;
+    }
+
+    if (enable && (relay_pipe_ || !relay_source_.expired())) {
+        LOG(WARNING) << "Connection " << name() << " is relaying and stays level-triggered";
+        return;
+    }
+
+    if (io_ring_ || ring_send_in_flight_) {
+        LOG(WARNING) << "Connection " << name() << " is doing IO on io_uring and stays as it is";
+        return;
+    }
+
+    // Whether anything is waiting for the socket is told by write interest, only while
+    // level-triggered.
+    if (enable) {
+        awaiting_writable_ = conn_notifier_.WatchWriting();
+        edge_triggered_ = true;
+        conn_notifier_.SetEdgeTriggered(true);
+        if (!conn_notifier_.WatchWriting()) {
+            conn_notifier_.EnableWriting();
+        }
+    } else {
+        edge_triggered_ = false;
+        conn_notifier_.SetEdgeTriggered(false);
+        if (!awaiting_writable_) {
+            conn_notifier_.DisableWriting();
+        }
+
+        awaiting_writable_ = false;
+    }
+}
+
+bool TCPConnection::SetBusyPoll(int usec)
+{
+    FORCE_AS_NON_CONST_FUNCTION();
+
+    return socket::SetBusyPoll(conn_sock_, usec);
+}
+
+void TCPConnection::WaitForWritable()
+{
+    // The send in flight takes care of the rest once it completes.
+    if (ring_send_in_flight_) {
         return;
     }
 
-    auto bytes_written = write(conn_sock_.get(), output_buf_.Peek(), output_buf_.readable_size());
-    if (bytes_written < 0) {
-        LOG(ERROR) << "Failed to write to the socket " << conn_sock_.get() << "; errno: " << errno;
+    if (io_ring_) {
+        SubmitRingSend();
         return;
     }
 
-    output_buf_.Consume(static_cast<size_t>(bytes_written));
-    if (output_buf_.readable_size() == 0) {
+    if (edge_triggered_) {
+        awaiting_writable_ = true;
+    } else if (!conn_notifier_.WatchWriting()) {
+        conn_notifier_.EnableWriting();
+    }
+}
+
+void TCPConnection::StopWaitingForWritable()
+{
+    if (edge_triggered_) {
+        awaiting_writable_ = false;
+    } else {
         conn_notifier_.DisableWriting();
-        if (state() == State::Disconnecting) {
-            DoShutdown();
+    }
+}
+
+void TCPConnection::SubmitRingSend()
+{
+    if (ring_send_in_flight_ || output_queue_.empty()) {
+        return;
+    }
+
+    auto vecs = loop_->write_vecs();
+    auto vec_cnt = output_queue_.PeekIOVecs(vecs, EventLoop::kMaxWriteVecCount);
+    loop_->SubmitSend(&conn_notifier_, vecs, vec_cnt);
+    ring_send_in_flight_ = true;
+}
+
+void TCPConnection::HandleReceiveCompletion(TimePoint timestamp, IOContext::Details details)
+{
+    // Receives in flight may complete after the connection is closed.
+    if (state() == State::Disconnected) {
+        return;
+    }
+
+    if (details.result == 0) {
+        HandleClose();
+        return;
+    }
+
+    if (details.result < 0) {
+        LOG(ERROR) << "Failed to receive data from socket " << conn_sock_.get()
+                   << "; err: " << -details.result;
+        HandleError();
+        HandleClose();
+        return;
+    }
+
+    auto size = static_cast<size_t>(details.result);
+
+    // Bytes received before relaying began are relayed the same way as those buffered.
+    if (relay_pipe_) {
+        auto sink = relay_sink_.lock();
+        if (sink && sink->state() == State::Connected) {
+            sink->DoSendOwned(std::string(details.data, size));
+            return;
         }
+
+        StopRelaying();
+    }
+
+    input_buf_.Write(details.data, size);
+    on_message_(shared_from_this(), input_buf_, timestamp);
+    if (IsInputBufferFull()) {
+        input_limit_reached_ = true;
+        UpdateReading();
     }
 }
 
+void TCPConnection::HandleSendCompletion(int result)
+{
+    ring_send_in_flight_ = false;
+
+    if (state() == State::Disconnected) {
+        return;
+    }
+
+    if (result < 0) {
+        LOG(ERROR) << "Failed to write to the socket " << conn_sock_.get()
+                   << "; errno: " << -result << "; abandon unwritten data!";
+        output_queue_.Clear();
+        return;
+    }
+
+    output_queue_.Consume(static_cast<size_t>(result));
+
+    // Having left the ring meanwhile, the connection writes the rest, and relayed bytes,
+    // upon readiness.
+    if (!io_ring_) {
+        if (output_queue_.empty()) {
+            NotifyWriteComplete();
+        }
+
+        WaitForWritable();
+        return;
+    }
+
+    if (!output_queue_.empty()) {
+        SubmitRingSend();
+        return;
+    }
+
+    NotifyWriteComplete();
+    if (state() == State::Disconnecting) {
+        DoShutdown();
+    }
+}
+
+void TCPConnection::LeaveIORing()
+{
+    if (!io_ring_) {
+        return;
+    }
+
+    io_ring_ = false;
+    conn_notifier_.SetRingRead(Notifier::RingRead::None);
+}
+
+void TCPConnection::ResumeReadLater()
+{
+    if (read_resumption_queued_) {
+        return;
+    }
+
+    read_resumption_queued_ = true;
+    loop_->QueueTask([self = shared_from_this()] {
+        self->read_resumption_queued_ = false;
+        if (self->state() != State::Disconnected && self->conn_notifier_.WatchReading()) {
+            self->HandleRead(self->loop_->Now(), IOContext::Details());
+        }
+    });
+}
+
+void TCPConnection::ResumeWriteLater()
+{
+    if (write_resumption_queued_) {
+        return;
+    }
+
+    write_resumption_queued_ = true;
+    loop_->QueueTask([self = shared_from_this()] {
+        self->write_resumption_queued_ = false;
+        if (self->state() != State::Disconnected) {
+            self->HandleWrite(IOContext::Details());
+        }
+    });
+}
+
+void TCPConnection::RelayTo(const TCPConnectionPtr& sink)
+{
+    ENSURE(CHECK, sink->event_loop() == loop_).Require();
+    loop_->RunTask(std::bind(&TCPConnection::DoRelayTo, shared_from_this(), sink));
+}
+
+void TCPConnection::DoRelayTo(const TCPConnectionPtr& sink)
+{
+    ENSURE(CHECK, loop_->BelongsToCurrentThread()).Require();
+    ENSURE(CHECK, !relay_pipe_).Require();
+
+    if (state() != State::Connected || sink->state() != State::Connected) {
+        LOG(WARNING) << "Relaying between not-connected connections!";
+        return;
+    }
+
+    DoSetEdgeTriggered(false);
+    sink->DoSetEdgeTriggered(false);
+
+    LeaveIORing();
+    sink->LeaveIORing();
+
+    relay_pipe_ = std::make_unique<SplicePipe>();
+    relay_sink_ = sink;
+    sink->relay_source_ = shared_from_this();
+
+    if (input_buf_.readable_size() > 0) {
+        sink->DoSendOwned(input_buf_.ReadAllAsString());
+    }
+}
+
+void TCPConnection::HandleRelayRead()
+{
+    auto bytes_read = relay_pipe_->SpliceFrom(conn_sock_.get());
+    if (bytes_read < 0) {
+        auto err = errno;
+        if (err != EAGAIN) {
+            LOG(ERROR) << "Failed to splice data from socket " << conn_sock_.get()
+                       << "; err: " << err;
+            HandleError();
+        }
+
+        return;
+    }
+
+    if (bytes_read == 0) {
+        // Stop watching the drained socket, and close once relayed bytes are written.
+        relay_eof_ = true;
+        conn_notifier_.DisableReading();
+    }
+
+    PumpRelay();
+}
+
+void TCPConnection::PumpRelay()
+{
+    if (!relay_pipe_ || state() == State::Disconnected) {
+        return;
+    }
+
+    auto sink = relay_sink_.lock();
+    if (!sink || sink->state() == State::Disconnected) {
+        StopRelaying();
+        return;
+    }
+
+    if (sink->output_queue_.empty() &&
+        relay_pipe_->SpliceTo(sink->conn_sock_.get()) < 0) {
+        auto err = errno;
+        LOG(ERROR) << "Failed to splice data into socket " << sink->conn_sock_.get()
+                   << "; err: " << err << "; abandon relayed data!";
+        StopRelaying();
+        return;
+    }
+
+    if (relay_pipe_->buffered_size() > 0) {
+        // The sink can't take more for now.
+        UpdateReading();
+
+        sink->WaitForWritable();
+
+        return;
+    }
+
+    if (relay_eof_) {
+        HandleClose();
+        return;
+    }
+
+    UpdateReading();
+}
+
+bool TCPConnection::HasPendingRelayData() const noexcept
+{
+    return relay_pipe_ && relay_pipe_->buffered_size() > 0 && state() != State::Disconnected;
+}
+
+void TCPConnection::StopRelaying()
+{
+    DetachRelaySink();
+
+    if (relay_eof_) {
+        HandleClose();
+        return;
+    }
+
+    UpdateReading();
+}
+
+void TCPConnection::DetachRelaySink()
+{
+    auto sink = relay_sink_.lock();
+
+    relay_pipe_ = nullptr;
+    relay_sink_.reset();
+
+    if (!sink) {
+        return;
+    }
+
+    sink->relay_source_.reset();
+
+    // Relayed bytes just dropped may be all the sink was waiting to write.
+    if (sink->state() != State::Disconnected && sink->output_queue_.empty() &&
+        sink->IsWaitingForWritable()) {
+        sink->StopWaitingForWritable();
+        if (sink->state() == State::Disconnecting) {
+            sink->DoShutdown();
+        }
+    }
+}
+
+void TCPConnection::SetZeroCopyThreshold(size_t threshold)
+{
+    loop_->RunTask([self = shared_from_this(), threshold] {
+        if (threshold > 0 && !self->zerocopy_enabled_) {
+            if (!socket::EnableZeroCopy(self->conn_sock_)) {
+                return;
+            }
+
+            self->zerocopy_enabled_ = true;
+        }
+
+        if (threshold > 0) {
+            self->LeaveIORing();
+        }
+
+        self->zerocopy_threshold_ = threshold;
+    });
+}
+
+ssize_t TCPConnection::SendZeroCopy(OutputQueue::SharedSegment&& segment)
+{
+    auto bytes_sent = send(conn_sock_.get(), segment.data.data(), segment.data.size(),
+                           MSG_ZEROCOPY);
+    if (bytes_sent < 0 && errno == ENOBUFS) {
+        // Out of optmem for pinning pages; the payload is copied as usual then.
+        ++zerocopy_stats_.fallbacks;
+        return send(conn_sock_.get(), segment.data.data(), segment.data.size(), 0);
+    }
+
+    if (bytes_sent > 0) {
+        zerocopy_pending_.emplace_back(zerocopy_next_id_++, std::move(segment.owner));
+        ++zerocopy_stats_.sends;
+        zerocopy_stats_.bytes += static_cast<uint64_t>(bytes_sent);
+    }
+
+    return bytes_sent;
+}
+
+void TCPConnection::ReapZeroCopyCompletions()
+{
+    ReadZeroCopyCompletions(conn_sock_, [this](uint32_t first, uint32_t span, bool copied) {
+        zerocopy_stats_.completions += static_cast<uint64_t>(span) + 1;
+        if (copied) {
+            zerocopy_stats_.copied += static_cast<uint64_t>(span) + 1;
+        }
+
+        ReleaseZeroCopySends(zerocopy_pending_, first, span);
+    });
+}
+
 }   // namespace ezio
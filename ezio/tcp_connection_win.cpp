@@ -4,6 +4,11 @@
 
 #include "ezio/tcp_connection.h"
 
+#include <algorithm>
+#include <cstdio>
+#include <limits>
+
+#include <io.h>
 #include <WinSock2.h>
 
 #include "kbase/error_exception_util.h"
@@ -11,6 +16,12 @@
 
 #include "ezio/event_loop.h"
 
+namespace {
+
+constexpr size_t kMaxWriteBufCount = 64;
+
+}   // namespace
+
 namespace ezio {
 
 void TCPConnection::PostRead()
@@ -58,16 +69,38 @@ void TCPConnection::HandleRead(TimePoint timestamp, IOContext::Details details)
         input_buf_.EndWrite(details.bytes_transferred);
 
         on_message_(shared_from_this(), input_buf_, timestamp);
+        input_limit_reached_ = IsInputBufferFull();
+    }
+
+    // Hold back the next read request until reading is resumed.
+    if (reading_paused_ || input_limit_reached_) {
+        conn_notifier_.DisableReading();
+        return;
     }
 
     PostRead();
 }
 
-void TCPConnection::DoSend(kbase::StringView data)
+void TCPConnection::UpdateReading()
+{
+    if (state() != State::Connected && state() != State::Disconnecting) {
+        return;
+    }
+
+    // A read request in flight can't be withdrawn; reading stops once it completes.
+    if (!reading_paused_ && !input_limit_reached_ && !conn_notifier_.WatchReading()) {
+        conn_notifier_.EnableReading();
+        PostRead();
+    }
+}
+
+template<typename Payload>
+void TCPConnection::DoSendOwned(Payload&& payload)
 {
     ENSURE(CHECK, loop_->BelongsToCurrentThread()).Require();
 
-    output_buf_.Write(data.data(), data.size());
+    auto prev_size = output_queue_.size();
+    output_queue_.Append(std::forward<Payload>(payload));
 
     if (!io_reqs_.outstanding_write_req) {
         // The last PostWrite() may fail and we are still watching writing.
@@ -77,6 +110,47 @@ void TCPConnection::DoSend(kbase::StringView data)
 
         PostWrite();
     }
+
+    CheckHighWaterMark(prev_size);
+}
+
+template void TCPConnection::DoSendOwned<std::string>(std::string&&);
+template void TCPConnection::DoSendOwned<Buffer>(Buffer&&);
+template void TCPConnection::DoSendOwned<std::vector<char>>(std::vector<char>&&);
+template void TCPConnection::DoSendOwned<SharedPayload>(SharedPayload&&);
+
+void TCPConnection::DoSend(kbase::StringView data)
+{
+    // Bytes are copied into the queue.
+    DoSendOwned(data);
+}
+
+void TCPConnection::DoSendFile(int fd, int64_t offset, size_t length,
+                               FileSentEventHandler on_sent)
+{
+    ENSURE(CHECK, loop_->BelongsToCurrentThread()).Require();
+
+    // Completion-based writes have no counterpart of sendfile() that interleaves with our
+    // queued buffers; the region is read into memory and queued instead.
+    std::string data(length, '\0');
+    bool completed = _lseeki64(fd, offset, SEEK_SET) == offset;
+    for (size_t read_size = 0; completed && read_size < length;) {
+        auto chunk = static_cast<unsigned int>(
+            std::min<size_t>(length - read_size, std::numeric_limits<int>::max()));
+        int rv = _read(fd, &data[read_size], chunk);
+        completed = rv > 0;
+        read_size += completed ? static_cast<size_t>(rv) : 0;
+    }
+
+    if (completed) {
+        DoSendOwned(std::move(data));
+    } else {
+        LOG(ERROR) << "Failed to read the region of file " << fd << " for " << name();
+    }
+
+    if (on_sent) {
+        loop_->QueueTask(std::bind(on_sent, shared_from_this(), completed));
+    }
 }
 
 void TCPConnection::PostWrite()
@@ -87,13 +161,13 @@ void TCPConnection::PostWrite()
 
     DWORD flags = 0;
 
-    WSABUF buf {};
-    buf.buf = const_cast<char*>(output_buf_.Peek());
-    buf.len = static_cast<ULONG>(output_buf_.readable_size());
+    WSABUF bufs[kMaxWriteBufCount];
+    auto buf_cnt = output_queue_.PeekWSABufs(bufs, kMaxWriteBufCount);
 
     io_reqs_.write_req.Reset();
 
-    int rv = WSASend(conn_sock_.get(), &buf, 1, nullptr, flags, &io_reqs_.write_req, nullptr);
+    int rv = WSASend(conn_sock_.get(), bufs, static_cast<DWORD>(buf_cnt), nullptr, flags,
+                     &io_reqs_.write_req, nullptr);
     if (rv != 0 && WSAGetLastError() != WSA_IO_PENDING) {
         LOG(ERROR) << "Cannot emit async-write via WSASend(); error: " << WSAGetLastError();
         HandleError();
@@ -114,11 +188,12 @@ void TCPConnection::HandleWrite(IOContext::Details details)
 
     io_reqs_.outstanding_write_req = false;
 
-    output_buf_.Consume(details.bytes_transferred);
+    output_queue_.Consume(details.bytes_transferred);
 
-    if (output_buf_.readable_size() > 0) {
+    if (!output_queue_.empty()) {
         PostWrite();
     } else {
+        NotifyWriteComplete();
         conn_notifier_.DisableWriting();
         if (state() == State::Disconnecting) {
             DoShutdown();
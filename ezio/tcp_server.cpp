@@ -4,18 +4,47 @@
 
 #include "ezio/tcp_server.h"
 
+#include <exception>
 #include <functional>
+#include <future>
 
 #include "kbase/error_exception_util.h"
+#include "kbase/logging.h"
 #include "kbase/string_format.h"
 
 #include "ezio/event_loop.h"
+#include "ezio/socket_utils.h"
 
 namespace {
 
 void OnConnectionDestroyDefault(const ezio::TCPConnectionPtr&)
 {}
 
+#if defined(OS_POSIX)
+
+// Queues `fn` onto the loop, which must not be the calling thread's; the returned future
+// is ready once `fn` has run, and rethrows exceptions thrown by it.
+template<typename F>
+std::future<void> RunTaskWithFuture(ezio::EventLoop* loop, F fn)
+{
+    ENSURE(CHECK, !loop->BelongsToCurrentThread()).Require();
+
+    auto done = std::make_shared<std::promise<void>>();
+    auto finished = done->get_future();
+    loop->QueueTask([done, fn] {
+        try {
+            fn();
+            done->set_value();
+        } catch (...) {
+            done->set_exception(std::current_exception());
+        }
+    });
+
+    return finished;
+}
+
+#endif
+
 }   // namespace
 
 namespace ezio {
@@ -27,11 +56,14 @@ TCPServer::TCPServer(ezio::EventLoop* loop, const SocketAddress& addr, std::stri
       listen_addr_(addr),
       name_(std::move(name)),
       started_(false),
-      acceptor_(loop, addr),
       next_conn_id_(0),
-      on_connection_destroy_(&OnConnectionDestroyDefault)
+#if defined(OS_POSIX)
+      steering_by_cpu_(false),
+#endif
+      on_connection_destroy_(&OnConnectionDestroyDefault),
+      high_water_mark_(0)
 {
-    acceptor_.set_on_new_connection(std::bind(&TCPServer::HandleNewConnection, this, _1, _2));
+    CreateAcceptor();
 }
 
 TCPServer::~TCPServer()
@@ -43,6 +75,17 @@ TCPServer::~TCPServer()
         auto conn_loop = conn->event_loop();
         conn_loop->RunTask(std::bind(&TCPConnection::MakeTeardown, conn));
     }
+
+#if defined(OS_POSIX)
+    StopShards();
+#endif
+}
+
+void TCPServer::CreateAcceptor()
+{
+    acceptor_ = std::make_unique<Acceptor>(loop_, listen_addr_);
+    acceptor_->set_on_new_connection(
+        std::bind(&TCPServer::HandleNewConnection, this, _1, _2));
 }
 
 void TCPServer::Start()
@@ -53,21 +96,155 @@ void TCPServer::Start()
 
 void TCPServer::Start(const Options& opt)
 {
-    if (!started_.exchange(true, std::memory_order_acq_rel)) {
-        ENSURE(CHECK, !acceptor_.listening()).Require();
-        loop_->RunTask([this] {
-            acceptor_.Listen();
-        });
+    if (started_.exchange(true, std::memory_order_acq_rel)) {
+        return;
+    }
 
+    // Start() can be called again after a failure.
+    try {
         if (opt.worker_num > 0) {
             const auto& pool_name = opt.worker_pool_name.empty() ? name() : opt.worker_pool_name;
             worker_pool_ = std::make_unique<WorkerPool>(loop_,
                                                         opt.worker_num,
-                                                        pool_name);
+                                                        pool_name,
+                                                        opt.pin_workers);
+        }
+
+#if defined(OS_POSIX)
+        if (opt.reuse_port_sharding) {
+            ENSURE(CHECK, worker_pool_ != nullptr).Require();
+            StartShards(opt);
+            return;
+        }
+#endif
+
+        if (!acceptor_) {
+            CreateAcceptor();
         }
+
+        ENSURE(CHECK, !acceptor_->listening()).Require();
+        loop_->RunTask([this] {
+            acceptor_->Listen();
+        });
+    } catch (...) {
+        worker_pool_ = nullptr;
+        started_.store(false, std::memory_order_release);
+        throw;
+    }
+}
+
+#if defined(OS_POSIX)
+
+void TCPServer::StartShards(const Options& opt)
+{
+    // Shards are set up from the loop thread, which blocks on workers only, and workers
+    // never block on it; the worker-pool requires the loop thread anyway.
+    ENSURE(CHECK, loop_->BelongsToCurrentThread()).Require();
+
+    // The socket bound in the constructor would keep shards from binding the address.
+    acceptor_ = nullptr;
+
+    try {
+        ListenOnShards(opt);
+    } catch (...) {
+        StopShards();
+        throw;
+    }
+}
+
+void TCPServer::ListenOnShards(const Options& opt)
+{
+    const auto& loops = worker_pool_->event_loops();
+    for (size_t i = 0; i < loops.size(); ++i) {
+        auto shard = std::make_unique<Shard>(loops[i], i);
+        shard->acceptor = std::make_unique<Acceptor>(shard->loop, listen_addr_, true);
+        shard->acceptor->set_on_new_connection(
+            std::bind(&TCPServer::HandleShardConnection, this, shard.get(), _1, _2));
+        shards_.push_back(std::move(shard));
+    }
+
+    // Sockets join the SO_REUSEPORT group in the order they start listening, thus we wait
+    // for each to listen, and the steering picks shards by their indices.
+    for (auto& shard : shards_) {
+        auto acceptor = shard->acceptor.get();
+        RunTaskWithFuture(shard->loop, [acceptor] {
+            acceptor->Listen();
+        }).get();
+    }
+
+    if (opt.steer_by_cpu) {
+        steering_by_cpu_ = socket::AttachReusePortCPUSteering(
+            shards_.front()->acceptor->listening_socket(), static_cast<uint32_t>(shards_.size()));
+        LOG_IF(WARNING, !steering_by_cpu_) << "Server " << name_
+                                           << " steers connections by hash instead of by CPU";
+    }
+}
+
+void TCPServer::StopShards()
+{
+    // Shards are torn down on their own loops, and must be done before they are gone.
+    // Connections no longer call back into the server afterwards, thus no task left on
+    // shard loops refers to the server or to its shards.
+    // Shards are torn down in parallel, and we wait only for the slowest of them.
+    std::vector<std::future<void>> teardowns;
+    for (auto& shard_ptr : shards_) {
+        auto shard = shard_ptr.get();
+        teardowns.push_back(RunTaskWithFuture(shard->loop, [shard] {
+            shard->acceptor = nullptr;
+            for (auto& conn_item : shard->connections) {
+                conn_item.second->set_on_close([](const TCPConnectionPtr&) {});
+                conn_item.second->MakeTeardown();
+            }
+
+            shard->connections.clear();
+        }));
+    }
+
+    for (auto& teardown : teardowns) {
+        teardown.wait();
     }
+
+    shards_.clear();
+    steering_by_cpu_ = false;
+}
+
+void TCPServer::HandleShardConnection(Shard* shard, ScopedSocket&& conn_sock,
+                                      const SocketAddress& conn_addr)
+{
+    ENSURE(CHECK, shard->loop->BelongsToCurrentThread()).Require();
+
+    auto conn_name = kbase::StringFormat("-{0}#{1}-{2}", listen_addr_.ToHostPort(),
+                                         shard->index, shard->next_conn_id);
+    ++shard->next_conn_id;
+
+    auto conn = std::make_shared<TCPConnection>(shard->loop,
+                                                std::move(conn_name),
+                                                std::move(conn_sock),
+                                                listen_addr_,
+                                                conn_addr);
+
+    shard->connections.insert({conn->name(), conn});
+
+    SetupConnection(conn);
+    conn->set_on_close([this, shard](const TCPConnectionPtr& conn_ptr) {
+        shard->loop->RunTask(std::bind(&TCPServer::RemoveShardConnection, this, shard, conn_ptr));
+    });
+
+    conn->MakeEstablished();
 }
 
+void TCPServer::RemoveShardConnection(Shard* shard, const TCPConnectionPtr& conn)
+{
+    ENSURE(CHECK, shard->loop->BelongsToCurrentThread()).Require();
+
+    auto removed_count = shard->connections.erase(conn->name());
+    ENSURE(CHECK, removed_count == 1)(removed_count).Require();
+
+    shard->loop->QueueTask(std::bind(&TCPConnection::MakeTeardown, conn));
+}
+
+#endif
+
 void TCPServer::HandleNewConnection(ScopedSocket&& conn_sock, const SocketAddress& conn_addr)
 {
     ENSURE(CHECK, loop_->BelongsToCurrentThread()).Require();
@@ -85,14 +262,10 @@ void TCPServer::HandleNewConnection(ScopedSocket&& conn_sock, const SocketAddres
 
     connections_.insert({conn->name(), conn});
 
-    conn->set_on_connect(on_connect_);
-    conn->set_on_disconnect(on_disconnect_);
+    SetupConnection(conn);
     conn->set_on_close([this](const TCPConnectionPtr& conn_ptr) {
         loop_->RunTask(std::bind(&TCPServer::RemoveConnection, this, conn_ptr));
     });
-    conn->set_on_destroy(on_connection_destroy_);
-
-    conn->set_on_message(on_message_);
 
     conn_loop->RunTask(std::bind(&TCPConnection::MakeEstablished, conn));
 }
@@ -108,6 +281,17 @@ void TCPServer::RemoveConnection(const TCPConnectionPtr& conn)
     conn_loop->QueueTask(std::bind(&TCPConnection::MakeTeardown, conn));
 }
 
+void TCPServer::SetupConnection(const TCPConnectionPtr& conn)
+{
+    conn->set_on_connect(on_connect_);
+    conn->set_on_disconnect(on_disconnect_);
+    conn->set_on_destroy(on_connection_destroy_);
+
+    conn->set_on_message(on_message_);
+    conn->set_on_high_water_mark(on_high_water_mark_, high_water_mark_);
+    conn->set_on_write_complete(on_write_complete_);
+}
+
 EventLoop* TCPServer::GetEventLoopForConnection() const
 {
     ENSURE(CHECK, loop_->BelongsToCurrentThread()).Require();
@@ -9,6 +9,7 @@
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "kbase/basic_macros.h"
 
@@ -30,12 +31,35 @@ public:
     struct Options {
         size_t worker_num;
         std::string worker_pool_name;
+        // Pins the i-th worker to the i-th CPU available to the process, modulo the number
+        // of such CPUs.
+        bool pin_workers;
+#if defined(OS_POSIX)
+        // Every worker loop listens on its own SO_REUSEPORT socket, and accepts connections
+        // it then serves, thus no connection is handed over from the main loop.
+        // Requires a worker-pool, and the main loop doesn't accept.
+        bool reuse_port_sharding;
+        // When sharding, steers a connection to the worker indexed by the CPU receiving it,
+        // modulo the number of workers, rather than by hash of its addresses.
+        // It keeps a connection on the CPU which received it only along with `pin_workers`
+        // and as many workers as CPUs receiving packets; otherwise it is merely another hash.
+        // Falls back to the hashing if not supported.
+        bool steer_by_cpu;
+#endif
 
         Options()
-            : worker_num(0)
+            : worker_num(0),
+              pin_workers(false)
+#if defined(OS_POSIX)
+              , reuse_port_sharding(false),
+              steer_by_cpu(false)
+#endif
         {}
     };
 
+    // Binds the address, and throws if failed, e.g. the address is in use.
+    // With `reuse_port_sharding`, Start() replaces the bound socket with sockets of shards,
+    // and failures of binding them are thrown from Start().
     TCPServer(EventLoop* loop, const SocketAddress& addr, std::string name);
 
     ~TCPServer();
@@ -45,6 +69,9 @@ public:
     DISALLOW_MOVE(TCPServer);
 
     // Start functions is thread-safe and it is no harm to call the function multiple times.
+    // A start that threw can be retried.
+    // However, starting with a worker-pool must be on the loop thread, and with sharding it
+    // returns after every shard is listening.
 
     void Start();
 
@@ -60,6 +87,16 @@ public:
         return listen_addr_.ToHostPort();
     }
 
+#if defined(OS_POSIX)
+    // Returns true if shards are started with `steer_by_cpu` and the kernel supports it;
+    // connections are steered by hash of their addresses otherwise.
+    // Must be called on the loop thread.
+    bool steering_by_cpu() const noexcept
+    {
+        return steering_by_cpu_;
+    }
+#endif
+
     void set_on_connect(ConnectionEventHandler handler)
     {
         on_connect_ = std::move(handler);
@@ -80,11 +117,44 @@ public:
         on_message_ = std::move(handler);
     }
 
+    // Handlers are installed on every new connection; see TCPConnection for details.
+    void set_on_high_water_mark(HighWaterMarkEventHandler handler, size_t mark)
+    {
+        on_high_water_mark_ = std::move(handler);
+        high_water_mark_ = mark;
+    }
+
+    void set_on_write_complete(WriteCompleteEventHandler handler)
+    {
+        on_write_complete_ = std::move(handler);
+    }
+
 private:
     void HandleNewConnection(ScopedSocket&& conn_sock, const SocketAddress& conn_addr);
 
     void RemoveConnection(const TCPConnectionPtr& conn);
 
+    void CreateAcceptor();
+
+#if defined(OS_POSIX)
+    struct Shard;
+
+    // Replaces the acceptor of the main loop with shards.
+    void StartShards(const Options& opt);
+
+    void ListenOnShards(const Options& opt);
+
+    void StopShards();
+
+    // Runs on the shard's loop, which then serves the connection.
+    void HandleShardConnection(Shard* shard, ScopedSocket&& conn_sock,
+                               const SocketAddress& conn_addr);
+
+    void RemoveShardConnection(Shard* shard, const TCPConnectionPtr& conn);
+#endif
+
+    void SetupConnection(const TCPConnectionPtr& conn);
+
     // If we are using worker-pool, then use worker thread's loop for new connections.
     // Otherwise, use main loop.
     EventLoop* GetEventLoopForConnection() const;
@@ -94,7 +164,7 @@ private:
     SocketAddress listen_addr_;
     std::string name_;
     std::atomic<bool> started_;
-    Acceptor acceptor_;
+    std::unique_ptr<Acceptor> acceptor_;
     std::unique_ptr<WorkerPool> worker_pool_;
     int next_conn_id_;
 
@@ -102,11 +172,32 @@ private:
 
     ConnectionMap connections_;
 
+#if defined(OS_POSIX)
+    // Everything in a shard, except `loop` and `index`, belongs to the shard's loop.
+    struct Shard {
+        EventLoop* loop;
+        size_t index;
+        std::unique_ptr<Acceptor> acceptor;
+        int next_conn_id;
+        ConnectionMap connections;
+
+        Shard(EventLoop* shard_loop, size_t shard_index)
+            : loop(shard_loop), index(shard_index), next_conn_id(0)
+        {}
+    };
+
+    std::vector<std::unique_ptr<Shard>> shards_;
+    bool steering_by_cpu_;
+#endif
+
     ConnectionEventHandler on_connect_;
     ConnectionEventHandler on_disconnect_;
     DestroyEventHandler on_connection_destroy_;
 
     MessageEventHandler on_message_;
+    HighWaterMarkEventHandler on_high_water_mark_;
+    size_t high_water_mark_;
+    WriteCompleteEventHandler on_write_complete_;
 };
 
 }   // namespace ezio
@@ -4,12 +4,16 @@
 
 #include "ezio/this_thread.h"
 
+#include <cerrno>
+#include <climits>
+
 #include "kbase/debugger.h"
 #include "kbase/error_exception_util.h"
 #include "kbase/logging.h"
 #include "kbase/string_encoding_conversions.h"
 
 #if defined(OS_POSIX)
+#include <sched.h>
 #include <sys/prctl.h>
 #include <sys/syscall.h>
 #include <unistd.h>
@@ -130,5 +134,66 @@ void SetName(const char* name, bool skip_native_name)
     }
 }
 
+bool SetCPUAffinity(unsigned cpu)
+{
+#if defined(OS_POSIX)
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu, &cpus);
+    if (sched_setaffinity(0, sizeof(cpus), &cpus) < 0) {
+        auto err = errno;
+        LOG(WARNING) << "sched_setaffinity() to cpu " << cpu << " failed: " << err;
+        return false;
+    }
+#elif defined(OS_WIN)
+    if (cpu >= sizeof(DWORD_PTR) * CHAR_BIT ||
+        SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << cpu) == 0) {
+        kbase::LastError err;
+        LOG(WARNING) << "SetThreadAffinityMask() to cpu " << cpu << " failed: " << err;
+        return false;
+    }
+#endif
+
+    return true;
+}
+
+std::vector<unsigned> GetAvailableCPUs()
+{
+    std::vector<unsigned> available_cpus;
+
+#if defined(OS_POSIX)
+    // The mask of the main thread, rather than of the calling one, which may be pinned.
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    if (sched_getaffinity(getpid(), sizeof(cpus), &cpus) < 0) {
+        auto err = errno;
+        LOG(WARNING) << "sched_getaffinity() failed: " << err;
+        return available_cpus;
+    }
+
+    for (unsigned cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &cpus)) {
+            available_cpus.push_back(cpu);
+        }
+    }
+#elif defined(OS_WIN)
+    DWORD_PTR process_mask = 0;
+    DWORD_PTR system_mask = 0;
+    if (!GetProcessAffinityMask(GetCurrentProcess(), &process_mask, &system_mask)) {
+        kbase::LastError err;
+        LOG(WARNING) << "GetProcessAffinityMask() failed: " << err;
+        return available_cpus;
+    }
+
+    for (unsigned cpu = 0; cpu < sizeof(DWORD_PTR) * CHAR_BIT; ++cpu) {
+        if (process_mask & (DWORD_PTR(1) << cpu)) {
+            available_cpus.push_back(cpu);
+        }
+    }
+#endif
+
+    return available_cpus;
+}
+
 }   // namespace this_thread
 }   // namespace ezio
@@ -5,6 +5,8 @@
 #ifndef EZIO_THIS_THREAD_H_
 #define EZIO_THIS_THREAD_H_
 
+#include <vector>
+
 #include "kbase/basic_macros.h"
 
 #if defined(OS_POSIX)
@@ -60,6 +62,15 @@ inline const char* GetName()
 // cause some tools stop working.
 void SetName(const char* name, bool skip_native_name = false);
 
+// Restricts the calling thread to run on the `cpu`-th CPU only.
+// Returns false if failed, e.g. the CPU is not available to the process.
+bool SetCPUAffinity(unsigned cpu);
+
+// Returns CPUs the process is allowed to run on, in ascending order, which may be fewer than
+// those installed because of the affinity mask or cpusets of the process.
+// Returns an empty set if failed.
+std::vector<unsigned> GetAvailableCPUs();
+
 }   // namespace this_thread
 }   // namespace ezio
 
@@ -22,8 +22,12 @@ Thread::Thread(std::string name)
 Thread::~Thread()
 {
     // In case the loop quits before the destruction.
+    // Quit as a task, otherwise it would be lost if the loop were not yet running.
     if (loop_) {
-        loop_->Quit();
+        auto loop = loop_.get();
+        loop->QueueTask([loop] {
+            loop->Quit();
+        });
     }
 
     raw_thread_->join();
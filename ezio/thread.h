@@ -45,8 +45,9 @@ private:
     std::string name_;
     std::mutex loop_init_mtx_;
     std::condition_variable loop_inited_;
-    std::unique_ptr<std::thread> raw_thread_;
     std::unique_ptr<EventLoop> loop_;
+    // Declared last, since the thread starts on its construction and sets `loop_`.
+    std::unique_ptr<std::thread> raw_thread_;
 };
 
 }   // namespace ezio
@@ -5,17 +5,16 @@
 #ifndef EZIO_TIMER_H_
 #define EZIO_TIMER_H_
 
-#include <functional>
-
 #include "kbase/basic_macros.h"
 
 #include "ezio/chrono_utils.h"
+#include "ezio/task.h"
 
 namespace ezio {
 
 class Timer {
 public:
-    using TickEventHandler = std::function<void()>;
+    using TickEventHandler = Task;
 
     Timer(TickEventHandler handler, TimePoint when, TimeDuration interval);
 
@@ -21,8 +21,6 @@ namespace {
 
 #if defined(OS_POSIX)
 
-constexpr std::chrono::microseconds kMinDuration {100};
-
 int CreateTimerFD()
 {
     int tfd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
@@ -32,10 +30,6 @@ int CreateTimerFD()
 
 timespec ConvertDurationToTimespec(std::chrono::microseconds duration)
 {
-    if (duration < kMinDuration) {
-        duration = kMinDuration;
-    }
-
     auto sec_part = std::chrono::duration_cast<std::chrono::seconds>(duration);
     auto nano_part = std::chrono::duration_cast<std::chrono::nanoseconds>(duration - sec_part);
 
@@ -46,14 +40,18 @@ timespec ConvertDurationToTimespec(std::chrono::microseconds duration)
     return spec;
 }
 
+// Both TimePoint and the timer-fd are on CLOCK_MONOTONIC, thus the timer-fd is armed with
+// the expiration as is, and expires at once if the time has passed.
 void ResetTimerFD(int timer_fd, ezio::TimePoint when)
 {
-    auto duration = when - ezio::ToTimePoint(std::chrono::system_clock::now());
-
     itimerspec new_spec {};
-    new_spec.it_value = ConvertDurationToTimespec(duration);
+    new_spec.it_value = ConvertDurationToTimespec(when.time_since_epoch());
+    if (new_spec.it_value.tv_sec == 0 && new_spec.it_value.tv_nsec == 0) {
+        // A zero value disarms the timer.
+        new_spec.it_value.tv_nsec = 1;
+    }
 
-    int rv = timerfd_settime(timer_fd, 0, &new_spec, nullptr);
+    int rv = timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &new_spec, nullptr);
     if (rv < 0) {
         auto err = errno;
         LOG(ERROR) << "timerfd_settime() failed errno: " << err;
@@ -212,7 +210,8 @@ void TimerQueue::OnTimerExpired(TimePoint timestamp)
 
     ConsumeTimerFD(timer_fd_.get());
 
-    ProcessExpiredTimers(timestamp);
+    // The coarse clock may not have caught up with the timer-fd yet.
+    ProcessExpiredTimers(loop_->coarse_clock() ? MonotonicNow() : timestamp);
 
     if (!timers_.empty()) {
         ResetTimerFD(timer_fd_.get(), timers_.begin()->first);
@@ -4,15 +4,21 @@
 
 #include "ezio/worker_pool.h"
 
+#include <algorithm>
+#include <thread>
+#include <vector>
+
 #include "kbase/error_exception_util.h"
 #include "kbase/string_format.h"
 
 #include "ezio/event_loop.h"
 #include "ezio/thread.h"
+#include "ezio/this_thread.h"
 
 namespace ezio {
 
-WorkerPool::WorkerPool(EventLoop* main_loop, size_t worker_num, std::string name)
+WorkerPool::WorkerPool(EventLoop* main_loop, size_t worker_num, std::string name,
+                       bool pin_to_cpus)
     : main_loop_(main_loop),
       name_(std::move(name)),
       next_loop_idx_(0)
@@ -20,10 +26,30 @@ WorkerPool::WorkerPool(EventLoop* main_loop, size_t worker_num, std::string name
     ENSURE(CHECK, main_loop_->BelongsToCurrentThread()).Require();
     ENSURE(CHECK, worker_num > 0).Require();
 
+    // CPUs excluded by the affinity mask or cpusets of the process are skipped.
+    std::vector<unsigned> cpus;
+    if (pin_to_cpus) {
+        cpus = this_thread::GetAvailableCPUs();
+        if (cpus.empty()) {
+            auto cpu_num = std::max(std::thread::hardware_concurrency(), 1U);
+            for (unsigned cpu = 0; cpu < cpu_num; ++cpu) {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+
     for (size_t i = 0; i < worker_num; ++i) {
         auto worker_name = kbase::StringFormat("{0}-{1}", name_, i);
         auto worker = std::make_unique<Thread>(std::move(worker_name));
 
+        // Runs ahead of any task queued onto the worker afterwards.
+        if (pin_to_cpus) {
+            auto cpu = cpus[i % cpus.size()];
+            worker->event_loop()->QueueTask([cpu] {
+                this_thread::SetCPUAffinity(cpu);
+            });
+        }
+
         loops_.push_back(worker->event_loop());
         workers_.push_back(std::move(worker));
     }
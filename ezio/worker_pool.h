@@ -19,7 +19,11 @@ class Thread;
 class WorkerPool {
 public:
     // WorkerPool's name will be the prefix of every worker thread's name.
-    WorkerPool(EventLoop* main_loop, size_t worker_num, std::string name);
+    // If `pin_to_cpus` is true, the i-th worker runs only on the i-th CPU available to the
+    // process, modulo the number of such CPUs; a worker that fails to be pinned keeps running
+    // unpinned.
+    WorkerPool(EventLoop* main_loop, size_t worker_num, std::string name,
+               bool pin_to_cpus = false);
 
     ~WorkerPool();
 
@@ -34,6 +38,12 @@ public:
 
     EventLoop* GetNextEventLoop();
 
+    // Loops of workers, in the order of workers' names.
+    const std::vector<EventLoop*>& event_loops() const noexcept
+    {
+        return loops_;
+    }
+
 private:
     EventLoop* main_loop_;
     std::string name_;
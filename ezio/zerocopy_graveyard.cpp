@@ -0,0 +1,149 @@
+/*
+ @ 0xCCCCCCCC
+*/
+
+#include "ezio/zerocopy_graveyard.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <linux/errqueue.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include "kbase/error_exception_util.h"
+#include "kbase/logging.h"
+
+#include "ezio/event_loop.h"
+
+// Available since Linux 4.14, while libc headers may be older.
+#if !defined(SO_EE_ORIGIN_ZEROCOPY)
+#define SO_EE_ORIGIN_ZEROCOPY 5
+#endif
+
+#if !defined(SO_EE_CODE_ZEROCOPY_COPIED)
+#define SO_EE_CODE_ZEROCOPY_COPIED 1
+#endif
+
+namespace ezio {
+
+constexpr std::chrono::milliseconds ZeroCopyGraveyard::kReapInterval;
+
+bool ReadZeroCopyCompletions(const ScopedSocket& sock,
+                             const std::function<void(uint32_t, uint32_t, bool)>& on_completed)
+{
+    while (true) {
+        char control[128];
+        msghdr msg {};
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        if (recvmsg(sock.get(), &msg, MSG_ERRQUEUE) < 0) {
+            auto err = errno;
+            if (err == EAGAIN) {
+                return true;
+            }
+
+            LOG(ERROR) << "Failed to read the error queue of socket " << sock.get()
+                       << "; err: " << err;
+            return false;
+        }
+
+        for (auto cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if (!(cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) &&
+                !(cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR)) {
+                continue;
+            }
+
+            sock_extended_err ee;
+            memcpy(&ee, CMSG_DATA(cmsg), sizeof(ee));
+            if (ee.ee_errno != 0 || ee.ee_origin != SO_EE_ORIGIN_ZEROCOPY) {
+                continue;
+            }
+
+            // Sends in the range [ee_info, ee_data] are done.
+            on_completed(ee.ee_info, ee.ee_data - ee.ee_info,
+                         (ee.ee_code & SO_EE_CODE_ZEROCOPY_COPIED) != 0);
+        }
+    }
+}
+
+void ReleaseZeroCopySends(ZeroCopyPendingSends& pending, uint32_t first, uint32_t span)
+{
+    auto done = std::remove_if(pending.begin(), pending.end(),
+                               [first, span](const auto& send) {
+                                   return send.first - first <= span;
+                               });
+    pending.erase(done, pending.end());
+}
+
+ZeroCopyGraveyard::ZeroCopyGraveyard(EventLoop* loop)
+    : loop_(loop),
+      reap_scheduled_(false)
+{}
+
+void ZeroCopyGraveyard::Adopt(const ScopedSocket& sock, ZeroCopyPendingSends&& pending)
+{
+    ENSURE(CHECK, loop_->BelongsToCurrentThread()).Require();
+
+    if (pending.empty()) {
+        return;
+    }
+
+    // Without a socket to read reports from, payloads are held until the loop is gone.
+    ScopedSocket dup_sock(fcntl(sock.get(), F_DUPFD_CLOEXEC, 0));
+    if (dup_sock.get() < 0) {
+        auto err = errno;
+        LOG(ERROR) << "Failed to duplicate socket " << sock.get() << " for reaping "
+                   << pending.size() << " zero-copy sends; err: " << err;
+    }
+
+    graves_.push_back(Grave{std::move(dup_sock), std::move(pending)});
+
+    if (!reap_scheduled_) {
+        reap_scheduled_ = true;
+        loop_->RunTaskAfter(std::bind(&ZeroCopyGraveyard::Reap, this), kReapInterval);
+    }
+}
+
+size_t ZeroCopyGraveyard::size() const noexcept
+{
+    size_t count = 0;
+    for (const auto& grave : graves_) {
+        count += grave.pending.size();
+    }
+
+    return count;
+}
+
+void ZeroCopyGraveyard::Reap()
+{
+    reap_scheduled_ = false;
+
+    for (auto& grave : graves_) {
+        if (grave.sock.get() < 0) {
+            continue;
+        }
+
+        auto& pending = grave.pending;
+        ReadZeroCopyCompletions(grave.sock, [&pending](uint32_t first, uint32_t span, bool) {
+            ReleaseZeroCopySends(pending, first, span);
+        });
+    }
+
+    // Closes duplicates of sockets whose payloads are all released.
+    graves_.erase(std::remove_if(graves_.begin(), graves_.end(),
+                                 [](const Grave& grave) {
+                                     return grave.pending.empty();
+                                 }),
+                  graves_.end());
+
+    if (std::any_of(graves_.cbegin(), graves_.cend(),
+                    [](const Grave& grave) { return grave.sock.get() >= 0; })) {
+        reap_scheduled_ = true;
+        loop_->RunTaskAfter(std::bind(&ZeroCopyGraveyard::Reap, this), kReapInterval);
+    }
+}
+
+}   // namespace ezio
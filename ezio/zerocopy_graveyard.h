@@ -0,0 +1,81 @@
+/*
+ @ 0xCCCCCCCC
+*/
+
+#ifndef EZIO_ZEROCOPY_GRAVEYARD_H_
+#define EZIO_ZEROCOPY_GRAVEYARD_H_
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "kbase/basic_macros.h"
+
+#include "ezio/scoped_socket.h"
+
+namespace ezio {
+
+class EventLoop;
+
+// Payloads of MSG_ZEROCOPY sends the kernel hasn't yet reported complete, along with ids
+// of the sends.
+using ZeroCopyPendingSends = std::deque<std::pair<uint32_t, std::shared_ptr<const void>>>;
+
+// Reads completion reports of zero-copy sends from the error queue of `sock` until it is
+// drained, and runs `on_completed` for each with the first id of the sends completed, the
+// number of the others following it, and whether the kernel copied them after all.
+// Returns false if reading the error queue failed.
+bool ReadZeroCopyCompletions(const ScopedSocket& sock,
+                             const std::function<void(uint32_t, uint32_t, bool)>& on_completed);
+
+// Releases payloads of sends in the range [first, first + span]; ids may wrap around.
+void ReleaseZeroCopySends(ZeroCopyPendingSends& pending, uint32_t first, uint32_t span);
+
+// ZeroCopyGraveyard holds payloads of zero-copy sends made by connections that are torn
+// down before the kernel reports the sends complete, until it does.
+// The kernel pins pages of a payload, not its allocation, and freeing the payload early
+// lets the allocator reuse and overwrite memory that is still being transmitted.
+// A duplicate of the socket is kept to read the reports, which in turn holds back closing
+// the socket, i.e. the FIN if the socket isn't shut down yet, until then.
+// A graveyard is owned by an EventLoop and must be used on the loop thread. Payloads still
+// held when the loop is destroyed are released along with it.
+class ZeroCopyGraveyard {
+public:
+    static constexpr auto kReapInterval = std::chrono::milliseconds(10);
+
+    explicit ZeroCopyGraveyard(EventLoop* loop);
+
+    ~ZeroCopyGraveyard() = default;
+
+    DISALLOW_COPY(ZeroCopyGraveyard);
+
+    DISALLOW_MOVE(ZeroCopyGraveyard);
+
+    // Takes over payloads of `pending` sends made on `sock`, and releases them as their
+    // completion reports arrive.
+    void Adopt(const ScopedSocket& sock, ZeroCopyPendingSends&& pending);
+
+    // Returns the number of payloads held.
+    size_t size() const noexcept;
+
+private:
+    void Reap();
+
+private:
+    struct Grave {
+        ScopedSocket sock;
+        ZeroCopyPendingSends pending;
+    };
+
+    EventLoop* loop_;
+    std::vector<Grave> graves_;
+    bool reap_scheduled_;
+};
+
+}   // namespace ezio
+
+#endif  // EZIO_ZEROCOPY_GRAVEYARD_H_
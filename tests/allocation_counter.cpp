@@ -0,0 +1,105 @@
+/*
+ @ 0xCCCCCCCC
+*/
+
+#include "tests/allocation_counter.h"
+
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+thread_local bool counting_allocations = false;
+thread_local size_t allocation_count = 0;
+
+void* CountedAlloc(size_t size) noexcept
+{
+    if (counting_allocations) {
+        ++allocation_count;
+    }
+
+    return std::malloc(size ? size : 1);
+}
+
+}   // namespace
+
+namespace ezio {
+
+AllocationCounter::AllocationCounter()
+{
+    allocation_count = 0;
+    counting_allocations = true;
+}
+
+AllocationCounter::~AllocationCounter()
+{
+    counting_allocations = false;
+}
+
+size_t AllocationCounter::count() const
+{
+    return allocation_count;
+}
+
+}   // namespace ezio
+
+// Replaces every allocation and deallocation function of C++14, thus each pair matches
+// for the whole test binary.
+
+void* operator new(size_t size)
+{
+    if (auto ptr = CountedAlloc(size)) {
+        return ptr;
+    }
+
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+    if (auto ptr = CountedAlloc(size)) {
+        return ptr;
+    }
+
+    throw std::bad_alloc();
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    return CountedAlloc(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    return CountedAlloc(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept
+{
+    std::free(ptr);
+}
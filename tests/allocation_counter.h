@@ -0,0 +1,32 @@
+/*
+ @ 0xCCCCCCCC
+*/
+
+#ifndef EZIO_TESTS_ALLOCATION_COUNTER_H_
+#define EZIO_TESTS_ALLOCATION_COUNTER_H_
+
+#include <cstddef>
+
+#include "kbase/basic_macros.h"
+
+namespace ezio {
+
+// Counts allocations made by the current thread while alive; allocations elsewhere, e.g. in
+// other tests, are not counted.
+// Allocation functions are replaced for the whole test binary in allocation_counter.cpp.
+class AllocationCounter {
+public:
+    AllocationCounter();
+
+    ~AllocationCounter();
+
+    DISALLOW_COPY(AllocationCounter);
+
+    DISALLOW_MOVE(AllocationCounter);
+
+    size_t count() const;
+};
+
+}   // namespace ezio
+
+#endif  // EZIO_TESTS_ALLOCATION_COUNTER_H_
@@ -0,0 +1,157 @@
+/*
+ @ 0xCCCCCCCC
+*/
+
+#include "catch2/catch.hpp"
+
+#include <memory>
+#include <string>
+
+#include "ezio/block_pool.h"
+#include "ezio/buffer.h"
+#include "ezio/output_queue.h"
+
+namespace ezio {
+
+TEST_CASE("Acquiring and releasing blocks", "[BlockPool]")
+{
+    BlockPool pool(64, 128);
+    REQUIRE(pool.block_size() == 64);
+
+    auto b1 = pool.Acquire();
+    auto b2 = pool.Acquire();
+    auto b3 = pool.Acquire();
+    REQUIRE(pool.stats().misses == 3);
+    REQUIRE(pool.stats().hits == 0);
+    REQUIRE(pool.stats().borrowed_bytes == 192);
+    REQUIRE(pool.stats().cached_bytes == 0);
+
+    // The third release exceeds the high-water mark, thus is freed.
+    pool.Release(b1);
+    pool.Release(b2);
+    pool.Release(b3);
+    REQUIRE(pool.stats().borrowed_bytes == 0);
+    REQUIRE(pool.stats().cached_bytes == 128);
+    REQUIRE(pool.stats().resident_bytes() == 128);
+
+    auto b4 = pool.Acquire();
+    REQUIRE(pool.stats().hits == 1);
+    REQUIRE(pool.stats().cached_bytes == 64);
+    REQUIRE(pool.stats().resident_bytes() == 128);
+    pool.Release(b4);
+
+    pool.Purge();
+    REQUIRE(pool.stats().resident_bytes() == 0);
+}
+
+TEST_CASE("Pooled chained buffer returns blocks once drained", "[BlockPool]")
+{
+    BlockPool pool(32, 1024);
+
+    {
+        auto buf = Buffer::MakeChained(&pool);
+        REQUIRE(pool.stats().resident_bytes() == 0);
+
+        std::string data(100, 'x');
+        buf.Write(data.data(), data.size());
+        REQUIRE(buf.readable_size() == 100);
+        // 24 bytes in the head block which reserves prependable space, then 32 each.
+        REQUIRE(pool.stats().borrowed_bytes == 4 * 32);
+        REQUIRE(std::string(buf.cbegin(), buf.cend()) == data);
+
+        buf.Consume(40);
+        REQUIRE(pool.stats().borrowed_bytes == 3 * 32);
+        REQUIRE(buf.ReadAsString(60) == std::string(60, 'x'));
+        REQUIRE(pool.stats().borrowed_bytes == 0);
+        REQUIRE(pool.stats().cached_bytes == 4 * 32);
+
+        buf.Write(data.data(), 10);
+        REQUIRE(pool.stats().hits == 1);
+
+        // Copies don't borrow from the pool.
+        Buffer copy(buf);
+        REQUIRE(pool.stats().borrowed_bytes == 32);
+        REQUIRE(copy.ReadAsString(10) == std::string(10, 'x'));
+        copy.Write(data.data(), data.size());
+        REQUIRE(pool.stats().borrowed_bytes == 32);
+    }
+
+    REQUIRE(pool.stats().borrowed_bytes == 0);
+}
+
+TEST_CASE("Moved-from pooled buffer is left empty and pooled", "[BlockPool]")
+{
+    BlockPool pool(32, 1024);
+
+    auto buf = Buffer::MakeChained(&pool);
+    std::string data(100, 'x');
+    buf.Write(data.data(), data.size());
+
+    Buffer moved(std::move(buf));
+    REQUIRE(moved.pooled());
+    REQUIRE(moved.readable_size() == 100);
+    REQUIRE(buf.pooled());
+    REQUIRE(buf.readable_size() == 0);
+    REQUIRE(buf.cbegin() == buf.cend());
+
+    buf.Write(data.data(), 10);
+    REQUIRE(buf.ReadAsString(10) == std::string(10, 'x'));
+
+    moved.ConsumeAll();
+    REQUIRE(pool.stats().borrowed_bytes == 0);
+
+    Buffer contiguous;
+    contiguous.Write(data.data(), data.size());
+    Buffer taker;
+    taker = std::move(contiguous);
+    REQUIRE(taker.readable_size() == 100);
+    REQUIRE(contiguous.readable_size() == 0);
+    REQUIRE(contiguous.writable_size() == 0);
+    contiguous.ConsumeAll();
+    contiguous.Write(data.data(), 10);
+    REQUIRE(contiguous.ReadAsString(10) == std::string(10, 'x'));
+}
+
+TEST_CASE("Borrowed blocks outlive the pool", "[BlockPool]")
+{
+    auto pool = std::make_unique<BlockPool>(32, 1024);
+    auto drained = Buffer::MakeChained(pool.get());
+    auto dropped = Buffer::MakeChained(pool.get());
+
+    std::string data(100, 'x');
+    drained.Write(data.data(), data.size());
+    dropped.Write(data.data(), data.size());
+    REQUIRE(pool->stats().borrowed_bytes == 8 * 32);
+
+    // Blocks returned from now on are freed.
+    pool = nullptr;
+    drained.ConsumeAll();
+    REQUIRE(drained.readable_size() == 0);
+}
+
+TEST_CASE("Pooled output queue", "[BlockPool]")
+{
+    BlockPool pool(64, 1024);
+    OutputQueue queue(&pool);
+
+    queue.Append(kbase::StringView("hello, "));
+    queue.Append(kbase::StringView("world"));
+    REQUIRE(queue.segment_count() == 1);
+    REQUIRE(queue.size() == 12);
+    REQUIRE(pool.stats().borrowed_bytes == 64);
+
+    queue.Append(std::string(100, 'y'));
+    queue.Append(kbase::StringView("!"));
+    REQUIRE(queue.segment_count() == 3);
+    REQUIRE(pool.stats().borrowed_bytes == 128);
+
+    queue.Consume(12);
+    REQUIRE(pool.stats().borrowed_bytes == 64);
+
+    queue.Consume(101);
+    REQUIRE(queue.empty());
+    REQUIRE(pool.stats().borrowed_bytes == 0);
+    REQUIRE(pool.stats().cached_bytes == 128);
+}
+
+}   // namespace ezio
@@ -5,9 +5,16 @@
 
 #include <algorithm>
 #include <cstring>
+#include <thread>
+#include <type_traits>
+#include <vector>
 
 #include "kbase/string_view.h"
 
+#if defined(OS_POSIX)
+#include <unistd.h>
+#endif
+
 namespace {
 
 constexpr size_t kSupposedPrepend = 8;
@@ -38,6 +45,17 @@ TEST_CASE("Construct a buffer", "[Buffer]")
         REQUIRE(kSupposedPrepend == buf.prependable_size());
         REQUIRE(32 == buf.writable_size());
     }
+
+    SECTION("moves never throw, thus containers move buffers on growth") {
+        static_assert(std::is_nothrow_move_constructible<Buffer>::value, "move ctor");
+        static_assert(std::is_nothrow_move_assignable<Buffer>::value, "move assignment");
+
+        std::vector<Buffer> bufs(1);
+        bufs[0].Write("hello", 5);
+        auto data = bufs[0].Peek();
+        bufs.resize(bufs.capacity() + 1);
+        REQUIRE(data == bufs[0].Peek());
+    }
 }
 
 TEST_CASE("Write data bytes to buffer", "[Buffer]")
@@ -231,4 +249,199 @@ TEST_CASE("Iteratos", "[Buffer]")
     REQUIRE(std::string(buf.begin(), space_it) == "hello");
 }
 
+TEST_CASE("Chained buffer spreads content across blocks", "[Buffer]")
+{
+    auto buf = Buffer::MakeChained(16);
+    REQUIRE(buf.chained());
+    REQUIRE(0 == buf.readable_size());
+    REQUIRE(0 == buf.writable_size());
+    REQUIRE(buf.begin() == buf.end());
+
+    std::string s("the quick brown fox jumps over the lazy dog");
+    buf.Write(s.data(), s.size());
+    REQUIRE(s.size() == buf.readable_size());
+    REQUIRE(kSupposedPrepend == buf.prependable_size());
+
+    SECTION("iterators walk through blocks") {
+        REQUIRE(static_cast<size_t>(std::distance(buf.begin(), buf.end())) == s.size());
+        REQUIRE(std::string(buf.begin(), buf.end()) == s);
+        auto it = std::find(buf.begin(), buf.end(), 'z');
+        REQUIRE(it != buf.end());
+        REQUIRE(static_cast<size_t>(it - buf.begin()) == s.find('z'));
+        REQUIRE(*(it - 20) == s[s.find('z') - 20]);
+        REQUIRE(buf.begin()[30] == s[30]);
+    }
+
+    SECTION("iterator distances survive reads in between") {
+        auto it = std::find(buf.begin(), buf.end(), 'f');
+        buf.Consume(4);
+        REQUIRE(static_cast<size_t>(it - buf.cbegin()) == s.find('f') - 4);
+        REQUIRE(static_cast<size_t>(buf.cend() - buf.cbegin()) == buf.readable_size());
+        REQUIRE(static_cast<size_t>(buf.FindByte('z') - buf.cbegin()) == s.find('z') - 4);
+        REQUIRE(static_cast<size_t>(buf.Find("lazy") - buf.cbegin()) == s.find("lazy") - 4);
+    }
+
+    SECTION("consume and read across block boundaries") {
+        buf.Consume(10);
+        REQUIRE(buf.ReadAsString(20) == s.substr(10, 20));
+        REQUIRE(buf.ReadAllAsString() == s.substr(30));
+        REQUIRE(0 == buf.readable_size());
+        REQUIRE(buf.begin() == buf.end());
+    }
+
+    SECTION("linearizing gathers content into one block") {
+        buf.Consume(4);
+        kbase::StringView sv(buf.Linearize(), buf.readable_size());
+        REQUIRE(sv == s.substr(4));
+
+        // Peeking is then allowed via a const reference.
+        const Buffer& cbuf = buf;
+        REQUIRE(cbuf.Peek() == sv.data());
+        REQUIRE(buf.ReadAllAsString() == s.substr(4));
+    }
+
+    SECTION("linearizing with size gathers only blocks needed") {
+        buf.Consume(4);
+        REQUIRE(buf.contiguous_readable_size() == 12);
+        kbase::StringView sv(buf.Linearize(10), 10);
+        REQUIRE(sv == s.substr(4, 10));
+        REQUIRE(buf.contiguous_readable_size() == 12);
+
+        // Only bytes asked for are moved, and the rest stays in the second block.
+        sv = kbase::StringView(buf.Linearize(20), 20);
+        REQUIRE(sv == s.substr(4, 20));
+        REQUIRE(buf.contiguous_readable_size() == 20);
+        REQUIRE(std::string(buf.begin(), buf.end()) == s.substr(4));
+        buf.Write(s.data(), 3);
+        REQUIRE(buf.ReadAllAsString() == s.substr(4) + s.substr(0, 3));
+    }
+}
+
+TEST_CASE("Chained buffer supports values and prepending", "[Buffer]")
+{
+    auto buf = Buffer::MakeChained(7);
+    buf.Write(uint8_t(0xFF));
+    buf.Write(uint32_t(0xDEADBEEF));
+    buf.Write(int64_t(-1024));
+    buf.Write(3.1415926);
+    buf.Prepend(static_cast<int32_t>(buf.readable_size()));
+
+    REQUIRE(buf.ReadAs<int32_t>() == 21);
+    REQUIRE(buf.ReadAs<uint8_t>() == 0xFF);
+    REQUIRE(buf.ReadAs<uint32_t>() == 0xDEADBEEF);
+    REQUIRE(buf.ReadAs<int64_t>() == -1024);
+    REQUIRE(buf.ReadAs<double>() == 3.1415926);
+    REQUIRE(0 == buf.readable_size());
+
+    // No head block, thus no prependable space.
+    REQUIRE(0 == buf.prependable_size());
+    buf.Prepend("", 0);
+    REQUIRE(0 == buf.readable_size());
+}
+
+#if defined(OS_POSIX)
+
+TEST_CASE("Chained buffer exports iovecs", "[Buffer]")
+{
+    auto buf = Buffer::MakeChained(16);
+
+    iovec vecs[8];
+    auto cnt = buf.PrepareWritableIOVecs(40, vecs, 8);
+    REQUIRE(buf.writable_size() >= 40);
+    REQUIRE(cnt == 3);
+
+    std::string s("0123456789abcdefghijklmnopqrstuvwxyzABCD");
+    size_t copied = 0;
+    for (size_t i = 0; i < cnt && copied < s.size(); ++i) {
+        auto n = std::min(vecs[i].iov_len, s.size() - copied);
+        memcpy(vecs[i].iov_base, s.data() + copied, n);
+        copied += n;
+    }
+
+    buf.EndWrite(s.size());
+    REQUIRE(s.size() == buf.readable_size());
+
+    cnt = buf.PeekIOVecs(vecs, 8);
+    REQUIRE(cnt == 3);
+    std::string joined;
+    for (size_t i = 0; i < cnt; ++i) {
+        joined.append(static_cast<const char*>(vecs[i].iov_base), vecs[i].iov_len);
+    }
+
+    REQUIRE(joined == s);
+}
+
+TEST_CASE("Read from fd into buffers", "[Buffer]")
+{
+    int fds[2];
+    REQUIRE(pipe(fds) == 0);
+
+    std::string s(100000, 'x');
+    auto writer = [&] {
+        size_t written = 0;
+        while (written < s.size()) {
+            auto n = write(fds[1], s.data() + written, s.size() - written);
+            if (n <= 0) {
+                break;
+            }
+
+            written += static_cast<size_t>(n);
+        }
+
+        close(fds[1]);
+    };
+
+    char spill[1024];
+
+    SECTION("into writable space with the default spill area") {
+        Buffer buf;
+        std::thread th(writer);
+        while (ReadFDInVec(fds[0], buf) > 0) {}
+        th.join();
+        REQUIRE(buf.ReadAllAsString() == s);
+    }
+
+    SECTION("without spill area") {
+        Buffer buf;
+        std::thread th(writer);
+        while (ReadFDInVec(fds[0], buf, 512, nullptr, 0) > 0) {}
+        th.join();
+        REQUIRE(buf.ReadAllAsString() == s);
+    }
+
+    SECTION("contiguous buffer") {
+        Buffer buf;
+        std::thread th(writer);
+        while (ReadFDInVec(fds[0], buf, 512, spill, sizeof(spill)) > 0) {}
+        th.join();
+        REQUIRE(buf.ReadAllAsString() == s);
+    }
+
+    SECTION("chained buffer") {
+        auto buf = Buffer::MakeChained(4096);
+        std::thread th(writer);
+        while (ReadFDInVec(fds[0], buf, 512, spill, sizeof(spill)) > 0) {}
+        th.join();
+        REQUIRE(buf.ReadAllAsString() == s);
+    }
+
+    SECTION("each read is capped despite spare writable space") {
+        Buffer buf;
+        buf.ReserveWritable(8192);
+        std::thread th(writer);
+        ssize_t n = 0;
+        bool capped = true;
+        while ((n = ReadFDInVec(fds[0], buf, 512, spill, sizeof(spill))) > 0) {
+            capped = capped && static_cast<size_t>(n) <= 512 + sizeof(spill);
+        }
+        th.join();
+        REQUIRE(capped);
+        REQUIRE(buf.ReadAllAsString() == s);
+    }
+
+    close(fds[0]);
+}
+
+#endif
+
 }   // namespace ezio
@@ -0,0 +1,211 @@
+/*
+ @ 0xCCCCCCCC
+*/
+
+#include "catch2/catch.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "ezio/buffer.h"
+#include "ezio/byte_search.h"
+
+namespace {
+
+using ezio::internal::SearchImpl;
+
+const SearchImpl kAllImpls[] {SearchImpl::Scalar, SearchImpl::SSE2, SearchImpl::AVX2};
+
+const char* ImplName(SearchImpl impl)
+{
+    switch (impl) {
+        case SearchImpl::SSE2:
+            return "SSE2";
+        case SearchImpl::AVX2:
+            return "AVX2";
+        default:
+            return "Scalar";
+    }
+}
+
+// Restores the implementation selected at startup.
+class ScopedSearchImpl {
+public:
+    explicit ScopedSearchImpl(SearchImpl impl)
+        : saved_(ezio::internal::ActiveSearchImpl())
+    {
+        ezio::internal::UseSearchImpl(impl);
+    }
+
+    ~ScopedSearchImpl()
+    {
+        ezio::internal::UseSearchImpl(saved_);
+    }
+
+private:
+    SearchImpl saved_;
+};
+
+template<typename F>
+double MeasureNsPerByte(size_t data_size, int rounds, F fn)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; ++i) {
+        fn();
+    }
+
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / (static_cast<double>(data_size) * rounds);
+}
+
+}   // namespace
+
+namespace ezio {
+
+TEST_CASE("Vectorized searching agrees with std::search", "[ByteSearch]")
+{
+    // Long enough for filtering windows to grow.
+    std::string haystack;
+    for (int i = 0; i < 3000; ++i) {
+        haystack.push_back(static_cast<char>('a' + (i * 7) % 13));
+    }
+
+    haystack += "\r\n";
+    haystack.push_back('\0');
+    haystack += "needle\xff";
+
+    const std::vector<std::string> needles {
+        "a", "m", "\r\n", "\n", std::string(1, '\0'), "needle", "needle\xff", "nope", "ab",
+        haystack.substr(100, 40), haystack.substr(2500, 300), haystack
+    };
+
+    for (auto impl : kAllImpls) {
+        if (!internal::IsSearchImplSupported(impl)) {
+            continue;
+        }
+
+        INFO(ImplName(impl));
+        ScopedSearchImpl scoped_impl(impl);
+
+        // Varying the start covers all alignments and tail lengths.
+        for (size_t start = 0; start < 40; ++start) {
+            auto first = haystack.data() + start;
+            auto last = haystack.data() + haystack.size();
+            for (const auto& needle : needles) {
+                auto expected = std::search(first, last, needle.begin(), needle.end());
+                auto found = internal::FindBytes(first, last, needle.data(), needle.size());
+                REQUIRE((found ? found : last) == expected);
+            }
+
+            auto expected = std::find(first, last, '\n');
+            auto found = internal::FindByte(first, last, '\n');
+            REQUIRE((found ? found : last) == expected);
+        }
+    }
+}
+
+TEST_CASE("Searching in buffers", "[Buffer]")
+{
+    std::string content = "GET / HTTP/1.1\r\nHost: example.com\r\n\r\nbody\n";
+
+    SECTION("contiguous buffer") {
+        Buffer buf;
+        buf.Write(content.data(), content.size());
+        buf.Consume(4);
+
+        REQUIRE(buf.FindCRLF() - buf.cbegin() == 10);
+        REQUIRE(buf.FindEOL() - buf.cbegin() == 11);
+        REQUIRE(buf.FindByte('H') - buf.cbegin() == 2);
+        REQUIRE(buf.Find("\r\n\r\n") - buf.cbegin() == 29);
+        REQUIRE(buf.Find("") == buf.cbegin());
+        REQUIRE(buf.Find("HTTP/2") == buf.cend());
+        REQUIRE(buf.FindByte('#') == buf.cend());
+    }
+
+    SECTION("chained buffer with matches spanning blocks") {
+        // Blocks of 4 bytes split up almost every delimiter.
+        auto buf = Buffer::MakeChained(4);
+        buf.Write(content.data(), content.size());
+        buf.Consume(4);
+
+        auto crlf = buf.FindCRLF();
+        REQUIRE(crlf - buf.cbegin() == 10);
+        REQUIRE(*crlf == '\r');
+        REQUIRE(*(crlf + 1) == '\n');
+        REQUIRE(buf.FindEOL() - buf.cbegin() == 11);
+        REQUIRE(buf.Find("\r\n\r\n") - buf.cbegin() == 29);
+        REQUIRE(buf.Find("example.com") - buf.cbegin() == 18);
+        REQUIRE(buf.Find("body\n") - buf.cbegin() == 33);
+        REQUIRE(buf.Find("body\n\n") == buf.cend());
+        REQUIRE(buf.FindByte('#') == buf.cend());
+    }
+
+    SECTION("empty buffers") {
+        Buffer buf;
+        REQUIRE(buf.FindCRLF() == buf.cend());
+
+        auto chained = Buffer::MakeChained(16);
+        REQUIRE(chained.FindEOL() == chained.cend());
+        REQUIRE(chained.Find("x") == chained.cend());
+    }
+}
+
+TEST_CASE("Searching against iterator-based scan", "[.benchmark]")
+{
+    constexpr size_t kDataSize = 1024 * 1024;
+    constexpr int kRounds = 200;
+
+    // A rare delimiter at the very end, and header-like lines full of partial matches.
+    std::string sparse(kDataSize, 'x');
+    sparse.replace(kDataSize - 4, 4, "\r\n\r\n");
+
+    std::string headers;
+    while (headers.size() < kDataSize - 4) {
+        headers += "X-Header: value\r\n";
+    }
+
+    headers.resize(kDataSize - 4);
+    headers += "\r\n\r\n";
+
+    const char delim[] = "\r\n\r\n";
+
+    struct Workload {
+        const char* name;
+        const std::string* data;
+    };
+
+    for (auto workload : {Workload{"sparse", &sparse}, Workload{"headers", &headers}}) {
+        Buffer contiguous;
+        contiguous.Write(workload.data->data(), workload.data->size());
+        auto chained = Buffer::MakeChained();
+        chained.Write(workload.data->data(), workload.data->size());
+
+        for (auto buf : {&contiguous, &chained}) {
+            const char* mode = buf->chained() ? "chained" : "contiguous";
+
+            auto ns = MeasureNsPerByte(kDataSize, kRounds, [buf, &delim] {
+                auto it = std::search(buf->cbegin(), buf->cend(), delim, delim + 4);
+                REQUIRE(it != buf->cend());
+            });
+            printf("%-8s %-10s std::search    %.3f ns/byte\n", workload.name, mode, ns);
+
+            for (auto impl : kAllImpls) {
+                if (!internal::IsSearchImplSupported(impl)) {
+                    continue;
+                }
+
+                ScopedSearchImpl scoped_impl(impl);
+                ns = MeasureNsPerByte(kDataSize, kRounds, [buf] {
+                    REQUIRE(buf->Find("\r\n\r\n") != buf->cend());
+                });
+                printf("%-8s %-10s Find/%-6s    %.3f ns/byte\n",
+                       workload.name, mode, ImplName(impl), ns);
+            }
+        }
+    }
+}
+
+}   // namespace ezio
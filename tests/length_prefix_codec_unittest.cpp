@@ -0,0 +1,183 @@
+/*
+ @ 0xCCCCCCCC
+*/
+
+#include "catch2/catch.hpp"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "ezio/block_pool.h"
+#include "ezio/length_prefix_codec.h"
+
+#include "tests/allocation_counter.h"
+
+namespace {
+
+using ezio::LengthPrefixCodec;
+
+LengthPrefixCodec::Options MakeOptions(size_t header_size, LengthPrefixCodec::ByteOrder order,
+                                       size_t max_frame_size)
+{
+    LengthPrefixCodec::Options opts;
+    opts.header_size = header_size;
+    opts.byte_order = order;
+    opts.max_frame_size = max_frame_size;
+    return opts;
+}
+
+void CheckDecodingFrames(LengthPrefixCodec::ByteOrder order)
+{
+    const std::vector<std::string> payloads {
+        "hello", "", std::string(300, 'x'), "world", std::string(5000, 'y')
+    };
+
+    LengthPrefixCodec codec(MakeOptions(4, order, 8192));
+
+    std::vector<std::string> frames;
+    codec.set_on_frame([&frames](const ezio::TCPConnectionPtr&, kbase::StringView frame,
+                                 ezio::TimePoint) {
+        frames.push_back(frame.ToString());
+    });
+
+    std::string stream;
+    for (const auto& payload : payloads) {
+        stream += codec.Encode(payload);
+    }
+
+    SECTION("contiguous buffer fed byte ranges") {
+        ezio::Buffer buf;
+        for (size_t pos = 0; pos < stream.size(); pos += 7) {
+            auto n = std::min<size_t>(7, stream.size() - pos);
+            buf.Write(stream.data() + pos, n);
+            codec.OnDataReceive(nullptr, buf, ezio::TimePoint());
+        }
+
+        REQUIRE(frames == payloads);
+        REQUIRE(buf.readable_size() == 0);
+    }
+
+    SECTION("chained buffer with frames spanning blocks") {
+        auto buf = ezio::Buffer::MakeChained(64);
+        buf.Write(stream.data(), stream.size() - 3);
+        codec.OnDataReceive(nullptr, buf, ezio::TimePoint());
+        REQUIRE(frames.size() == payloads.size() - 1);
+
+        // The last frame is incomplete and kept.
+        REQUIRE(buf.readable_size() == 4 + payloads.back().size() - 3);
+
+        buf.Write(stream.data() + stream.size() - 3, 3);
+        codec.OnDataReceive(nullptr, buf, ezio::TimePoint());
+        REQUIRE(frames == payloads);
+        REQUIRE(buf.readable_size() == 0);
+    }
+}
+
+}   // namespace
+
+namespace ezio {
+
+TEST_CASE("Encoding frames", "[LengthPrefixCodec]")
+{
+    LengthPrefixCodec be_codec(MakeOptions(2, LengthPrefixCodec::ByteOrder::BigEndian, 1024));
+    REQUIRE(be_codec.Encode("abc") == std::string("\x00\x03" "abc", 5));
+
+    LengthPrefixCodec le_codec(MakeOptions(4, LengthPrefixCodec::ByteOrder::LittleEndian, 1024));
+    REQUIRE(le_codec.Encode("abc") == std::string("\x03\x00\x00\x00" "abc", 7));
+
+    // Limited by what the header can describe.
+    LengthPrefixCodec tiny_codec(MakeOptions(1, LengthPrefixCodec::ByteOrder::BigEndian, 1024));
+    REQUIRE(tiny_codec.options().max_frame_size == 255);
+}
+
+TEST_CASE("Decoding big-endian frames", "[LengthPrefixCodec]")
+{
+    CheckDecodingFrames(LengthPrefixCodec::ByteOrder::BigEndian);
+}
+
+TEST_CASE("Decoding little-endian frames", "[LengthPrefixCodec]")
+{
+    CheckDecodingFrames(LengthPrefixCodec::ByteOrder::LittleEndian);
+}
+
+TEST_CASE("Decoding small frames allocates nothing", "[LengthPrefixCodec]")
+{
+    constexpr size_t kFrameCount = 1000;
+
+    LengthPrefixCodec codec(MakeOptions(2, LengthPrefixCodec::ByteOrder::BigEndian, 1024));
+
+    size_t frame_count = 0;
+    size_t payload_size = 0;
+    codec.set_on_frame([&frame_count, &payload_size](const TCPConnectionPtr&,
+                                                      kbase::StringView frame, TimePoint) {
+        ++frame_count;
+        payload_size += frame.size();
+    });
+
+    auto frame = codec.Encode("ping");
+    std::string stream;
+    for (size_t i = 0; i < kFrameCount; ++i) {
+        stream += frame;
+    }
+
+    auto decode = [&](Buffer& buf) {
+        buf.Write(stream.data(), stream.size());
+        frame_count = 0;
+        payload_size = 0;
+
+        // Checks are made out of the scope, in case they allocate.
+        AllocationCounter counter;
+        codec.OnDataReceive(nullptr, buf, TimePoint());
+        return counter.count();
+    };
+
+    SECTION("contiguous buffer") {
+        Buffer buf(stream.size());
+        auto allocations = decode(buf);
+        REQUIRE(0 == allocations);
+        REQUIRE(kFrameCount == frame_count);
+        REQUIRE(kFrameCount * 4 == payload_size);
+    }
+
+    SECTION("pooled chained buffer with frames spanning blocks") {
+        // As input buffers of connections are; blocks are cached by the first round.
+        BlockPool pool(1000, 64 * 1024);
+        auto buf = Buffer::MakeChained(&pool);
+        decode(buf);
+        REQUIRE(kFrameCount == frame_count);
+
+        auto allocations = decode(buf);
+        REQUIRE(0 == allocations);
+        REQUIRE(kFrameCount == frame_count);
+        REQUIRE(kFrameCount * 4 == payload_size);
+    }
+}
+
+TEST_CASE("Oversized frames", "[LengthPrefixCodec]")
+{
+    LengthPrefixCodec codec(MakeOptions(2, LengthPrefixCodec::ByteOrder::BigEndian, 16));
+
+    std::vector<std::string> frames;
+    codec.set_on_frame([&frames](const TCPConnectionPtr&, kbase::StringView frame, TimePoint) {
+        frames.push_back(frame.ToString());
+    });
+
+    size_t error_size = 0;
+    codec.set_on_frame_error([&error_size](const TCPConnectionPtr&, size_t frame_size) {
+        error_size = frame_size;
+    });
+
+    Buffer buf;
+    auto valid = codec.Encode("ok");
+    buf.Write(valid.data(), valid.size());
+    buf.Write(static_cast<uint16_t>(17));
+    buf.Write(std::string(17, 'z').data(), 17);
+
+    codec.OnDataReceive(nullptr, buf, TimePoint());
+    REQUIRE(frames == std::vector<std::string>{"ok"});
+    REQUIRE(error_size == 17);
+    REQUIRE(buf.readable_size() == 0);
+}
+
+}   // namespace ezio
@@ -7,6 +7,7 @@
 #include "ezio/event_loop.h"
 
 #include <cstdio>
+#include <string>
 #include <thread>
 
 #include "kbase/at_exit_manager.h"
@@ -14,6 +15,8 @@
 
 #include "ezio/chrono_utils.h"
 #include "ezio/io_service_context.h"
+#include "ezio/notifier.h"
+#include "ezio/socket_utils.h"
 
 namespace ezio {
 
@@ -68,6 +71,240 @@ TEST_CASE("EventLoop and Notifier are two fundamental building blocks", "[MainLo
         th.join();
     }
 
+    SECTION("run tasks at the end of an iteration")
+    {
+        EventLoop loop;
+
+        std::string trace;
+        loop.QueueTask([&loop, &trace] {
+            loop.RunAtIterationEnd([&loop, &trace] {
+                trace += "end;";
+                // Tasks queued from here are run on the next iteration.
+                loop.QueueTask([&loop, &trace] {
+                    trace += "next;";
+                    loop.Quit();
+                });
+            });
+
+            trace += "first;";
+        });
+
+        loop.QueueTask([&trace] {
+            trace += "second;";
+        });
+
+        loop.Run();
+
+        REQUIRE(trace == "first;second;end;next;");
+    }
+
+    SECTION("busy poll for a while after handling tasks")
+    {
+        EventLoop loop;
+        loop.SetBusyPollWindow(std::chrono::seconds(1));
+
+        loop.QueueTask([&loop] {
+            // The timer expires within the window, and is picked up by spinning.
+            loop.RunTaskAfter([&loop] {
+                loop.Quit();
+            }, std::chrono::milliseconds(20));
+        });
+
+        loop.Run();
+
+        const auto& stats = loop.busy_poll_stats();
+        REQUIRE(stats.spins > 0);
+        REQUIRE(stats.useful_spins > 0);
+        REQUIRE(stats.useful_spins <= stats.spins);
+        REQUIRE(stats.blocking_waits == 0);
+    }
+
+#if defined(OS_POSIX)
+    SECTION("commit only net changes of watching events before waiting")
+    {
+        EventLoop loop;
+        auto sock = socket::CreateNonBlockingSocket();
+        Notifier notifier(&loop, sock);
+
+        size_t base = 0;
+        loop.QueueTask([&] {
+            base = loop.interest_update_count();
+
+            // Adding takes effect at once.
+            notifier.EnableReading();
+            REQUIRE(loop.interest_update_count() == base + 1);
+
+            // Changes cancelling out cost nothing.
+            notifier.EnableWriting();
+            notifier.DisableWriting();
+            notifier.DisableReading();
+            notifier.EnableReading();
+            notifier.EnableReading();
+
+            // And the last of real changes is committed on next wait.
+            notifier.EnableWriting();
+            notifier.DisableReading();
+            REQUIRE(loop.interest_update_count() == base + 1);
+
+            loop.RunAtIterationEnd([&] {
+                loop.QueueTask([&] {
+                    REQUIRE(loop.interest_update_count() == base + 2);
+
+                    notifier.DisableAll();
+                    notifier.Detach();
+                    REQUIRE(loop.interest_update_count() == base + 3);
+
+                    loop.Quit();
+                });
+            });
+        });
+
+        loop.Run();
+    }
+
+    SECTION("notify instead of throwing when failed to commit changes")
+    {
+        EventLoop loop;
+        auto sock = socket::CreateNonBlockingSocket();
+        Notifier notifier(&loop, sock);
+
+        bool closed = false;
+        notifier.set_on_close([&] {
+            closed = true;
+            loop.Quit();
+        });
+
+        loop.QueueTask([&] {
+            notifier.EnableReading();
+
+            // Closing the fd removes it from the epoll set behind our back.
+            sock.reset();
+            notifier.EnableWriting();
+        });
+
+        loop.Run();
+
+        REQUIRE(closed);
+
+        notifier.DisableAll();
+        notifier.Detach();
+    }
+#endif
+
+    SECTION("leave tasks beyond the budget to next iterations")
+    {
+        EventLoop loop;
+        EventLoop::IterationBudget budget;
+        budget.max_tasks = 3;
+        loop.SetIterationBudget(budget);
+
+        // Marks the end of each iteration tasks run in.
+        std::string trace;
+        bool marked = false;
+        auto mark = [&loop, &trace, &marked] {
+            if (!marked) {
+                marked = true;
+                loop.RunAtIterationEnd([&trace, &marked] {
+                    trace += ";";
+                    marked = false;
+                });
+            }
+        };
+
+        loop.QueueTask([&loop, &trace, &mark] {
+            for (int i = 0; i < 7; ++i) {
+                loop.QueueTask([&trace, &mark, i] {
+                    trace += std::to_string(i);
+                    mark();
+                });
+            }
+
+            // Runs after the tasks queued above, in order.
+            loop.QueueTask([&loop, &trace] {
+                trace += "q";
+                loop.Quit();
+            });
+
+            mark();
+        });
+
+        loop.Run();
+
+        REQUIRE(trace == ";012;345;6q;");
+        REQUIRE(loop.budget_stats().task_budget_hits == 2);
+        REQUIRE(loop.budget_stats().time_budget_hits == 0);
+    }
+
+    SECTION("leave tasks to next iterations once out of time")
+    {
+        EventLoop loop;
+        EventLoop::IterationBudget budget;
+        budget.max_time = std::chrono::milliseconds(5);
+        loop.SetIterationBudget(budget);
+
+        int ran = 0;
+        loop.QueueTask([&loop, &ran] {
+            for (int i = 0; i < 4; ++i) {
+                loop.QueueTask([&ran] {
+                    ++ran;
+                    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                });
+            }
+
+            loop.QueueTask([&loop] {
+                loop.Quit();
+            });
+        });
+
+        loop.Run();
+
+        REQUIRE(ran == 4);
+        REQUIRE(loop.budget_stats().time_budget_hits >= 4);
+    }
+
+    SECTION("share the time among an iteration")
+    {
+        EventLoop loop;
+
+        TimePoint first_seen;
+        loop.QueueTask([&loop, &first_seen] {
+            first_seen = loop.Now();
+            std::this_thread::sleep_for(std::chrono::milliseconds(20));
+            REQUIRE(loop.Now() == first_seen);
+
+            loop.RunAtIterationEnd([&loop, &first_seen] {
+                REQUIRE(loop.Now() == first_seen);
+                loop.QueueTask([&loop, &first_seen] {
+                    REQUIRE(loop.Now() - first_seen >= std::chrono::milliseconds(20));
+                    loop.Quit();
+                });
+            });
+        });
+
+        loop.Run();
+    }
+
+    SECTION("timers keep time on the coarse clock")
+    {
+        EventLoop loop;
+        loop.SetCoarseClock(true);
+
+        auto begin = MonotonicNow();
+        int ticks = 0;
+        TimerID timer(nullptr);
+        timer = loop.RunTaskEvery([&loop, &ticks, &timer] {
+            if (++ticks == 5) {
+                loop.CancelTimedTask(timer);
+                loop.Quit();
+            }
+        }, std::chrono::milliseconds(10));
+
+        loop.Run();
+
+        // Off by at most a tick of the coarse clock for each.
+        REQUIRE(MonotonicNow() - begin >= std::chrono::milliseconds(30));
+    }
+
     SECTION("runs a timed task")
     {
         EventLoop loop;
@@ -0,0 +1,180 @@
+/*
+ @ 0xCCCCCCCC
+*/
+
+#include "catch2/catch.hpp"
+
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "ezio/mpsc_queue.h"
+
+namespace {
+
+struct Item : ezio::MPSCQueueNode {
+    Item(int producer_id, int seq_num, std::atomic<int>* alive_count = nullptr)
+        : producer(producer_id), seq(seq_num), alive(alive_count)
+    {
+        if (alive) {
+            ++*alive;
+        }
+    }
+
+    ~Item()
+    {
+        if (alive) {
+            --*alive;
+        }
+    }
+
+    int producer;
+    int seq;
+    std::atomic<int>* alive;
+};
+
+}   // namespace
+
+namespace ezio {
+
+TEST_CASE("Push and consume in FIFO order", "[MPSCQueue]")
+{
+    MPSCQueue<Item> queue;
+    REQUIRE(queue.empty());
+
+    REQUIRE(queue.Push(std::make_unique<Item>(0, 1)));
+    REQUIRE_FALSE(queue.Push(std::make_unique<Item>(0, 2)));
+    REQUIRE_FALSE(queue.Push(std::make_unique<Item>(0, 3)));
+    REQUIRE_FALSE(queue.empty());
+
+    std::vector<int> seqs;
+    auto consumed = queue.ConsumeAll([&seqs](std::unique_ptr<Item> item) {
+        seqs.push_back(item->seq);
+    });
+    REQUIRE(3 == consumed);
+    REQUIRE(seqs == std::vector<int>{1, 2, 3});
+    REQUIRE(queue.empty());
+
+    // Drained queue reports being empty on the next push.
+    REQUIRE(queue.Push(std::make_unique<Item>(0, 4)));
+    REQUIRE(0 == MPSCQueue<Item>().ConsumeAll([](std::unique_ptr<Item>) {}));
+}
+
+TEST_CASE("Elements left are released", "[MPSCQueue]")
+{
+    std::atomic<int> alive {0};
+
+    {
+        MPSCQueue<Item> queue;
+        queue.Push(std::make_unique<Item>(0, 1, &alive));
+        queue.Push(std::make_unique<Item>(0, 2, &alive));
+        REQUIRE(2 == alive);
+    }
+
+    REQUIRE(0 == alive);
+
+    MPSCQueue<Item> queue;
+    for (int i = 0; i < 3; ++i) {
+        queue.Push(std::make_unique<Item>(0, i, &alive));
+    }
+
+    REQUIRE_THROWS(queue.ConsumeAll([](std::unique_ptr<Item> item) {
+        if (item->seq == 1) {
+            throw std::runtime_error("consumer failure");
+        }
+    }));
+    REQUIRE(0 == alive);
+    REQUIRE(queue.empty());
+}
+
+TEST_CASE("Consume part of elements and leave the rest", "[MPSCQueue]")
+{
+    std::atomic<int> alive {0};
+
+    MPSCQueue<Item> queue;
+    for (int i = 0; i < 5; ++i) {
+        queue.Push(std::make_unique<Item>(0, i, &alive));
+    }
+
+    std::vector<int> seqs;
+    auto take = [&seqs](std::unique_ptr<Item> item) {
+        seqs.push_back(item->seq);
+    };
+
+    auto consumed = queue.ConsumeWhile(take, [&seqs] { return seqs.size() < 2; });
+    REQUIRE(2 == consumed);
+    REQUIRE(seqs == std::vector<int>{0, 1});
+    REQUIRE_FALSE(queue.empty());
+
+    // Elements left are not visible to producers.
+    REQUIRE(queue.Push(std::make_unique<Item>(0, 5, &alive)));
+
+    // Elements left go before newly pushed ones.
+    consumed = queue.ConsumeWhile(take, [&seqs] { return seqs.size() < 4; });
+    REQUIRE(2 == consumed);
+    REQUIRE(seqs == std::vector<int>{0, 1, 2, 3});
+
+    queue.Push(std::make_unique<Item>(0, 6, &alive));
+    REQUIRE(3 == queue.ConsumeAll(take));
+    REQUIRE(seqs == std::vector<int>{0, 1, 2, 3, 4, 5, 6});
+    REQUIRE(queue.empty());
+    REQUIRE(0 == alive);
+
+    // Elements left are released along with the queue.
+    {
+        MPSCQueue<Item> another;
+        another.Push(std::make_unique<Item>(0, 1, &alive));
+        another.Push(std::make_unique<Item>(0, 2, &alive));
+        another.ConsumeWhile([](std::unique_ptr<Item>) {}, [] { return false; });
+        REQUIRE(2 == alive);
+    }
+
+    REQUIRE(0 == alive);
+}
+
+TEST_CASE("Multiple producers push concurrently", "[MPSCQueue]")
+{
+    constexpr int kProducers = 4;
+    constexpr int kItemsPerProducer = 20000;
+
+    MPSCQueue<Item> queue;
+    std::atomic<int> wakeups {0};
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < kProducers; ++p) {
+        producers.emplace_back([&queue, &wakeups, p] {
+            for (int i = 0; i < kItemsPerProducer; ++i) {
+                if (queue.Push(std::make_unique<Item>(p, i))) {
+                    ++wakeups;
+                }
+            }
+        });
+    }
+
+    std::vector<int> next_seqs(kProducers, 0);
+    int consumed = 0;
+    int drains = 0;
+    bool in_order = true;
+    while (consumed < kProducers * kItemsPerProducer) {
+        auto cnt = queue.ConsumeAll([&](std::unique_ptr<Item> item) {
+            in_order &= item->seq == next_seqs[item->producer];
+            next_seqs[item->producer] = item->seq + 1;
+        });
+
+        consumed += static_cast<int>(cnt);
+        drains += cnt > 0 ? 1 : 0;
+    }
+
+    for (auto& th : producers) {
+        th.join();
+    }
+
+    REQUIRE(in_order);
+    REQUIRE(queue.empty());
+    // Each drain that took elements was preceded by exactly one push seeing empty queue.
+    REQUIRE(wakeups == drains);
+}
+
+}   // namespace ezio
@@ -0,0 +1,207 @@
+/*
+ @ 0xCCCCCCCC
+*/
+
+#include "catch2/catch.hpp"
+
+#include "ezio/output_queue.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+#if defined(OS_POSIX)
+
+std::string JoinQueued(const ezio::OutputQueue& queue)
+{
+    iovec vecs[16];
+    auto cnt = queue.PeekIOVecs(vecs, 16);
+
+    std::string joined;
+    for (size_t i = 0; i < cnt; ++i) {
+        joined.append(static_cast<const char*>(vecs[i].iov_base), vecs[i].iov_len);
+    }
+
+    return joined;
+}
+
+#endif
+
+}   // namespace
+
+namespace ezio {
+
+TEST_CASE("Queue payloads in segments", "[OutputQueue]")
+{
+    OutputQueue queue;
+    REQUIRE(queue.empty());
+
+    SECTION("small copied data bytes are coalesced") {
+        queue.Append(kbase::StringView("hello"));
+        queue.Append(kbase::StringView(" "));
+        queue.Append(kbase::StringView("world"));
+        REQUIRE(11 == queue.size());
+        REQUIRE(1 == queue.segment_count());
+    }
+
+    SECTION("owned payloads are queued as they are") {
+        std::string large(4096, 'x');
+        auto data_ptr = large.data();
+        queue.Append(std::move(large));
+
+        auto buf = Buffer::MakeChained(16);
+        std::string content(40, 'y');
+        buf.Write(content.data(), content.size());
+        queue.Append(std::move(buf));
+
+        auto shared = std::make_shared<std::string>("shared");
+        queue.Append(shared, kbase::StringView(*shared));
+
+        REQUIRE(3 == queue.segment_count());
+        REQUIRE(4096 + 40 + 6 == queue.size());
+
+#if defined(OS_POSIX)
+        iovec vecs[8];
+        REQUIRE(5 == queue.PeekIOVecs(vecs, 8));
+        REQUIRE(data_ptr == vecs[0].iov_base);
+        REQUIRE(shared->data() == vecs[4].iov_base);
+#endif
+
+        queue.Consume(4096 + 20);
+        REQUIRE(2 == queue.segment_count());
+        REQUIRE(2 == shared.use_count());
+
+        queue.Consume(26);
+        REQUIRE(queue.empty());
+        REQUIRE(1 == shared.use_count());
+    }
+
+    SECTION("vectors are queued without copying") {
+        std::vector<char> data(3000, 'v');
+        auto data_ptr = data.data();
+        queue.Append(std::move(data));
+        queue.Append(std::vector<char>());
+        REQUIRE(1 == queue.segment_count());
+        REQUIRE(3000 == queue.size());
+
+#if defined(OS_POSIX)
+        iovec vecs[4];
+        REQUIRE(1 == queue.PeekIOVecs(vecs, 4));
+        REQUIRE(data_ptr == vecs[0].iov_base);
+#endif
+
+        queue.Consume(3000);
+        REQUIRE(queue.empty());
+    }
+
+    SECTION("shared payloads are queued without copying") {
+        SharedPayload payload(std::string(2048, 'p'));
+        REQUIRE(1 == payload.use_count());
+
+        OutputQueue another;
+        queue.Append(payload);
+        another.Append(payload);
+        REQUIRE(3 == payload.use_count());
+        REQUIRE(2048 == queue.size());
+
+#if defined(OS_POSIX)
+        iovec vecs[4];
+        REQUIRE(1 == another.PeekIOVecs(vecs, 4));
+        REQUIRE(payload.data() == vecs[0].iov_base);
+#endif
+
+        queue.Consume(1024);
+        REQUIRE(3 == payload.use_count());
+        queue.Consume(1024);
+        REQUIRE(2 == payload.use_count());
+
+        another.Clear();
+        REQUIRE(1 == payload.use_count());
+
+        queue.Append(SharedPayload());
+        REQUIRE(queue.empty());
+    }
+
+    SECTION("share storage of front segments") {
+        std::string large(4096, 's');
+        auto data_ptr = large.data();
+        queue.Append(std::move(large));
+        queue.Append(kbase::StringView("tail"));
+
+        REQUIRE_FALSE(queue.ShareFront(8192).owner);
+
+        queue.Consume(96);
+        auto shared = queue.ShareFront(4000);
+        REQUIRE(shared.owner);
+        REQUIRE(data_ptr + 96 == shared.data.data());
+        REQUIRE(4000 == shared.data.size());
+        REQUIRE(4004 == queue.size());
+
+        // The storage outlives consumed bytes.
+        queue.Consume(4000);
+        REQUIRE(1 == queue.segment_count());
+        REQUIRE(1 == shared.owner.use_count());
+        REQUIRE(std::string(4000, 's') == shared.data.ToString());
+
+        // Copied bytes are owned by the queue alone.
+        REQUIRE_FALSE(queue.ShareFront(1).owner);
+
+        auto buf = Buffer::MakeChained(16);
+        std::string content(40, 'b');
+        buf.Write(content.data(), content.size());
+        queue.Consume(4);
+        queue.Append(std::move(buf));
+        REQUIRE_FALSE(queue.ShareFront(1).owner);
+    }
+
+#if defined(OS_POSIX)
+    SECTION("file regions interleave with in-memory data") {
+        std::vector<bool> results;
+        auto on_done = [&results](bool completed) { results.push_back(completed); };
+
+        queue.Append(kbase::StringView("head"));
+        queue.AppendFile(3, 100, 50, on_done);
+        queue.Append(std::string("tail"));
+        queue.AppendFile(4, 0, 0, on_done);
+        REQUIRE(58 == queue.size());
+        REQUIRE(results == std::vector<bool>{true});
+
+        iovec vecs[4];
+        REQUIRE(1 == queue.PeekIOVecs(vecs, 4));
+        REQUIRE_FALSE(queue.IsFileRegionAtFront());
+
+        queue.Consume(4);
+        REQUIRE(queue.IsFileRegionAtFront());
+        REQUIRE(0 == queue.PeekIOVecs(vecs, 4));
+
+        queue.Consume(20);
+        auto region = queue.PeekFileRegion();
+        REQUIRE(3 == region.fd);
+        REQUIRE(120 == region.offset);
+        REQUIRE(30 == region.size);
+
+        queue.Consume(32);
+        REQUIRE(results == std::vector<bool>{true, true});
+        REQUIRE(JoinQueued(queue) == "il");
+
+        queue.AppendFile(5, 0, 10, on_done);
+        queue.Clear();
+        REQUIRE(results == std::vector<bool>{true, true, false});
+        REQUIRE(queue.empty());
+    }
+
+    SECTION("consume partially") {
+        queue.Append(std::string("0123456789"));
+        queue.Append(kbase::StringView("abcdef"));
+        queue.Consume(7);
+        REQUIRE(JoinQueued(queue) == "789abcdef");
+        queue.Consume(4);
+        REQUIRE(JoinQueued(queue) == "bcdef");
+        REQUIRE(1 == queue.segment_count());
+    }
+#endif
+}
+
+}   // namespace ezio
@@ -0,0 +1,59 @@
+/*
+ @ 0xCCCCCCCC
+*/
+
+#include "catch2/catch.hpp"
+
+#include "ezio/recv_size_predictor.h"
+
+namespace ezio {
+
+TEST_CASE("Initial prediction", "[RecvSizePredictor]")
+{
+    RecvSizePredictor predictor;
+    REQUIRE(predictor.next_size() == RecvSizePredictor::kDefaultInitial);
+
+    // Rounded up to the candidate size.
+    RecvSizePredictor rounded(64, 1000, 65536);
+    REQUIRE(rounded.next_size() == 1024);
+}
+
+TEST_CASE("Prediction grows when reads fill it", "[RecvSizePredictor]")
+{
+    RecvSizePredictor predictor(64, 1024, 65536);
+
+    predictor.Record(1024);
+    REQUIRE(predictor.next_size() == 16384);
+
+    predictor.Record(16384);
+    REQUIRE(predictor.next_size() == 65536);
+
+    // Capped by the maximum.
+    predictor.Record(65536);
+    REQUIRE(predictor.next_size() == 65536);
+}
+
+TEST_CASE("Prediction shrinks after consecutive small reads", "[RecvSizePredictor]")
+{
+    RecvSizePredictor predictor(64, 2048, 65536);
+
+    predictor.Record(100);
+    REQUIRE(predictor.next_size() == 2048);
+
+    predictor.Record(100);
+    REQUIRE(predictor.next_size() == 1024);
+
+    // A read in between breaks the streak.
+    predictor.Record(100);
+    predictor.Record(1000);
+    predictor.Record(100);
+    REQUIRE(predictor.next_size() == 1024);
+
+    for (int i = 0; i < 100; ++i) {
+        predictor.Record(1);
+    }
+
+    REQUIRE(predictor.next_size() == 64);
+}
+
+}   // namespace ezio
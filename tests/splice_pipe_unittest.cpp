@@ -0,0 +1,112 @@
+/*
+ @ 0xCCCCCCCC
+*/
+
+#include "catch2/catch.hpp"
+
+#include "ezio/splice_pipe.h"
+
+#include <string>
+#include <utility>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "ezio/scoped_socket.h"
+
+namespace {
+
+std::pair<ezio::ScopedSocket, ezio::ScopedSocket> MakeSocketPair()
+{
+    int fds[2] {};
+    REQUIRE(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds) == 0);
+    return {ezio::ScopedSocket(fds[0]), ezio::ScopedSocket(fds[1])};
+}
+
+std::string ReadAvailable(int fd)
+{
+    std::string data;
+    char buf[4096];
+    ssize_t n;
+    while ((n = read(fd, buf, sizeof(buf))) > 0) {
+        data.append(buf, static_cast<size_t>(n));
+    }
+
+    return data;
+}
+
+}   // namespace
+
+namespace ezio {
+
+TEST_CASE("Splice data bytes between sockets through a pipe", "[SplicePipe]")
+{
+    SplicePipe pipe;
+    REQUIRE(pipe.capacity() > 0);
+    REQUIRE(0 == pipe.buffered_size());
+
+    auto src = MakeSocketPair();
+    auto dest = MakeSocketPair();
+
+    SECTION("bytes are moved as they are") {
+        std::string data("hello, world");
+        REQUIRE(write(src.first.get(), data.data(), data.size()) ==
+                static_cast<ssize_t>(data.size()));
+
+        REQUIRE(pipe.SpliceFrom(src.second.get()) == static_cast<ssize_t>(data.size()));
+        REQUIRE(data.size() == pipe.buffered_size());
+
+        REQUIRE(pipe.SpliceTo(dest.first.get()) == static_cast<ssize_t>(data.size()));
+        REQUIRE(0 == pipe.buffered_size());
+        REQUIRE(ReadAvailable(dest.second.get()) == data);
+    }
+
+    SECTION("nothing to splice from an idle socket") {
+        REQUIRE(pipe.SpliceFrom(src.second.get()) == -1);
+        REQUIRE(EAGAIN == errno);
+        REQUIRE(0 == pipe.SpliceTo(dest.first.get()));
+    }
+
+    SECTION("splicing from a closed socket reaches EOF") {
+        src.first = nullptr;
+        REQUIRE(0 == pipe.SpliceFrom(src.second.get()));
+    }
+
+    SECTION("bytes stay buffered while the destination is full") {
+        int tiny = 4096;
+        setsockopt(dest.first.get(), SOL_SOCKET, SO_SNDBUF, &tiny, sizeof(tiny));
+
+        std::string data(pipe.capacity(), 'x');
+        size_t written = 0;
+        while (written < data.size()) {
+            auto n = write(src.first.get(), data.data() + written, data.size() - written);
+            if (n <= 0) {
+                break;
+            }
+
+            written += static_cast<size_t>(n);
+            while (pipe.buffered_size() < pipe.capacity() &&
+                   pipe.SpliceFrom(src.second.get()) > 0) {}
+        }
+
+        auto buffered = pipe.buffered_size();
+        REQUIRE(buffered > 0);
+
+        auto moved = pipe.SpliceTo(dest.first.get());
+        REQUIRE(moved >= 0);
+        REQUIRE(pipe.buffered_size() == buffered - static_cast<size_t>(moved));
+
+        size_t received = 0;
+        while (pipe.buffered_size() > 0 || received < static_cast<size_t>(moved)) {
+            received += ReadAvailable(dest.second.get()).size();
+            auto n = pipe.SpliceTo(dest.first.get());
+            REQUIRE(n >= 0);
+            moved += n;
+        }
+
+        received += ReadAvailable(dest.second.get()).size();
+        REQUIRE(received == buffered);
+    }
+}
+
+}   // namespace ezio
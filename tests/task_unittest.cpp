@@ -0,0 +1,229 @@
+/*
+ @ 0xCCCCCCCC
+*/
+
+#include "catch2/catch.hpp"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <type_traits>
+
+#include "kbase/at_exit_manager.h"
+
+#include "ezio/event_loop.h"
+#include "ezio/io_service_context.h"
+#include "ezio/task.h"
+
+#include "tests/allocation_counter.h"
+
+namespace {
+
+// Records how many times the callable was copied or moved.
+struct CopyCounter {
+    explicit CopyCounter(size_t& count)
+        : copies(&count)
+    {}
+
+    CopyCounter(const CopyCounter& other)
+        : copies(other.copies)
+    {
+        ++*copies;
+    }
+
+    CopyCounter(CopyCounter&& other) noexcept
+        : copies(other.copies)
+    {
+        ++*copies;
+    }
+
+    void operator()() const
+    {}
+
+    size_t* copies;
+};
+
+struct Session {
+    void OnMessage(const std::string& msg)
+    {
+        received += msg;
+    }
+
+    std::string received;
+};
+
+}   // namespace
+
+namespace ezio {
+
+TEST_CASE("Task stores common callables inline", "[Task]")
+{
+    SECTION("empty tasks")
+    {
+        Task task;
+        REQUIRE_FALSE(task);
+        REQUIRE_THROWS_AS(task(), std::bad_function_call);
+
+        void (*fn)() = nullptr;
+        REQUIRE_FALSE(Task(fn));
+        REQUIRE_FALSE(Task(std::function<void()>()));
+    }
+
+    SECTION("only nullary callables convert")
+    {
+        static_assert(std::is_convertible<void (*)(), Task>::value, "function pointer");
+        static_assert(std::is_convertible<std::function<int()>, Task>::value, "result dropped");
+        static_assert(!std::is_constructible<Task, int>::value, "not callable");
+        static_assert(!std::is_convertible<std::string, Task>::value, "not callable");
+        static_assert(!std::is_constructible<Task, std::function<void(int)>>::value,
+                      "takes an argument");
+    }
+
+    SECTION("no allocation for captures of common sizes")
+    {
+        auto session = std::make_shared<Session>();
+        std::string msg("hello");
+        size_t seq = 1;
+
+        auto fn = [session, msg = std::move(msg), seq] {
+            session->OnMessage(msg.substr(0, seq * msg.size()));
+        };
+        static_assert(Task::StoresInline<decltype(fn)>(), "should be inline");
+
+        auto bind_fn = std::bind(&Session::OnMessage, session, std::string(";"));
+        static_assert(Task::StoresInline<decltype(bind_fn)>(), "should be inline");
+
+        Task task;
+        Task bound;
+        bool moved_out = false;
+        size_t allocations = 0;
+        {
+            // Checks are made out of the scope, in case they allocate.
+            AllocationCounter counter;
+
+            Task moved(std::move(fn));
+            task = std::move(moved);
+            moved_out = !moved;
+
+            bound = std::move(bind_fn);
+
+            allocations = counter.count();
+        }
+
+        REQUIRE(0 == allocations);
+        REQUIRE(moved_out);
+        REQUIRE(task);
+        REQUIRE(bound);
+
+        task();
+        task();
+        bound();
+
+        REQUIRE(session->received == "hellohello;");
+    }
+
+    SECTION("move-only callables")
+    {
+        auto value = std::make_unique<int>(1);
+        int result = 0;
+        Task task([value = std::move(value), &result] {
+            result = *value;
+        });
+
+        task();
+        REQUIRE(1 == result);
+    }
+
+    SECTION("inline callables are moved along with tasks")
+    {
+        size_t copies = 0;
+        Task task(CopyCounter{copies});
+        static_assert(Task::StoresInline<CopyCounter>(), "should be inline");
+        REQUIRE(1 == copies);
+
+        Task moved(std::move(task));
+        moved();
+        REQUIRE(2 == copies);
+    }
+
+    SECTION("large callables are allocated")
+    {
+        struct Large {
+            char data[Task::kInlineSize + 1];
+        };
+
+        size_t copies = 0;
+        int called = 0;
+        auto fn = [large = Large{}, counter = CopyCounter{copies}, &called] {
+            called += large.data[0] + 1;
+        };
+        static_assert(!Task::StoresInline<decltype(fn)>(), "should be on heap");
+
+        Task moved;
+        size_t allocations = 0;
+        {
+            AllocationCounter counter;
+
+            // Moving a task hands over its heap block, leaving the callable untouched.
+            Task task(std::move(fn));
+            moved = std::move(task);
+
+            allocations = counter.count();
+        }
+
+        REQUIRE(1 == allocations);
+        REQUIRE(1 == copies);
+
+        moved();
+        REQUIRE(1 == called);
+    }
+}
+
+TEST_CASE("Queuing a task allocates nothing once queue nodes are recycled", "[Task]")
+{
+    kbase::AtExitManager exit_manager;
+    IOServiceContext::Init();
+
+    EventLoop loop;
+
+    // The first tasks allocate queue nodes, which are recycled once they have run.
+    loop.QueueTask([] {});
+    loop.QueueTask([&loop] {
+        loop.Quit();
+    });
+    loop.Run();
+
+    auto session = std::make_shared<Session>();
+    std::string msg("hello");
+
+    size_t copies = 0;
+    auto fn = [session, msg = std::move(msg), counter = CopyCounter{copies}] {
+        session->OnMessage(msg);
+    };
+    static_assert(Task::StoresInline<decltype(fn)>(), "should be inline");
+
+    auto quit = [&loop] {
+        loop.Quit();
+    };
+
+    size_t allocations = 0;
+    {
+        AllocationCounter counter;
+
+        loop.QueueTask(std::move(fn));
+        loop.QueueTask(quit);
+
+        allocations = counter.count();
+    }
+
+    REQUIRE(0 == allocations);
+
+    // Into the task, and then into its queue node.
+    REQUIRE(2 == copies);
+
+    loop.Run();
+
+    REQUIRE(session->received == "hello");
+}
+
+}   // namespace ezio
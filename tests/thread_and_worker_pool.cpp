@@ -6,8 +6,15 @@
 
 #include "ezio/thread.h"
 
+#include <algorithm>
 #include <cstdio>
+#include <future>
 #include <string>
+#include <thread>
+
+#if defined(OS_POSIX)
+#include <sched.h>
+#endif
 
 #include "kbase/at_exit_manager.h"
 
@@ -75,4 +82,36 @@ TEST_CASE("WorkerPool runs several worker threads", "[WorkerPool]")
     printf("%s %u\n", this_thread::GetName(), this_thread::GetID());
 }
 
+#if defined(OS_POSIX)
+
+TEST_CASE("WorkerPool pins workers to CPUs", "[WorkerPool]")
+{
+    kbase::AtExitManager exit_manager;
+    IOServiceContext::Init();
+
+    EventLoop main;
+
+    constexpr size_t kWorkers = 2;
+    WorkerPool pool(&main, kWorkers, "Robin", true);
+
+    auto available_cpus = this_thread::GetAvailableCPUs();
+    REQUIRE_FALSE(available_cpus.empty());
+
+    for (size_t i = 0; i < kWorkers; ++i) {
+        std::promise<cpu_set_t> affinity;
+        pool.event_loops()[i]->RunTask([&affinity] {
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            sched_getaffinity(0, sizeof(cpus), &cpus);
+            affinity.set_value(cpus);
+        });
+
+        auto cpus = affinity.get_future().get();
+        REQUIRE(CPU_COUNT(&cpus) == 1);
+        REQUIRE(CPU_ISSET(available_cpus[i % available_cpus.size()], &cpus));
+    }
+}
+
+#endif
+
 }   // namespace ezio
@@ -0,0 +1,83 @@
+/*
+ @ 0xCCCCCCCC
+*/
+
+#include "catch2/catch.hpp"
+
+#include "ezio/zerocopy_graveyard.h"
+
+#include <limits>
+#include <memory>
+#include <string>
+
+#include <sys/socket.h>
+
+#include "ezio/event_loop.h"
+#include "ezio/scoped_socket.h"
+
+namespace {
+
+std::shared_ptr<const void> MakePayload()
+{
+    return std::make_shared<std::string>(1024, 'x');
+}
+
+}   // namespace
+
+namespace ezio {
+
+TEST_CASE("Release payloads of completed zero-copy sends", "[ZeroCopyGraveyard]")
+{
+    ZeroCopyPendingSends pending;
+
+    SECTION("sends in the completed range are released") {
+        for (uint32_t id = 0; id < 5; ++id) {
+            pending.emplace_back(id, MakePayload());
+        }
+
+        ReleaseZeroCopySends(pending, 1, 2);
+        REQUIRE(2 == pending.size());
+        REQUIRE(0 == pending.front().first);
+        REQUIRE(4 == pending.back().first);
+    }
+
+    SECTION("ids wrapping around") {
+        auto max_id = std::numeric_limits<uint32_t>::max();
+        pending.emplace_back(max_id - 1, MakePayload());
+        pending.emplace_back(max_id, MakePayload());
+        pending.emplace_back(0, MakePayload());
+        pending.emplace_back(1, MakePayload());
+
+        ReleaseZeroCopySends(pending, max_id, 1);
+        REQUIRE(2 == pending.size());
+        REQUIRE(max_id - 1 == pending.front().first);
+        REQUIRE(1 == pending.back().first);
+    }
+}
+
+TEST_CASE("Graveyard holds payloads until reported complete", "[ZeroCopyGraveyard]")
+{
+    EventLoop loop;
+    auto graveyard = loop.zerocopy_graveyard();
+    REQUIRE(0 == graveyard->size());
+
+    int fds[2] {};
+    REQUIRE(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds) == 0);
+    ScopedSocket peer(fds[1]);
+
+    auto payload = MakePayload();
+    std::weak_ptr<const void> watcher(payload);
+
+    // The socket may go away while the kernel still holds the payload.
+    {
+        ScopedSocket sock(fds[0]);
+        ZeroCopyPendingSends pending;
+        pending.emplace_back(0, std::move(payload));
+        graveyard->Adopt(sock, std::move(pending));
+    }
+
+    REQUIRE(1 == graveyard->size());
+    REQUIRE_FALSE(watcher.expired());
+}
+
+}   // namespace ezio